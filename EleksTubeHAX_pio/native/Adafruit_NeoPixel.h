@@ -0,0 +1,79 @@
+#ifndef NATIVE_ADAFRUIT_NEOPIXEL_H
+#define NATIVE_ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+
+/*
+ * Adafruit_NeoPixel for the native build: keeps the colors, show() copies them to what the LEDs would show.
+ */
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel
+{
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, uint16_t type = NEO_GRB + NEO_KHZ800) : numLEDs(n), brightness(0), showCount(0)
+  {
+    pixels = new uint32_t[n]();
+    shown = new uint32_t[n]();
+  }
+  ~Adafruit_NeoPixel()
+  {
+    delete[] pixels;
+    delete[] shown;
+  }
+
+  void begin() {}
+  void show();
+  void setPixelColor(uint16_t n, uint32_t c)
+  {
+    if (n < numLEDs)
+      pixels[n] = c;
+  }
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(n, Color(r, g, b)); }
+  void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+  void clear() { fill(0); }
+  void setBrightness(uint8_t b) { brightness = b; }
+  uint8_t getBrightness() const { return brightness; }
+  uint16_t numPixels() const { return numLEDs; }
+  uint32_t getPixelColor(uint16_t n) const { return n < numLEDs ? pixels[n] : 0; }
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+  // Native only: the color of a LED at the last show(), scaled by the brightness, and the number of show() calls.
+  uint32_t getShownColor(uint16_t n) const { return n < numLEDs ? shown[n] : 0; }
+  uint32_t getShowCount() const { return showCount; }
+
+private:
+  uint16_t numLEDs;
+  uint8_t brightness;
+  uint32_t *pixels;
+  uint32_t *shown;
+  uint32_t showCount;
+};
+
+inline void Adafruit_NeoPixel::show()
+{
+  for (uint16_t i = 0; i < numLEDs; i++)
+  {
+    uint32_t c = pixels[i];
+    uint32_t scale = brightness ? brightness : 256; // 0 means full brightness, like in the library
+    uint8_t r = ((c >> 16) & 0xFF) * scale >> 8;
+    uint8_t g = ((c >> 8) & 0xFF) * scale >> 8;
+    uint8_t b = (c & 0xFF) * scale >> 8;
+    shown[i] = Color(r, g, b);
+  }
+  showCount++;
+}
+
+inline void Adafruit_NeoPixel::fill(uint32_t c, uint16_t first, uint16_t count)
+{
+  uint16_t end = (count == 0 || first + count > numLEDs) ? numLEDs : first + count;
+  for (uint16_t i = first; i < end; i++)
+  {
+    pixels[i] = c;
+  }
+}
+
+#endif // NATIVE_ADAFRUIT_NEOPIXEL_H
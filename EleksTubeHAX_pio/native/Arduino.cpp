@@ -0,0 +1,296 @@
+#include "Arduino.h"
+#include "NativeHardware.h"
+#include "GLOBAL_DEFINES.h"
+#include <chrono>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ************ time *********************
+
+static uint64_t virtualMicros = 0;
+static uint64_t sleptMicros = 0;
+
+void NativeHardware::advance(uint32_t ms) { virtualMicros += (uint64_t)ms * 1000; }
+void NativeHardware::advanceMicros(uint32_t us) { virtualMicros += us; }
+uint64_t NativeHardware::getMicros() { return virtualMicros; }
+uint64_t NativeHardware::getSleptMicros() { return sleptMicros; }
+
+// 32 bit like on the ESP32: micros() wraps after 71 minutes, millis() after 49 days
+unsigned long millis() { return (uint32_t)(virtualMicros / 1000); }
+unsigned long micros() { return (uint32_t)virtualMicros; }
+// delay() gives the CPU to other tasks (the DNS answers come here), delayMicroseconds() waits busy
+void delay(uint32_t ms)
+{
+  virtualMicros += (uint64_t)ms * 1000;
+  sleptMicros += (uint64_t)ms * 1000;
+  NativeHardware::answerDnsLookups(); // the lwIP task
+}
+void delayMicroseconds(uint32_t us) { virtualMicros += us; }
+void yield() {}
+
+uint32_t getCpuFrequencyMhz() { return 240; }
+
+// The cycle counter measures the real time on the host, so RenderStats shows how long the code takes to run.
+uint32_t EspClass::getCycleCount()
+{
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  return (uint32_t)(ns * getCpuFrequencyMhz() / 1000);
+}
+
+// ************ GPIO *********************
+
+static uint8_t pinLevels[GPIO_NUM_MAX];
+static uint8_t shiftRegister = 0xFF; // 74HC595: bit n is Qn; all CS lines high (no display selected) at power on
+static uint8_t shiftOutputs = 0xFF;  // latched to the outputs
+static uint32_t pwmDuty[16];
+
+#ifdef HARDWARE_IPSTUBE_CLOCK
+// same as in ChipSelect.cpp, seconds ones first
+static const uint8_t lcdEnablePins[NUM_DIGITS] = {GPIO_NUM_15, GPIO_NUM_2, GPIO_NUM_27, GPIO_NUM_14, GPIO_NUM_12, GPIO_NUM_13};
+#endif
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin >= GPIO_NUM_MAX)
+  {
+    return;
+  }
+  uint8_t old = pinLevels[pin];
+  pinLevels[pin] = val ? HIGH : LOW;
+#ifndef HARDWARE_IPSTUBE_CLOCK
+  if (old == LOW && val)
+  { // rising edges move the bits through the shift register and latch them to the outputs
+    if (pin == CSSR_CLOCK_PIN)
+    {
+      shiftRegister = (shiftRegister << 1) | pinLevels[CSSR_DATA_PIN];
+    }
+    else if (pin == CSSR_LATCH_PIN)
+    {
+      shiftOutputs = shiftRegister;
+    }
+  }
+#endif
+}
+
+int digitalRead(uint8_t pin)
+{
+  // buttons are active low and not pressed
+  return pin < GPIO_NUM_MAX ? pinLevels[pin] : HIGH;
+}
+
+int analogRead(uint8_t pin) { return 0; }
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint8_t bit = (bitOrder == LSBFIRST) ? (val >> i) & 1 : (val >> (7 - i)) & 1;
+    digitalWrite(dataPin, bit);
+    digitalWrite(clockPin, HIGH);
+    digitalWrite(clockPin, LOW);
+  }
+}
+
+uint8_t NativeHardware::getSelectedDigits()
+{
+  uint8_t map = 0;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+#ifndef HARDWARE_IPSTUBE_CLOCK
+    bool selected = !((shiftOutputs >> (5 - digit)) & 1); // Q5 is digit 0, Q0 is digit 5, see ChipSelect::update()
+#else
+    bool selected = (pinLevels[lcdEnablePins[digit]] == LOW);
+#endif
+    if (selected)
+    {
+      map |= 1 << digit;
+    }
+  }
+  return map;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}
+void detachInterrupt(uint8_t pin) {}
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) { return freq; }
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+  if (channel < 16)
+  {
+    pwmDuty[channel] = duty;
+  }
+}
+uint32_t NativeHardware::getPwmDuty(uint8_t channel) { return channel < 16 ? pwmDuty[channel] : 0; }
+
+long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+void randomSeed(unsigned long seed) { srand(seed); }
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// ************ memory *********************
+
+bool psramFound() { return false; }
+void *ps_malloc(size_t size) { return NULL; }
+void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+
+// ************ String *********************
+
+static std::string numberToString(unsigned long long value, unsigned char base, bool negative)
+{
+  if (base < 2 || base > 36)
+  {
+    base = 10;
+  }
+  std::string digits;
+  do
+  {
+    digits.insert(digits.begin(), "0123456789abcdefghijklmnopqrstuvwxyz"[value % base]);
+    value /= base;
+  } while (value > 0);
+  return negative ? "-" + digits : digits;
+}
+
+static std::string signedToString(long long value, unsigned char base)
+{
+  if (value < 0 && base == 10)
+  {
+    return numberToString(-(unsigned long long)value, base, true);
+  }
+  return numberToString((unsigned long long)value, base, false);
+}
+
+static std::string floatToString(double value, unsigned char decimals)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  return buffer;
+}
+
+String::String(int value, unsigned char base) : s(signedToString(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s(numberToString(value, base, false)) {}
+String::String(long value, unsigned char base) : s(signedToString(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s(numberToString(value, base, false)) {}
+String::String(float value, unsigned char decimals) : s(floatToString(value, decimals)) {}
+String::String(double value, unsigned char decimals) : s(floatToString(value, decimals)) {}
+
+void String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const
+{
+  if (buf == NULL || bufsize == 0)
+  {
+    return;
+  }
+  size_t n = index < s.length() ? std::min((size_t)bufsize - 1, s.length() - index) : 0;
+  memcpy(buf, s.c_str() + std::min((size_t)index, s.length()), n);
+  buf[n] = '\0';
+}
+
+int String::indexOf(char c, unsigned int from) const
+{
+  size_t pos = s.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int from) const
+{
+  size_t pos = s.find(str.s, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+  if (from > to)
+  {
+    std::swap(from, to);
+  }
+  if (from >= s.length())
+  {
+    return String();
+  }
+  return String(s.substr(from, std::min((size_t)to, s.length()) - from));
+}
+
+void String::trim()
+{
+  size_t first = s.find_first_not_of(" \t\r\n");
+  size_t last = s.find_last_not_of(" \t\r\n");
+  s = (first == std::string::npos) ? "" : s.substr(first, last - first + 1);
+}
+
+void String::replace(const String &find, const String &replacement)
+{
+  if (find.s.empty())
+  {
+    return;
+  }
+  for (size_t pos = s.find(find.s); pos != std::string::npos; pos = s.find(find.s, pos + replacement.s.length()))
+  {
+    s.replace(pos, find.s.length(), replacement.s);
+  }
+}
+
+void String::toLowerCase()
+{
+  for (char &c : s)
+    c = tolower(c);
+}
+
+void String::toUpperCase()
+{
+  for (char &c : s)
+    c = toupper(c);
+}
+
+bool String::endsWith(const String &suffix) const
+{
+  return s.length() >= suffix.s.length() && s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+  return s.length() == other.s.length() && strcasecmp(s.c_str(), other.s.c_str()) == 0;
+}
+
+// ************ Print and Serial *********************
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+  {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(long value, int base) { return write(signedToString(value, base).c_str()); }
+size_t Print::print(unsigned long value, int base) { return write(numberToString(value, base, false).c_str()); }
+size_t Print::print(long long value, int base) { return write(signedToString(value, base).c_str()); }
+size_t Print::print(unsigned long long value, int base) { return write(numberToString(value, base, false).c_str()); }
+size_t Print::print(double value, int digits) { return write(floatToString(value, digits).c_str()); }
+
+size_t Print::printf(const char *format, ...)
+{
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0)
+  {
+    return 0;
+  }
+  return write((const uint8_t *)buffer, std::min((size_t)length, sizeof(buffer) - 1));
+}
+
+static bool serialOutput = true;
+
+void NativeHardware::setSerialOutput(bool enabled) { serialOutput = enabled; }
+
+size_t HardwareSerial::write(uint8_t c) { return serialOutput ? fwrite(&c, 1, 1, stdout) : 1; }
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return serialOutput ? fwrite(buffer, 1, size, stdout) : size; }
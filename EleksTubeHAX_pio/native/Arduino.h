@@ -0,0 +1,255 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+/*
+ * Arduino core for the native (host) build, see platformio.ini [env:native].
+ * Only what the firmware uses: Serial on stdout, a virtual clock for millis()/delay(), GPIO pins that remember their
+ * level (with a model of the 74HC595 chip select shift register, see NativeHardware.h), String and the ESP32 extras.
+ * The firmware runs single-threaded here; IMAGE_DECODER_TASK is not supported.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+#ifdef IMAGE_DECODER_TASK
+#error "IMAGE_DECODER_TASK needs FreeRTOS, it can't be used in the native build."
+#endif
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+inline word makeWord(uint8_t h, uint8_t l) { return (h << 8) | l; }
+#define word(...) makeWord(__VA_ARGS__)
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define PI 3.1415926535897932384626433832795
+#define DEC 10
+#define HEX 16
+
+#define F(string_literal) (string_literal)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define digitalPinToInterrupt(p) (p)
+
+enum gpio_num_t
+{
+  GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7, GPIO_NUM_8,
+  GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17,
+  GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23, GPIO_NUM_24, GPIO_NUM_25, GPIO_NUM_26,
+  GPIO_NUM_27, GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31, GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35,
+  GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39, GPIO_NUM_MAX
+};
+
+// the sketch, src/main.cpp
+void setup();
+void loop();
+
+// time, virtual: only delay(), delayMicroseconds(), the SPI transfers and the native main advance it (see NativeHardware.h)
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+double ledcChangeFrequency(uint8_t channel, double freq, uint8_t resolution_bits);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// ESP32 extras
+uint32_t getCpuFrequencyMhz();
+bool psramFound();
+void *ps_malloc(size_t size);
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+void *heap_caps_malloc(size_t size, uint32_t caps);
+
+class EspClass
+{
+public:
+  uint32_t getCycleCount(); // host time, scaled to getCpuFrequencyMhz()
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getPsramSize() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+  uint32_t getCpuFreqMHz() { return getCpuFrequencyMhz(); }
+  void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+// FreeRTOS, single core and single task
+typedef int BaseType_t;
+typedef struct
+{
+  int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+inline BaseType_t xPortGetCoreID() { return 1; }
+
+class String
+{
+public:
+  String(const char *s = "") : s(s ? s : "") {}
+  String(const std::string &s) : s(s) {}
+  String(char c) : s(1, c) {}
+  String(int value, unsigned char base = 10);
+  String(unsigned int value, unsigned char base = 10);
+  String(long value, unsigned char base = 10);
+  String(unsigned long value, unsigned char base = 10);
+  String(float value, unsigned char decimals = 2);
+  String(double value, unsigned char decimals = 2);
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &str, unsigned int from = 0) const;
+  String substring(unsigned int from) const { return from < s.length() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const;
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void trim();
+  void replace(const String &find, const String &replacement);
+  void toLowerCase();
+  void toUpperCase();
+  bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+  bool endsWith(const String &suffix) const;
+  bool equals(const String &other) const { return s == other.s; }
+  bool equalsIgnoreCase(const String &other) const;
+  bool isEmpty() const { return s.empty(); }
+
+  String &operator+=(const String &other)
+  {
+    s += other.s;
+    return *this;
+  }
+  String &operator+=(const char *other)
+  {
+    s += other;
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s += c;
+    return *this;
+  }
+  bool concat(const String &other)
+  {
+    s += other.s;
+    return true;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+  friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+  bool operator==(const String &other) const { return s == other.s; }
+  bool operator==(const char *other) const { return s == other; }
+  bool operator!=(const String &other) const { return s != other.s; }
+  bool operator!=(const char *other) const { return s != other; }
+  bool operator<(const String &other) const { return s < other.s; }
+
+private:
+  std::string s;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+  size_t print(const char *str) { return write(str); }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  template <typename T>
+  size_t println(T value)
+  {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(T value, int format)
+  {
+    size_t n = print(value, format);
+    return n + println();
+  }
+  size_t println() { return write("\n"); } // "\r\n" on the device
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+// writes to stdout (unless muted, see NativeHardware::setSerialOutput()), never receives anything
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud) {}
+  void end() {}
+  operator bool() { return true; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override { fflush(stdout); }
+};
+extern HardwareSerial Serial;
+
+#endif // NATIVE_ARDUINO_H
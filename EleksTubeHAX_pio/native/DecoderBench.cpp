@@ -0,0 +1,398 @@
+#include "DecoderBench.h"
+#include "NativeHardware.h"
+#include "GLOBAL_DEFINES.h"
+#include "TFTs.h"
+#include <dirent.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define BENCH_DIMMING (128) // dimming value of the runs with dimming on
+#define BENCH_MIN_MS (200)  // every measurement decodes all images again, until this much host time has passed
+
+// The input of one decoder, made from a BMP file.
+struct BenchImage
+{
+  uint16_t bitDepth; // 1, 4, 8, 24: BMP; 16: CLK or bundle
+  bool swapped;      // RGB565 MSB first (bundle)
+  int16_t w, h;
+  uint32_t lineSize;
+  uint32_t palette[256];
+  std::vector<uint8_t> lines;     // h lines of lineSize bytes
+  std::vector<uint16_t> expected; // undimmed RGB565 of every pixel
+};
+
+static uint16_t get16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+static uint32_t get32(const uint8_t *data) { return get16(data) | ((uint32_t)get16(data + 2) << 16); }
+
+static uint16_t rgbTo565(uint32_t rgb) { return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F); }
+
+// 0xRRGGBB of a pixel of a BMP line
+static uint32_t pixelRgb(const BenchImage &image, const uint8_t *line, int16_t col)
+{
+  if (image.bitDepth == 24)
+  {
+    return (line[col * 3 + 2] << 16) | (line[col * 3 + 1] << 8) | line[col * 3];
+  }
+  uint8_t perByte = 8 / image.bitDepth;
+  uint8_t shift = (perByte - 1 - (col % perByte)) * image.bitDepth;
+  return image.palette[(line[col / perByte] >> shift) & ((1 << image.bitDepth) - 1)] & 0xFFFFFF;
+}
+
+static void fillExpected(BenchImage &image)
+{
+  image.expected.resize(image.w * image.h);
+  for (int16_t row = 0; row < image.h; row++)
+  {
+    const uint8_t *line = &image.lines[row * image.lineSize];
+    for (int16_t col = 0; col < image.w; col++)
+    {
+      uint16_t color;
+      if (image.bitDepth == 16)
+        color = image.swapped ? (line[col * 2] << 8) | line[col * 2 + 1] : line[col * 2] | (line[col * 2 + 1] << 8);
+      else
+        color = rgbTo565(pixelRgb(image, line, col));
+      image.expected[row * image.w + col] = color;
+    }
+  }
+}
+
+static bool loadBmp(const std::string &path, BenchImage &image)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool read = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  if (!read || data.size() < 54 || get16(&data[0]) != 0x4D42 || get32(&data[30]) != 0)
+  {
+    return false;
+  }
+  uint32_t offset = get32(&data[10]), headerSize = get32(&data[14]);
+  int32_t w = (int32_t)get32(&data[18]), h = (int32_t)get32(&data[22]);
+  image.bitDepth = get16(&data[28]);
+  image.swapped = false;
+  if ((image.bitDepth != 1 && image.bitDepth != 4 && image.bitDepth != 8 && image.bitDepth != 24) || w <= 0 || h <= 0 ||
+      w > TFT_WIDTH || h > TFT_HEIGHT)
+  {
+    return false;
+  }
+  image.w = w;
+  image.h = h;
+  image.lineSize = ((image.bitDepth * w + 31) >> 5) * 4;
+  memset(image.palette, 0, sizeof(image.palette));
+  if (image.bitDepth <= 8)
+  {
+    uint32_t paletteSize = get32(&data[46]) ? get32(&data[46]) : 1 << image.bitDepth;
+    if (paletteSize > (1UL << image.bitDepth) || 14 + headerSize + paletteSize * 4 > data.size())
+    {
+      return false;
+    }
+    memcpy(image.palette, &data[14 + headerSize], paletteSize * 4);
+  }
+  if (offset > data.size() || image.lineSize * h > data.size() - offset)
+  {
+    return false;
+  }
+  image.lines.assign(data.begin() + offset, data.begin() + offset + image.lineSize * h);
+  fillExpected(image);
+  return true;
+}
+
+// The same pixels in another format: 1 bit (black and white by the green channel), 16 bit (CLK or bundle) or 24 bit.
+static BenchImage convert(const BenchImage &source, uint16_t bitDepth, bool swapped)
+{
+  BenchImage image;
+  image.bitDepth = bitDepth;
+  image.swapped = swapped;
+  image.w = source.w;
+  image.h = source.h;
+  image.lineSize = bitDepth == 16 ? source.w * 2 : ((bitDepth * source.w + 31) >> 5) * 4;
+  memset(image.palette, 0, sizeof(image.palette));
+  image.palette[1] = 0xFFFFFF;
+  image.lines.assign(image.lineSize * image.h, 0);
+  for (int16_t row = 0; row < image.h; row++)
+  {
+    uint8_t *line = &image.lines[row * image.lineSize];
+    for (int16_t col = 0; col < image.w; col++)
+    {
+      uint32_t rgb = pixelRgb(source, &source.lines[row * source.lineSize], col);
+      uint16_t color = rgbTo565(rgb);
+      if (bitDepth == 1)
+      {
+        line[col / 8] |= (((rgb >> 8) & 0xFF) >= 0x80) << (7 - col % 8);
+      }
+      else if (bitDepth == 16)
+      {
+        line[col * 2] = swapped ? color >> 8 : color;
+        line[col * 2 + 1] = swapped ? color : color >> 8;
+      }
+      else
+      {
+        line[col * 3] = rgb;
+        line[col * 3 + 1] = rgb >> 8;
+        line[col * 3 + 2] = rgb >> 16;
+      }
+    }
+  }
+  fillExpected(image);
+  return image;
+}
+
+// alphaBlend() of TFT_eSPI, which dimmed the BMP pixels before the dimming tables
+static uint16_t referenceAlphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc)
+{
+  uint16_t fgR = ((fgc >> 10) & 0x3E) + 1;
+  uint16_t fgG = ((fgc >> 4) & 0x7E) + 1;
+  uint16_t fgB = ((fgc << 1) & 0x3E) + 1;
+  uint16_t bgR = ((bgc >> 10) & 0x3E) + 1;
+  uint16_t bgG = ((bgc >> 4) & 0x7E) + 1;
+  uint16_t bgB = ((bgc << 1) & 0x3E) + 1;
+  uint16_t r = (((fgR * alpha) + (bgR * (255 - alpha))) >> 9);
+  uint16_t g = (((fgG * alpha) + (bgG * (255 - alpha))) >> 9);
+  uint16_t b = (((fgB * alpha) + (bgB * (255 - alpha))) >> 9);
+  return (r << 11) | (g << 5) | (b << 0);
+}
+
+// The per-pixel loops of the original firmware: bit depth checked for every pixel, alphaBlend() for dimmed BMP files,
+// multiply and shift per channel for dimmed CLK files. Pixels in the byte order of the CPU, pushImage() swapped them.
+static void referenceDecodeLine(const BenchImage &image, const uint8_t *line, uint16_t *dest, uint8_t dimming)
+{
+  const uint8_t *bptr = line;
+  uint16_t r, g, b;
+  if (image.bitDepth == 16)
+  {
+    for (int16_t col = 0; col < image.w; col++)
+    {
+      if (dimming == 255)
+      {
+        dest[col] = (line[col * 2 + 1] << 8) | (line[col * 2]);
+      }
+      else
+      {
+        uint8_t PixM = line[col * 2 + 1];
+        uint8_t PixL = line[col * 2];
+        r = (PixM) & 0xF8;
+        g = ((PixM << 5) | (PixL >> 3)) & 0xFC;
+        b = (PixL << 3) & 0xF8;
+        r *= dimming;
+        g *= dimming;
+        b *= dimming;
+        r = r >> 8;
+        g = g >> 8;
+        b = b >> 8;
+        dest[col] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+      }
+    }
+    return;
+  }
+  for (int16_t col = 0; col < image.w; col++)
+  {
+    if (image.bitDepth == 24)
+    {
+      b = *bptr++;
+      g = *bptr++;
+      r = *bptr++;
+    }
+    else
+    {
+      uint32_t c = 0;
+      if (image.bitDepth == 8)
+      {
+        c = image.palette[*bptr++];
+      }
+      else if (image.bitDepth == 4)
+      {
+        c = image.palette[(*bptr >> ((col & 0x01) ? 0 : 4)) & 0x0F];
+        if (col & 0x01)
+          bptr++;
+      }
+      else
+      {
+        c = image.palette[(*bptr >> (7 - (col & 0x07))) & 0x01];
+        if ((col & 0x07) == 0x07)
+          bptr++;
+      }
+      b = c;
+      g = c >> 8;
+      r = c >> 16;
+    }
+    uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xFF) >> 3);
+    if (dimming < 255)
+    {
+      color = referenceAlphaBlend(dimming, color, TFT_BLACK);
+    }
+    dest[col] = color;
+  }
+}
+
+// Friend of TFTs, to reach its decoders.
+class DecoderBench
+{
+public:
+  // Decodes all lines of the image with the decoder that TFTs picks for it, like LoadImageIntoBuffer() does.
+  static void decode(const BenchImage &image, bool dim, bool swap, uint16_t *dest)
+  {
+    TFTs::ImageInfo info;
+    info.w = image.w;
+    info.h = image.h;
+    info.x = info.y = 0;
+    info.bitDepth = image.bitDepth;
+    info.lineSize = image.lineSize;
+    info.dataOffset = 0;
+    info.bottomUp = false;
+    info.swapped = image.swapped;
+    memcpy(info.palette, image.palette, sizeof(info.palette));
+    tfts.SelectDecoder(info, dim, swap);
+    for (int16_t row = 0; row < image.h; row++)
+    {
+      tfts.DecodeLine(info, &image.lines[row * image.lineSize], &dest[row * image.w]);
+    }
+  }
+  static void setDimming(uint8_t dimming) { tfts.dimmer.setLevel(dimming); }
+};
+
+static void referenceDecode(const BenchImage &image, uint8_t dimming, uint16_t *dest)
+{
+  for (int16_t row = 0; row < image.h; row++)
+  {
+    referenceDecodeLine(image, &image.lines[row * image.lineSize], &dest[row * image.w], dimming);
+  }
+}
+
+// Decodes all images until BENCH_MIN_MS have passed, returns million pixels per second.
+template <typename Decode>
+static double megapixelsPerSecond(const std::vector<BenchImage> &images, Decode decode)
+{
+  uint64_t pixels = 0;
+  double ms = 0;
+  auto start = std::chrono::steady_clock::now();
+  do
+  {
+    for (const BenchImage &image : images)
+    {
+      decode(image);
+      pixels += image.w * image.h;
+    }
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  } while (ms < BENCH_MIN_MS);
+  return pixels / (ms * 1000.0);
+}
+
+bool benchmarkDecoders()
+{
+  std::string folder = NativeHardware::getSpiffsRoot();
+  std::vector<BenchImage> files;
+  DIR *dir = opendir(folder.c_str());
+  while (dir != NULL)
+  {
+    struct dirent *entry = readdir(dir);
+    if (entry == NULL)
+    {
+      closedir(dir);
+      break;
+    }
+    std::string name = entry->d_name;
+    BenchImage image;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bmp") == 0 && loadBmp(folder + "/" + name, image))
+    {
+      files.push_back(image);
+    }
+  }
+  if (files.empty())
+  {
+    printf("No BMP files in \"%s\"!\n", folder.c_str());
+    return false;
+  }
+
+  struct Decoder
+  {
+    const char *name;
+    uint16_t bitDepth;
+    bool swapped;
+    bool hasReference; // the original firmware had a decoder for it
+    std::vector<BenchImage> images;
+  } decoders[] = {
+      {"BMP 1 bit", 1, false, true, {}},
+      {"BMP 4 bit", 4, false, true, {}},
+      {"BMP 8 bit", 8, false, true, {}},
+      {"BMP 24 bit", 24, false, true, {}},
+      {"CLK 16 bit", 16, false, true, {}},
+      {"bundle 16 bit", 16, true, false, {}},
+  };
+  for (Decoder &decoder : decoders)
+  {
+    for (const BenchImage &file : files)
+    {
+      if (decoder.bitDepth == 4 || decoder.bitDepth == 8)
+      {
+        if (file.bitDepth == decoder.bitDepth)
+          decoder.images.push_back(file);
+      }
+      else
+      {
+        decoder.images.push_back(convert(file, decoder.bitDepth, decoder.swapped));
+      }
+    }
+  }
+
+  static uint16_t pixels[TFT_WIDTH * TFT_HEIGHT];
+  bool passed = true;
+  printf("Decoder benchmark: %u BMP files of \"%s\", million pixels per second (host time, compare the ratio only)\n",
+         (unsigned)files.size(), folder.c_str());
+  printf("  before: per-pixel loop of the original firmware, after: TFTs decoder, incl. the byte swap for the display\n");
+  printf("  %-14s %7s %6s %9s %9s %9s\n", "decoder", "dimming", "images", "before", "after", "speed-up");
+  for (Decoder &decoder : decoders)
+  {
+    if (decoder.images.empty())
+    {
+      printf("  %-14s no images\n", decoder.name);
+      continue;
+    }
+    // undimmed, old and new decoder give the pixels of the file
+    uint32_t wrong = 0;
+    DecoderBench::setDimming(255);
+    for (const BenchImage &image : decoder.images)
+    {
+      DecoderBench::decode(image, false, false, pixels);
+      wrong += memcmp(pixels, image.expected.data(), image.expected.size() * 2) != 0;
+      if (decoder.hasReference)
+      {
+        referenceDecode(image, 255, pixels);
+        wrong += memcmp(pixels, image.expected.data(), image.expected.size() * 2) != 0;
+      }
+    }
+    if (wrong > 0)
+    {
+      printf("  %-14s %u images decoded wrong!\n", decoder.name, wrong);
+      passed = false;
+    }
+    for (uint8_t dimming : {(uint8_t)255, (uint8_t)BENCH_DIMMING})
+    {
+      bool dim = dimming < 255;
+      DecoderBench::setDimming(dimming);
+      double before = 0;
+      if (decoder.hasReference)
+      {
+        before = megapixelsPerSecond(decoder.images, [dimming](const BenchImage &image)
+                                     { referenceDecode(image, dimming, pixels); });
+      }
+      double after = megapixelsPerSecond(decoder.images, [dim](const BenchImage &image)
+                                         { DecoderBench::decode(image, dim, true, pixels); });
+      if (decoder.hasReference)
+        printf("  %-14s %7s %6u %9.1f %9.1f %8.2fx\n", decoder.name, dim ? "on" : "off", (unsigned)decoder.images.size(),
+               before, after, after / before);
+      else
+        printf("  %-14s %7s %6u %9s %9.1f %9s\n", decoder.name, dim ? "on" : "off", (unsigned)decoder.images.size(), "-",
+               after, "-");
+    }
+  }
+  DecoderBench::setDimming(255);
+  return passed;
+}
@@ -0,0 +1,18 @@
+#ifndef NATIVE_DECODER_BENCH_H
+#define NATIVE_DECODER_BENCH_H
+
+#include <Arduino.h>
+
+/*
+ * Benchmark of the line decoders of TFTs (see TFTs::SelectDecoder()). The pixels of the BMP files of the data folder are
+ * converted into the input of every decoder (1, 4, 8 and 24 bit BMP, CLK and bundle RGB565), each is decoded with
+ * dimming off and on, and the pixels per second are reported: before, by the per-pixel loop of the original firmware
+ * (bit depth checked per pixel, alphaBlend() for the dimming), and after, by the decoder that SelectDecoder() picks
+ * (dimming tables, one template instance per format). Host time, so only the ratio tells something about the ESP32.
+ * Undimmed, both have to give the same pixels.
+ */
+
+// Returns true, if there were BMP files and every decoder gave the expected pixels.
+bool benchmarkDecoders();
+
+#endif // NATIVE_DECODER_BENCH_H
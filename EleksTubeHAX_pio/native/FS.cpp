@@ -0,0 +1,73 @@
+#include "SPIFFS.h"
+#include "NativeHardware.h"
+#include <sys/stat.h>
+
+fs::SPIFFSFS SPIFFS;
+
+static std::string spiffsRoot = "data";
+
+void NativeHardware::setSpiffsRoot(const char *path) { spiffsRoot = path; }
+const char *NativeHardware::getSpiffsRoot() { return spiffsRoot.c_str(); }
+
+static std::string hostPath(const char *path)
+{
+  return spiffsRoot + (path[0] == '/' ? "" : "/") + path;
+}
+
+size_t fs::File::size() const
+{
+  if (!handle)
+  {
+    return 0;
+  }
+  struct stat info;
+  return fstat(fileno(handle.get()), &info) == 0 ? info.st_size : 0;
+}
+
+int fs::File::peek()
+{
+  int c = read();
+  if (c >= 0)
+  {
+    seek(position() - 1);
+  }
+  return c;
+}
+
+String fs::File::readStringUntil(char terminator)
+{
+  std::string line;
+  int c;
+  while ((c = read()) >= 0 && c != terminator)
+  {
+    line += (char)c;
+  }
+  return String(line);
+}
+
+fs::File fs::FS::open(const char *path, const char *mode)
+{
+  std::string name = hostPath(path);
+  struct stat info;
+  if (stat(name.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+  {
+    return File(NULL, true);
+  }
+  const char *hostMode = (mode[0] == 'w') ? "wb" : (mode[0] == 'a') ? "ab" : "rb";
+  FILE *handle = fopen(name.c_str(), hostMode);
+  return handle ? File(handle) : File();
+}
+
+bool fs::FS::exists(const char *path)
+{
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool fs::FS::remove(const char *path) { return ::remove(hostPath(path).c_str()) == 0; }
+
+bool fs::SPIFFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+{
+  struct stat info;
+  return stat(spiffsRoot.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
@@ -0,0 +1,67 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+/*
+ * File system for the native build: files of a host directory (see NativeHardware::setSpiffsRoot()).
+ * Like on the ESP32, copies of a File share the open file.
+ */
+
+namespace fs
+{
+  enum SeekMode
+  {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+  };
+
+  class File : public Stream
+  {
+  public:
+    File() {}
+    explicit File(FILE *handle, bool directory = false) : handle(handle, fclose), directory(directory) {}
+
+    operator bool() const { return handle != nullptr || directory; }
+    bool isDirectory() const { return directory; }
+    void close()
+    {
+      handle.reset();
+      directory = false;
+    }
+
+    size_t size() const;
+    size_t position() const { return handle ? ftell(handle.get()) : 0; }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return handle && fseek(handle.get(), pos, mode) == 0; }
+    size_t read(uint8_t *buf, size_t size) { return handle ? fread(buf, 1, size, handle.get()) : 0; }
+    int read() override
+    {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+    int peek() override;
+    int available() override { return handle ? (int)(size() - position()) : 0; }
+    String readStringUntil(char terminator);
+    size_t write(uint8_t c) override { return handle ? fwrite(&c, 1, 1, handle.get()) : 0; }
+    size_t write(const uint8_t *buf, size_t size) override { return handle ? fwrite(buf, 1, size, handle.get()) : 0; }
+    using Print::write;
+
+  private:
+    std::shared_ptr<FILE> handle;
+    bool directory = false;
+  };
+
+  class FS
+  {
+  public:
+    File open(const char *path, const char *mode = "r");
+    File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+  };
+} // namespace fs
+
+#endif // NATIVE_FS_H
@@ -0,0 +1,269 @@
+#include "GoldenFrames.h"
+#include "GLOBAL_DEFINES.h"
+#include "TFTs.h"
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// dimming levels the frames are drawn with: none, half and the night mode
+static const uint8_t goldenDimmingLevels[] = {255, 128, TFT_DIMMED_INTENSITY};
+
+uint32_t frameChecksum(const uint16_t *pixels)
+{
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < (uint32_t)TFT_WIDTH * TFT_HEIGHT; i++)
+  {
+    hash = (hash ^ (pixels[i] & 0xFF)) * 16777619u;
+    hash = (hash ^ (pixels[i] >> 8)) * 16777619u;
+  }
+  return hash;
+}
+
+// ************ PNG *********************
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+  static uint32_t table[256];
+  if (table[1] == 0)
+  {
+    for (uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for (uint8_t k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+  }
+  crc = ~crc;
+  while (length--)
+    crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t value)
+{
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+static void writeChunk(FILE *file, const char *type, const std::vector<uint8_t> &data)
+{
+  std::vector<uint8_t> chunk;
+  put32(chunk, data.size());
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  put32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+  fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+bool writePng(const char *path, const uint16_t *pixels, uint16_t width, uint16_t height)
+{
+  // raw lines: filter type 0, then RGB888 expanded from RGB565
+  std::vector<uint8_t> raw;
+  raw.reserve(height * (1 + width * 3));
+  for (uint16_t y = 0; y < height; y++)
+  {
+    raw.push_back(0);
+    for (uint16_t x = 0; x < width; x++)
+    {
+      uint16_t color = pixels[y * width + x];
+      uint8_t r = (color >> 11) & 0x1F, g = (color >> 5) & 0x3F, b = color & 0x1F;
+      raw.push_back((r << 3) | (r >> 2));
+      raw.push_back((g << 2) | (g >> 4));
+      raw.push_back((b << 3) | (b >> 2));
+    }
+  }
+
+  // zlib stream with stored (uncompressed) deflate blocks
+  std::vector<uint8_t> zlib = {0x78, 0x01};
+  for (size_t pos = 0; pos < raw.size();)
+  {
+    uint16_t length = std::min(raw.size() - pos, (size_t)0xFFFF);
+    bool last = pos + length == raw.size();
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back(length & 0xFF);
+    zlib.push_back(length >> 8);
+    zlib.push_back(~length & 0xFF);
+    zlib.push_back((~length >> 8) & 0xFF);
+    zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+    pos += length;
+  }
+  uint32_t a = 1, b = 0; // Adler-32
+  for (uint8_t byte : raw)
+  {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  put32(zlib, (b << 16) | a);
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  fwrite(signature, 1, sizeof(signature), file);
+  std::vector<uint8_t> header;
+  put32(header, width);
+  put32(header, height);
+  header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit, RGB, deflate, no filter, no interlace
+  writeChunk(file, "IHDR", header);
+  writeChunk(file, "IDAT", zlib);
+  writeChunk(file, "IEND", {});
+  return fclose(file) == 0;
+}
+
+// ************ golden frames *********************
+
+static std::map<std::string, uint32_t> readGoldenFile(const char *path)
+{
+  std::map<std::string, uint32_t> hashes;
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return hashes;
+  }
+  char line[128], name[64];
+  unsigned int hash;
+  while (fgets(line, sizeof(line), file))
+  {
+    if (line[0] != '#' && sscanf(line, "%63s %x", name, &hash) == 2)
+    {
+      hashes[name] = hash;
+    }
+  }
+  fclose(file);
+  return hashes;
+}
+
+// reference | actual | changed pixels in red over the dark actual frame
+static bool writeDiffPng(const char *path, const std::vector<uint16_t> &reference, const uint16_t *actual)
+{
+  const uint32_t pixels = TFT_WIDTH * TFT_HEIGHT;
+  if (reference.size() != pixels)
+  {
+    return writePng(path, actual, TFT_WIDTH, TFT_HEIGHT);
+  }
+  std::vector<uint16_t> image(pixels * 3);
+  for (uint32_t y = 0; y < TFT_HEIGHT; y++)
+  {
+    for (uint32_t x = 0; x < TFT_WIDTH; x++)
+    {
+      uint32_t i = y * TFT_WIDTH + x;
+      uint16_t *row = &image[y * TFT_WIDTH * 3];
+      row[x] = reference[i];
+      row[TFT_WIDTH + x] = actual[i];
+      row[2 * TFT_WIDTH + x] = (reference[i] != actual[i]) ? TFT_RED : (actual[i] >> 2) & 0x39E7;
+    }
+  }
+  return writePng(path, image.data(), TFT_WIDTH * 3, TFT_HEIGHT);
+}
+
+bool checkGoldenFrames(const char *goldenFile, bool update, const char *diffDir)
+{
+  std::map<std::string, uint32_t> golden = readGoldenFile(goldenFile);
+  if (!update && golden.empty())
+  {
+    printf("No golden frames in \"%s\", create them with --update-golden.\n", goldenFile);
+    return false;
+  }
+  std::string referenceDir = std::string(diffDir) + "/reference";
+  if (update)
+  {
+    mkdir(diffDir, 0755);
+    mkdir(referenceDir.c_str(), 0755);
+  }
+
+  uint8_t savedGraphic = tfts.current_graphic;
+  uint8_t savedDimming = tfts.dimming;
+  std::string lines;
+  uint32_t frames = 0, changed = 0;
+  char name[64], line[96];
+  for (uint8_t face = 1; face <= tfts.NumberOfClockFaces; face++)
+  {
+    for (uint8_t value = 0; value < 10; value++)
+    {
+      for (uint8_t level : goldenDimmingLevels)
+      {
+        tfts.current_graphic = face;
+        tfts.dimming = level;
+        tfts.setDigit(SECONDS_ONES, value, TFTs::force);
+        const uint16_t *pixels = TFT_eSPI::getFramebuffer(SECONDS_ONES);
+        uint32_t hash = frameChecksum(pixels);
+        snprintf(name, sizeof(name), "face%u_digit%u_dim%u", face, value, level);
+        snprintf(line, sizeof(line), "%s %08X\n", name, hash);
+        lines += line;
+        frames++;
+
+        std::string reference = referenceDir + "/" + name + ".rgb565";
+        if (update)
+        {
+          FILE *file = fopen(reference.c_str(), "wb");
+          if (file)
+          {
+            fwrite(pixels, sizeof(uint16_t), TFT_WIDTH * TFT_HEIGHT, file);
+            fclose(file);
+          }
+          continue;
+        }
+
+        auto expected = golden.find(name);
+        if (expected != golden.end() && expected->second == hash)
+        {
+          golden.erase(expected);
+          continue;
+        }
+        changed++;
+        std::vector<uint16_t> referencePixels(TFT_WIDTH * TFT_HEIGHT);
+        FILE *file = fopen(reference.c_str(), "rb");
+        if (file == NULL || fread(referencePixels.data(), sizeof(uint16_t), referencePixels.size(), file) != referencePixels.size())
+        {
+          referencePixels.clear();
+        }
+        if (file)
+        {
+          fclose(file);
+        }
+        mkdir(diffDir, 0755);
+        std::string png = std::string(diffDir) + "/" + name + ".png";
+        writeDiffPng(png.c_str(), referencePixels, pixels);
+        if (expected == golden.end())
+        {
+          printf("  %s: %08X, no golden frame, see %s\n", name, hash, png.c_str());
+        }
+        else
+        {
+          printf("  %s: %08X instead of %08X, see %s\n", name, hash, expected->second, png.c_str());
+          golden.erase(expected);
+        }
+      }
+    }
+  }
+  tfts.current_graphic = savedGraphic;
+  tfts.dimming = savedDimming;
+
+  if (update)
+  {
+    FILE *file = fopen(goldenFile, "w");
+    if (file == NULL)
+    {
+      printf("Can't write \"%s\"!\n", goldenFile);
+      return false;
+    }
+    fprintf(file, "# Golden frames of the clock faces: name (clock face, digit, dimming) and FNV-1a hash of the display.\n");
+    fprintf(file, "# Written by the native build with --update-golden, see native/GoldenFrames.h\n");
+    fputs(lines.c_str(), file);
+    fclose(file);
+    printf("Golden frames: %u frames written to \"%s\"\n", frames, goldenFile);
+    return true;
+  }
+  for (auto &missing : golden)
+  {
+    printf("  %s: golden frame not drawn (clock face missing?)\n", missing.first.c_str());
+  }
+  printf("Golden frames: %u checked, %u changed, %u missing\n", frames, changed, (uint32_t)golden.size());
+  return changed == 0 && golden.empty();
+}
@@ -0,0 +1,24 @@
+#ifndef NATIVE_GOLDEN_FRAMES_H
+#define NATIVE_GOLDEN_FRAMES_H
+
+#include <Arduino.h>
+
+/*
+ * Golden frames of the native build: every digit of every clock face is drawn at several dimming levels through the real
+ * TFTs code (decoder, image cache, dimming, SPI push) and the resulting framebuffer is hashed. The hashes are compared
+ * with a stored list, so changes to the decoders or the dimming that alter the output are found.
+ */
+
+// FNV-1a over the RGB565 pixels of a display framebuffer, TFT_WIDTH x TFT_HEIGHT
+uint32_t frameChecksum(const uint16_t *pixels);
+
+// Writes RGB565 pixels as an uncompressed 8 bit RGB PNG file.
+bool writePng(const char *path, const uint16_t *pixels, uint16_t width, uint16_t height);
+
+// Checks all frames against the hashes in goldenFile, or rewrites the file if update is set.
+// Changed frames are written as PNG files to diffDir: the actual frame, or if diffDir/reference holds the frame from the
+// last update (raw RGB565), the reference, the actual frame and the changed pixels side by side.
+// Returns true, if all frames match (or the file was written).
+bool checkGoldenFrames(const char *goldenFile, bool update, const char *diffDir);
+
+#endif // NATIVE_GOLDEN_FRAMES_H
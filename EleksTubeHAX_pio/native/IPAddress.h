@@ -0,0 +1,25 @@
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress
+{
+public:
+  IPAddress() : address{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address{a, b, c, d} {}
+  // address in network byte order, like lwIP keeps it
+  IPAddress(uint32_t address) : address{(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)} {}
+  uint8_t operator[](int index) const { return address[index]; }
+  String toString() const
+  {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+    return String(buffer);
+  }
+
+private:
+  uint8_t address[4];
+};
+
+#endif // NATIVE_IPADDRESS_H
@@ -0,0 +1,277 @@
+#include "ImageFuzzer.h"
+#include "NativeHardware.h"
+#include "GLOBAL_DEFINES.h"
+#include "TFTs.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define FUZZ_HEADER_BYTES (64) // most mutations go to the headers, where the values are that are checked
+#define FUZZ_MAX_REPORTED_ERRORS (20)
+
+static uint32_t fuzzRandomState;
+
+// xorshift32, the same sequence for the same seed on every host
+static uint32_t fuzzRandom(uint32_t range)
+{
+  fuzzRandomState ^= fuzzRandomState << 13;
+  fuzzRandomState ^= fuzzRandomState >> 17;
+  fuzzRandomState ^= fuzzRandomState << 5;
+  return range > 0 ? fuzzRandomState % range : 0;
+}
+
+static bool readHostFile(const std::string &path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+static bool writeHostFile(const std::string &path, const std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return fclose(file) == 0 && ok;
+}
+
+// Copies the files of the folder from to the folder to, returns the names.
+static std::vector<std::string> copyFolder(const std::string &from, const std::string &to)
+{
+  std::vector<std::string> names;
+  DIR *dir = opendir(from.c_str());
+  if (dir == NULL)
+  {
+    return names;
+  }
+  std::vector<uint8_t> data;
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    struct stat info;
+    if (stat((from + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode) && readHostFile(from + "/" + name, data) &&
+        writeHostFile(to + "/" + name, data))
+    {
+      names.push_back(name);
+    }
+  }
+  closedir(dir);
+  return names;
+}
+
+// name of the file that holds the image of the digit
+static std::string imageFileName(uint8_t face, uint8_t digit)
+{
+  char name[16];
+#if defined(USE_FACE_BUNDLES)
+  snprintf(name, sizeof(name), "%u.fcb", face);
+#elif defined(USE_CLK_FILES)
+  snprintf(name, sizeof(name), "%u.clk", face * 10 + digit);
+#else
+  snprintf(name, sizeof(name), "%u.bmp", face * 10 + digit);
+#endif
+  return name;
+}
+
+static void mutate(std::vector<uint8_t> &data)
+{
+  static const uint32_t interesting[] = {0, 1, 0x7F, 0x80, 0xFF, 0x100, 0x7FFF, 0x8000, 0xFFFF, 0x10000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+#ifdef USE_FACE_BUNDLES
+  uint32_t headerBytes = FACE_BUNDLE_HEADER_SIZE;
+#else
+  uint32_t headerBytes = FUZZ_HEADER_BYTES;
+#endif
+  headerBytes = min((uint32_t)data.size(), headerBytes);
+  if (data.empty())
+  {
+    return;
+  }
+  switch (fuzzRandom(4))
+  {
+  case 0: // flip some bits in the header
+    for (uint32_t n = 1 + fuzzRandom(4); n > 0; n--)
+    {
+      data[fuzzRandom(headerBytes)] ^= 1 << fuzzRandom(8);
+    }
+    break;
+  case 1: // a value that is often not checked, as 16 or 32 bit field in the header
+  {
+    uint32_t value = interesting[fuzzRandom(sizeof(interesting) / sizeof(interesting[0]))];
+    uint8_t bytes = fuzzRandom(2) ? 4 : 2;
+    uint32_t offset = fuzzRandom(headerBytes);
+    for (uint8_t i = 0; i < bytes && offset + i < data.size(); i++)
+    {
+      data[offset + i] = value >> (8 * i);
+    }
+    break;
+  }
+  case 2: // truncated
+    data.resize(fuzzRandom(data.size()));
+    break;
+  default: // random bytes anywhere
+    for (uint32_t n = 1 + fuzzRandom(16); n > 0; n--)
+    {
+      data[fuzzRandom(data.size())] = fuzzRandom(256);
+    }
+    break;
+  }
+}
+
+struct LoadTimes
+{
+  uint32_t count = 0;
+  double totalUs = 0;
+  double maxUs = 0;
+  void add(double us)
+  {
+    count++;
+    totalUs += us;
+    maxUs = std::max(maxUs, us);
+  }
+  void print(const char *label)
+  {
+    printf("  %-10s %6u, %8.1f us avg, %8.1f us max\n", label, count, count ? totalUs / count : 0.0, maxUs);
+  }
+};
+
+// Loads and draws the image on the SECONDS_ONES display, returns true if the image was loaded.
+static bool drawImage(uint8_t face, uint8_t digit, double &us)
+{
+  uint32_t loads = renderStats.getFace(face).loads;
+  tfts.InvalidateImageInBuffer();
+  tfts.current_graphic = face;
+  auto start = std::chrono::steady_clock::now();
+  tfts.setDigit(SECONDS_ONES, digit, TFTs::force);
+  us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  return renderStats.getFace(face).loads != loads;
+}
+
+// true, if the displays other than SECONDS_ONES still show the pixels of before
+static bool otherDisplaysUnchanged(const std::vector<uint16_t> &before)
+{
+  const uint32_t pixels = TFT_WIDTH * TFT_HEIGHT;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (digit != SECONDS_ONES && memcmp(TFT_eSPI::getFramebuffer(digit), &before[digit * pixels], pixels * 2) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool fuzzImageLoaders(uint32_t iterations, uint32_t seed)
+{
+#ifdef USE_FACE_PARTITION
+  printf("The fuzzer doesn't support USE_FACE_PARTITION, the partition is only checked at boot.\n");
+  return false;
+#else
+  char folder[] = "/tmp/elekstubehax_fuzz_XXXXXX";
+  if (mkdtemp(folder) == NULL)
+  {
+    printf("Can't create a temporary folder!\n");
+    return false;
+  }
+  std::string source = NativeHardware::getSpiffsRoot();
+  std::vector<std::string> copied = copyFolder(source, folder);
+  NativeHardware::setSpiffsRoot(folder);
+  fuzzRandomState = seed ? seed : 1;
+
+  uint8_t savedGraphic = tfts.current_graphic;
+  uint8_t savedDimming = tfts.dimming;
+  tfts.dimming = 255;
+
+  // throughput of the original files
+  LoadTimes originals;
+  uint64_t originalBytes = 0;
+  for (uint8_t face = 1; face <= tfts.NumberOfClockFaces; face++)
+  {
+    for (uint8_t digit = 0; digit < 10; digit++)
+    {
+      double us;
+      if (drawImage(face, digit, us))
+      {
+        struct stat info;
+        std::string path = std::string(folder) + "/" + imageFileName(face, digit);
+        originalBytes += stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+        originals.add(us);
+      }
+    }
+  }
+#ifdef USE_FACE_BUNDLES
+  originalBytes /= 10; // every image opens the whole bundle
+#endif
+
+  // mutated files, one at a time, the original is restored afterwards
+  LoadTimes accepted, rejected;
+  uint32_t errors = 0;
+  std::vector<uint16_t> before(NUM_DIGITS * TFT_WIDTH * TFT_HEIGHT);
+  std::vector<uint8_t> original, mutated;
+  for (uint32_t i = 0; i < iterations && tfts.NumberOfClockFaces > 0; i++)
+  {
+    uint8_t face = 1 + fuzzRandom(tfts.NumberOfClockFaces);
+    uint8_t digit = fuzzRandom(10);
+    std::string path = std::string(folder) + "/" + imageFileName(face, digit);
+    if (!readHostFile(path, original))
+    {
+      continue;
+    }
+    mutated = original;
+    mutate(mutated);
+    writeHostFile(path, mutated);
+
+    for (uint8_t d = 0; d < NUM_DIGITS; d++)
+    {
+      memcpy(&before[d * TFT_WIDTH * TFT_HEIGHT], TFT_eSPI::getFramebuffer(d), TFT_WIDTH * TFT_HEIGHT * 2);
+    }
+    double us;
+    if (drawImage(face, digit, us))
+      accepted.add(us);
+    else
+      rejected.add(us);
+    if (!otherDisplaysUnchanged(before) && errors++ < FUZZ_MAX_REPORTED_ERRORS)
+    {
+      std::string kept = std::string(folder) + "/broken_" + std::to_string(i) + "_" + imageFileName(face, digit);
+      writeHostFile(kept, mutated);
+      printf("  iteration %u: %s changed other displays, kept as %s\n", i, imageFileName(face, digit).c_str(), kept.c_str());
+    }
+    writeHostFile(path, original);
+  }
+
+  tfts.InvalidateImageInBuffer();
+  tfts.current_graphic = savedGraphic;
+  tfts.dimming = savedDimming;
+  NativeHardware::setSpiffsRoot(source.c_str());
+  if (errors == 0)
+  { // keep the folder only to look at the broken files
+    for (const std::string &name : copied)
+    {
+      unlink((std::string(folder) + "/" + name).c_str());
+    }
+    rmdir(folder);
+  }
+
+  printf("Image loader fuzzing, %u iterations, seed %u:\n", iterations, seed);
+  originals.print("original:");
+  printf("  %-10s %6.1f MB/s of file data, %.0f images/s\n", "", originals.totalUs > 0 ? originalBytes / originals.totalUs : 0.0,
+         originals.totalUs > 0 ? originals.count * 1e6 / originals.totalUs : 0.0);
+  accepted.print("accepted:");
+  rejected.print("rejected:");
+  printf("  %u mutated files changed other displays\n", errors);
+  return errors == 0;
+#endif
+}
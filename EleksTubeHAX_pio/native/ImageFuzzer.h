@@ -0,0 +1,17 @@
+#ifndef NATIVE_IMAGE_FUZZER_H
+#define NATIVE_IMAGE_FUZZER_H
+
+#include <Arduino.h>
+
+/*
+ * Fuzzer for the image loaders of the native build. Works on a copy of the clock faces in a temporary folder: first
+ * every original image is loaded to measure the throughput, then mutated copies (bit flips, odd header values,
+ * truncation) of random images are drawn through the real TFTs code. Broken files have to be rejected or drawn, without
+ * touching the displays that were not selected. Build with -fsanitize=address to find reads and writes out of bounds.
+ * The format is the one of the build: BMP, CLK files (USE_CLK_FILES) or bundles (USE_FACE_BUNDLES).
+ */
+
+// Returns true, if no mutated file changed a display that was not selected.
+bool fuzzImageLoaders(uint32_t iterations, uint32_t seed);
+
+#endif // NATIVE_IMAGE_FUZZER_H
@@ -0,0 +1,447 @@
+#include "NativeHardware.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "esp_partition.h"
+#include "lwip/dns.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+WiFiClass WiFi;
+TwoWire Wire;
+TwoWire Wire1;
+
+// ************ RTC *********************
+
+#define DS3231_ADDRESS 0x68
+#define DS3231_AGING_OFFSET 0x10
+#define DS3231_REGISTERS 0x13
+
+static bool rtcSet = false;
+static uint64_t rtcMicrosAtSet = 0; // virtual time when the RTC was set or changed its rate
+static uint64_t rtcUsAtSet = 0;     // RTC time then, us since 1970
+static int32_t rtcDriftPpb = 0;
+static uint8_t ds3231Registers[DS3231_REGISTERS];
+static uint8_t ds3231Pointer = 0;
+
+static int64_t rtcRatePpb() { return rtcDriftPpb - (int8_t)ds3231Registers[DS3231_AGING_OFFSET] * 100LL; }
+
+static uint64_t rtcNowUs()
+{
+  uint64_t elapsed = NativeHardware::getMicros() - rtcMicrosAtSet;
+  return rtcUsAtSet + elapsed + (int64_t)elapsed * rtcRatePpb() / 1000000000LL;
+}
+
+void NativeHardware::setRtcTime(uint32_t unixtime)
+{
+  rtcUsAtSet = (uint64_t)unixtime * 1000000;
+  rtcMicrosAtSet = getMicros();
+  rtcSet = true;
+}
+
+uint32_t NativeHardware::getRtcTime()
+{
+  return (uint32_t)(rtcNowUs() / 1000000);
+}
+
+uint64_t NativeHardware::getRtcMicros(uint32_t unixtime)
+{
+  int64_t rtcUs = (int64_t)((uint64_t)unixtime * 1000000 - rtcUsAtSet);
+  return rtcMicrosAtSet + rtcUs - rtcUs * rtcRatePpb() / (1000000000LL + rtcRatePpb());
+}
+
+void NativeHardware::setRtcDrift(int32_t ppb) { rtcDriftPpb = ppb; }
+int8_t NativeHardware::getRtcAgingOffset() { return (int8_t)ds3231Registers[DS3231_AGING_OFFSET]; }
+
+bool NativeHardware::writeI2c(uint8_t address, const uint8_t *data, size_t size)
+{
+  if (address != DS3231_ADDRESS)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    if (i == 0)
+    { // register address
+      ds3231Pointer = data[0] % DS3231_REGISTERS;
+      continue;
+    }
+    if (ds3231Pointer == DS3231_AGING_OFFSET)
+    { // the RTC changes its rate from now on
+      rtcUsAtSet = rtcNowUs();
+      rtcMicrosAtSet = getMicros();
+    }
+    ds3231Registers[ds3231Pointer] = data[i];
+    ds3231Pointer = (ds3231Pointer + 1) % DS3231_REGISTERS;
+  }
+  return true;
+}
+
+size_t NativeHardware::readI2c(uint8_t address, uint8_t *data, size_t size)
+{
+  if (address != DS3231_ADDRESS)
+  {
+    return 0;
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    data[i] = ds3231Registers[ds3231Pointer];
+    ds3231Pointer = (ds3231Pointer + 1) % DS3231_REGISTERS;
+  }
+  return size;
+}
+
+bool NativeHardware::isRtcSet() { return rtcSet; }
+
+// ************ network *********************
+
+#define NTP_PACKET_BYTES 48
+#define NTP_UNIX_OFFSET 2208988800ULL // seconds from 1900 to 1970
+#define NATIVE_FALSETICKER_MS 2500
+
+static uint32_t trueTimeAtSet = 0;
+static uint64_t trueMicrosAtSet = 0;
+static bool wifiConnected = false;
+static uint32_t ntpDelayMs = 0;
+static uint32_t ntpLossEvery = 0;
+static uint32_t ntpJitterMs = 0;
+static uint32_t ntpBogusEvery = 0;
+static uint8_t ntpFalseticker = 0;
+static uint32_t ntpRequests = 0;
+static uint32_t ntpLost = 0;
+static uint32_t ntpBogus = 0;
+static uint32_t jitterState = 1; // xorshift, the same jitter in every run
+static std::vector<std::string> ntpServers; // host names, in the order of the first request
+
+struct UdpReply
+{
+  uint64_t at; // virtual micros
+  std::vector<uint8_t> data;
+};
+static std::vector<UdpReply> udpReplies;
+
+static uint32_t dnsDelayMs = 0;
+static uint32_t dnsFailEvery = 0;
+static uint32_t dnsLookups = 0;
+static uint32_t dnsFailed = 0;
+static std::vector<std::string> dnsHosts; // host names, in the order of the first lookup
+
+struct DnsLookup
+{
+  uint64_t at; // virtual micros
+  std::string host;
+  bool found;
+  uint32_t address;
+  dns_found_callback callback;
+  void *callbackArg;
+};
+static std::vector<DnsLookup> dnsLookupsPending;
+
+void NativeHardware::setTrueTime(uint32_t unixtime)
+{
+  trueTimeAtSet = unixtime;
+  trueMicrosAtSet = getMicros();
+}
+
+uint64_t NativeHardware::getTrueMicros() { return (uint64_t)trueTimeAtSet * 1000000 + (getMicros() - trueMicrosAtSet); }
+
+uint64_t NativeHardware::getTrueSecondMicros(uint32_t unixtime)
+{
+  return trueMicrosAtSet + (int64_t)(int32_t)(unixtime - trueTimeAtSet) * 1000000;
+}
+
+void NativeHardware::setNetwork(bool connected, uint32_t delayMs, uint32_t lossEvery)
+{
+  wifiConnected = connected;
+  ntpDelayMs = delayMs;
+  ntpLossEvery = lossEvery;
+}
+
+void NativeHardware::setNtpFaults(uint32_t jitterMs, uint32_t bogusEvery, uint8_t falseticker)
+{
+  ntpJitterMs = jitterMs;
+  ntpBogusEvery = bogusEvery;
+  ntpFalseticker = falseticker;
+}
+
+bool NativeHardware::isWifiConnected() { return wifiConnected; }
+uint32_t NativeHardware::getNtpRequests() { return ntpRequests; }
+uint32_t NativeHardware::getNtpLost() { return ntpLost; }
+uint32_t NativeHardware::getNtpBogus() { return ntpBogus; }
+uint8_t NativeHardware::getNtpServers() { return ntpServers.size(); }
+
+// NTP timestamp: seconds since 1900 and the fraction in 1/2^32 s, big-endian
+static void putNtpTimestamp(uint8_t *dest, uint64_t unixMicros)
+{
+  uint32_t seconds = unixMicros / 1000000 + NTP_UNIX_OFFSET;
+  uint32_t fraction = ((unixMicros % 1000000) << 32) / 1000000;
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    dest[i] = seconds >> (24 - 8 * i);
+    dest[4 + i] = fraction >> (24 - 8 * i);
+  }
+}
+
+// 0..jitterMs ms, in us
+static uint32_t jitterMicros()
+{
+  jitterState ^= jitterState << 13;
+  jitterState ^= jitterState >> 17;
+  jitterState ^= jitterState << 5;
+  return ntpJitterMs > 0 ? jitterState % (ntpJitterMs * 1000 + 1) : 0;
+}
+
+static uint8_t serverNumber(const char *host)
+{
+  std::string name = host != NULL ? host : "";
+  for (size_t i = 0; i < ntpServers.size(); i++)
+  {
+    if (ntpServers[i] == name)
+    {
+      return i + 1;
+    }
+  }
+  ntpServers.push_back(name);
+  return ntpServers.size();
+}
+
+// Turns the reply into one the client has to reject, a different kind every time.
+static void makeBogus(std::vector<uint8_t> &reply)
+{
+  switch (ntpBogus++ % 5)
+  {
+  case 0: // not the reply to the request: wrong originate timestamp
+    reply[31] ^= 0x5A;
+    break;
+  case 1: // server not synchronized (LI 3)
+    reply[0] |= 0b11000000;
+    break;
+  case 2: // kiss-o'-death: stratum 0, "RATE"
+    reply[1] = 0;
+    memcpy(&reply[12], "RATE", 4);
+    break;
+  case 3: // transmit time in 1900
+    memset(&reply[40], 0, 8);
+    break;
+  case 4: // truncated
+    reply.resize(NTP_PACKET_BYTES / 2);
+    break;
+  }
+}
+
+// Every host is an NTP server (port 123) that answers like a stratum 1 server; the request and the reply take
+// delayMs / 2 each, plus up to jitterMs each, so the paths are not symmetric. The falseticker's clock is off by
+// NATIVE_FALSETICKER_MS.
+void NativeHardware::sendUdp(const char *host, uint16_t port, const uint8_t *data, size_t size)
+{
+  if (!wifiConnected || port != 123 || size < NTP_PACKET_BYTES)
+  {
+    return;
+  }
+  uint8_t server = serverNumber(host);
+  ntpRequests++;
+  if (ntpLossEvery > 0 && ntpRequests % ntpLossEvery == 0)
+  {
+    ntpLost++;
+    return;
+  }
+  uint32_t upMicros = ntpDelayMs * 500 + jitterMicros();
+  uint32_t downMicros = ntpDelayMs * 500 + jitterMicros();
+  uint64_t received = getTrueMicros() + upMicros;
+  if (server == ntpFalseticker)
+  {
+    received += NATIVE_FALSETICKER_MS * 1000;
+  }
+  UdpReply reply;
+  reply.at = getMicros() + upMicros + downMicros;
+  reply.data.assign(NTP_PACKET_BYTES, 0);
+  uint8_t *packet = reply.data.data();
+  packet[0] = 0b00100100; // LI 0, version 4, mode 4 (server)
+  packet[1] = 1;          // stratum
+  packet[2] = data[2];    // poll interval
+  packet[3] = 0xEC;       // precision 2^-20 s
+  memcpy(&packet[12], "GPS", 3);
+  putNtpTimestamp(&packet[16], received - 16000000); // reference: last update of the server clock
+  memcpy(&packet[24], &data[40], 8);                 // originate: transmit timestamp of the request
+  putNtpTimestamp(&packet[32], received);
+  putNtpTimestamp(&packet[40], received);
+  if (ntpBogusEvery > 0 && ntpRequests % ntpBogusEvery == 0)
+  {
+    makeBogus(reply.data);
+  }
+  udpReplies.push_back(reply);
+}
+
+uint64_t NativeHardware::getUdpReplyMicros()
+{
+  uint64_t first = UINT64_MAX;
+  for (const UdpReply &reply : udpReplies)
+  {
+    first = std::min(first, reply.at);
+  }
+  for (const DnsLookup &lookup : dnsLookupsPending)
+  {
+    first = std::min(first, lookup.at);
+  }
+  return first;
+}
+
+size_t NativeHardware::receiveUdp(uint8_t *data, size_t size)
+{
+  size_t first = udpReplies.size();
+  for (size_t i = 0; i < udpReplies.size(); i++)
+  {
+    if (udpReplies[i].at <= getMicros() && (first == udpReplies.size() || udpReplies[i].at < udpReplies[first].at))
+    {
+      first = i;
+    }
+  }
+  if (first == udpReplies.size())
+  {
+    return 0;
+  }
+  size = std::min(size, udpReplies[first].data.size());
+  memcpy(data, udpReplies[first].data.data(), size);
+  udpReplies.erase(udpReplies.begin() + first);
+  return size;
+}
+
+void NativeHardware::setDns(uint32_t delayMs, uint32_t failEvery)
+{
+  dnsDelayMs = delayMs;
+  dnsFailEvery = failEvery;
+}
+
+uint32_t NativeHardware::getDnsLookups() { return dnsLookups; }
+uint32_t NativeHardware::getDnsFailed() { return dnsFailed; }
+
+// Starts the lookup: the answer is due after dnsDelayMs. Without WiFi, or as the failEvery-th lookup, it fails.
+static DnsLookup lookUp(const char *host)
+{
+  DnsLookup lookup = {};
+  lookup.at = NativeHardware::getMicros() + (uint64_t)dnsDelayMs * 1000;
+  lookup.host = host;
+  dnsLookups++;
+  if (!wifiConnected || (dnsFailEvery > 0 && dnsLookups % dnsFailEvery == 0))
+  {
+    dnsFailed++;
+    return lookup;
+  }
+  size_t number = std::find(dnsHosts.begin(), dnsHosts.end(), lookup.host) - dnsHosts.begin() + 1;
+  if (number > dnsHosts.size())
+  {
+    dnsHosts.push_back(lookup.host);
+  }
+  lookup.found = true;
+  lookup.address = 10 | (uint32_t)number << 24; // 10.0.0.n
+  return lookup;
+}
+
+bool NativeHardware::hostByName(const char *host, uint32_t &address)
+{
+  DnsLookup lookup = lookUp(host);
+  delay(dnsDelayMs);
+  address = lookup.address;
+  return lookup.found;
+}
+
+void NativeHardware::answerDnsLookups()
+{
+  std::vector<DnsLookup> answered;
+  for (size_t i = 0; i < dnsLookupsPending.size();)
+  {
+    if (dnsLookupsPending[i].at <= getMicros())
+    {
+      answered.push_back(dnsLookupsPending[i]);
+      dnsLookupsPending.erase(dnsLookupsPending.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+  for (const DnsLookup &lookup : answered)
+  { // may start new lookups
+    ip_addr_t address = {lookup.address};
+    lookup.callback(lookup.host.c_str(), lookup.found ? &address : NULL, lookup.callbackArg);
+  }
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg)
+{
+  if (hostname == NULL || addr == NULL || found == NULL)
+  {
+    return ERR_ARG;
+  }
+  DnsLookup lookup = lookUp(hostname);
+  lookup.callback = found;
+  lookup.callbackArg = callback_arg;
+  dnsLookupsPending.push_back(lookup);
+  return ERR_INPROGRESS;
+}
+
+// ************ partitions *********************
+
+// The ESP32 maps flash for data through a window of 64 pages of 64 KB, the constants of the app take some of them.
+#define NATIVE_MMAP_PAGE_SIZE (0x10000)
+#define NATIVE_MMAP_FREE_PAGES (48)
+
+static esp_partition_t partition;
+static std::vector<uint8_t> partitionData;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+  if (type != ESP_PARTITION_TYPE_DATA || label == NULL)
+  {
+    return NULL;
+  }
+  std::string path = std::string(NativeHardware::getSpiffsRoot()) + "/" + label + ".bin";
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  partitionData.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  size_t read = fread(partitionData.data(), 1, partitionData.size(), file);
+  fclose(file);
+  partitionData.resize(read);
+  // the rest of the last flash page is erased
+  partitionData.resize((read + NATIVE_MMAP_PAGE_SIZE - 1) / NATIVE_MMAP_PAGE_SIZE * NATIVE_MMAP_PAGE_SIZE, 0xFF);
+
+  partition.type = type;
+  partition.subtype = subtype;
+  partition.address = 0;
+  partition.size = partitionData.size();
+  snprintf(partition.label, sizeof(partition.label), "%s", label);
+  return &partition;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size, spi_flash_mmap_memory_t memory,
+                             const void **out_ptr, spi_flash_mmap_handle_t *out_handle)
+{
+  if (partition == NULL || offset + size > partitionData.size())
+  {
+    return ESP_FAIL;
+  }
+  if ((offset % NATIVE_MMAP_PAGE_SIZE) + size > NATIVE_MMAP_FREE_PAGES * NATIVE_MMAP_PAGE_SIZE)
+  {
+    return ESP_ERR_NO_MEM; // like the ESP32, if there are not enough free MMU pages
+  }
+  *out_ptr = partitionData.data() + offset;
+  *out_handle = 1;
+  return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) {}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+  if (partition == NULL || src_offset > partitionData.size() || size > partitionData.size() - src_offset)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memcpy(dst, partitionData.data() + src_offset, size);
+  return ESP_OK;
+}
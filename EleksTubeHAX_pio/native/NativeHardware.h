@@ -0,0 +1,87 @@
+#ifndef NATIVE_HARDWARE_H
+#define NATIVE_HARDWARE_H
+
+#include <Arduino.h>
+
+/*
+ * Control and inspection of the simulated hardware of the native build.
+ */
+
+namespace NativeHardware
+{
+  // Virtual time: starts at 0, advanced by delay(), delayMicroseconds(), the SPI transfers of TFT_eSPI (at
+  // SPI_FREQUENCY) and by advance(). millis() and micros() read it.
+  void advance(uint32_t ms);
+  void advanceMicros(uint32_t us);
+  uint64_t getMicros();
+  // Virtual time spent in delay(), where the ESP32 would run other tasks. The rest of the time the CPU is busy.
+  uint64_t getSleptMicros();
+
+  // Displays selected by the chip select pins, bit 0 is digit 0 (SECONDS_ONES). Decoded from the pin levels: the outputs
+  // of the 74HC595 shift register (CSSR_* pins), or the CS pins of the IPSTUBE clocks. All CS lines are active low.
+  uint8_t getSelectedDigits();
+  // Duty cycle written by ledcWrite() to the channel.
+  uint32_t getPwmDuty(uint8_t channel);
+
+  // Simulated RTC chip, runs with the virtual time, ppb fast (negative: slow) minus 0.1 ppm per step of the aging offset
+  // of the DS3231. Not set (lost power) at the start.
+  void setRtcTime(uint32_t unixtime);
+  uint32_t getRtcTime();
+  // Virtual time (micros) at which the RTC reaches unixtime.
+  uint64_t getRtcMicros(uint32_t unixtime);
+  bool isRtcSet();
+  void setRtcDrift(int32_t ppb);
+  int8_t getRtcAgingOffset();
+  // Used by TwoWire: the registers of the DS3231 at I2C address 0x68 (the time is kept by the RTC above, RTClib reads
+  // it directly). Writing returns false and reading 0 bytes, if no device has the address.
+  bool writeI2c(uint8_t address, const uint8_t *data, size_t size);
+  size_t readI2c(uint8_t address, uint8_t *data, size_t size);
+
+  // Reference time of the simulated world, what the NTP servers answer. Runs with the virtual time.
+  void setTrueTime(uint32_t unixtime);
+  uint64_t getTrueMicros(); // since 1970
+  // Virtual time (micros) at which the true time reaches unixtime.
+  uint64_t getTrueSecondMicros(uint32_t unixtime);
+
+  // Simulated network, off by default: with connected, WiFi is up and every host is an NTP server (port 123) that
+  // answers after delayMs; every lossEvery-th request gets no reply (0: none is lost).
+  void setNetwork(bool connected, uint32_t delayMs, uint32_t lossEvery);
+  // Faults of the NTP servers: up to jitterMs more delay on the way to the server and back (each), every bogusEvery-th
+  // reply is one the client has to reject (0: none), and the clock of the falseticker-th server (in the order of the
+  // first request, 0: none) is off by 2.5 s.
+  void setNtpFaults(uint32_t jitterMs, uint32_t bogusEvery, uint8_t falseticker);
+  bool isWifiConnected();
+  uint32_t getNtpRequests();
+  uint32_t getNtpLost();
+  uint32_t getNtpBogus();
+  uint8_t getNtpServers(); // hosts that got requests
+  // Used by WiFiUDP: a packet sent to the host and port, and the next packet received (returns its size, 0 if none).
+  void sendUdp(const char *host, uint16_t port, const uint8_t *data, size_t size);
+  size_t receiveUdp(uint8_t *data, size_t size);
+  // Virtual time (micros) when the next pending reply (NTP or DNS) arrives, UINT64_MAX if none.
+  uint64_t getUdpReplyMicros();
+  // DNS of the simulated network: host name number n (in the order of the first lookup) has the address 10.0.0.n, the
+  // answer takes delayMs, and every failEvery-th lookup fails (0: none).
+  void setDns(uint32_t delayMs, uint32_t failEvery);
+  uint32_t getDnsLookups();
+  uint32_t getDnsFailed();
+  // Used by WiFiUDP::beginPacket() with a host name: waits for the answer in delay(), like WiFi.hostByName() on the
+  // ESP32. Returns false, if the lookup failed.
+  bool hostByName(const char *host, uint32_t &address);
+  // Used by delay(): calls back the lookups of dns_gethostbyname() that are answered by now.
+  void answerDnsLookups();
+
+  // Output of Serial on stdout, on by default.
+  void setSerialOutput(bool enabled);
+
+  // Time zone offset answered by the simulated geolocation service (GetGeoLocationTimeZoneOffset()): Central European
+  // Time with the EU daylight saving rules, for the time of the RTC. Counts the queries.
+  double getGeoLocationOffset(uint32_t unixtime);
+  uint32_t getGeoLocationQueries();
+
+  // Root of the directory-backed SPIFFS ("data" by default, the folder the filesystem image is made from).
+  void setSpiffsRoot(const char *path);
+  const char *getSpiffsRoot();
+}
+
+#endif // NATIVE_HARDWARE_H
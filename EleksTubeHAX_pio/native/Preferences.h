@@ -0,0 +1,58 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+/*
+ * Preferences for the native build: the NVS is kept in memory, so every run starts with an empty NVS (like after
+ * erasing the flash) and getBytes() leaves the buffer as it is.
+ */
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL)
+  {
+    space = name;
+    return true;
+  }
+  void end() {}
+  bool clear()
+  {
+    storage()[space].clear();
+    return true;
+  }
+  bool remove(const char *key) { return storage()[space].erase(key) > 0; }
+  bool isKey(const char *key) { return storage()[space].count(key) > 0; }
+
+  size_t getBytesLength(const char *key) { return isKey(key) ? storage()[space][key].size() : 0; }
+  size_t getBytes(const char *key, void *buf, size_t maxLen)
+  {
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen)
+    {
+      return 0;
+    }
+    memcpy(buf, storage()[space][key].data(), len);
+    return len;
+  }
+  size_t putBytes(const char *key, const void *value, size_t len)
+  {
+    storage()[space][key].assign((const uint8_t *)value, (const uint8_t *)value + len);
+    return len;
+  }
+
+private:
+  std::string space;
+
+  // all namespaces, shared by all Preferences objects like the NVS partition
+  static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> &storage()
+  {
+    static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+    return nvs;
+  }
+};
+
+#endif // NATIVE_PREFERENCES_H
@@ -0,0 +1,25 @@
+#ifndef NATIVE_RTC_RX8025T_H
+#define NATIVE_RTC_RX8025T_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "NativeHardware.h"
+
+/*
+ * RX8025T of the NovelLife SE clocks for the native build: the simulated RTC of NativeHardware.
+ */
+
+class RX8025T
+{
+public:
+  void init(uint32_t sda, uint32_t scl, TwoWire &wire) {}
+  int set(uint32_t t)
+  {
+    NativeHardware::setRtcTime(t);
+    return 0;
+  }
+  uint32_t get() { return NativeHardware::getRtcTime(); }
+  void tempCompensation(uint8_t option) {}
+};
+
+#endif // NATIVE_RTC_RX8025T_H
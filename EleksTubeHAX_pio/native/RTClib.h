@@ -0,0 +1,51 @@
+#ifndef NATIVE_RTCLIB_H
+#define NATIVE_RTCLIB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "NativeHardware.h"
+
+/*
+ * RTClib for the native build: the DS3231 is the simulated RTC of NativeHardware.
+ */
+
+class DateTime
+{
+public:
+  DateTime(uint32_t t = 0) : t(t) {}
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0)
+  {
+    struct tm parts = {};
+    parts.tm_year = year - 1900;
+    parts.tm_mon = month - 1;
+    parts.tm_mday = day;
+    parts.tm_hour = hour;
+    parts.tm_min = min;
+    parts.tm_sec = sec;
+    t = (uint32_t)timegm(&parts);
+  }
+  uint32_t unixtime() const { return t; }
+
+private:
+  uint32_t t;
+};
+
+enum Ds3231SqwPinMode
+{
+  DS3231_OFF = 0x1C,
+  DS3231_SquareWave1Hz = 0x00
+};
+
+class RTC_DS3231
+{
+public:
+  bool begin(TwoWire *wireInstance = &Wire) { return true; }
+  bool lostPower() { return !NativeHardware::isRtcSet(); }
+  void adjust(const DateTime &dt) { NativeHardware::setRtcTime(dt.unixtime()); }
+  DateTime now() { return DateTime(NativeHardware::getRtcTime()); }
+  Ds3231SqwPinMode readSqwPinMode() { return DS3231_OFF; }
+  bool isEnabled32K() { return false; }
+  float getTemperature() { return 25.0f; }
+};
+
+#endif // NATIVE_RTCLIB_H
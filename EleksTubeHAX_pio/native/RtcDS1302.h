@@ -0,0 +1,37 @@
+#ifndef NATIVE_RTCDS1302_H
+#define NATIVE_RTCDS1302_H
+
+#include <Arduino.h>
+#include "NativeHardware.h"
+
+/*
+ * RtcDS1302 (Makuna RTC library) for the native build: the DS1302 is the simulated RTC of NativeHardware.
+ */
+
+class RtcDateTime
+{
+public:
+  RtcDateTime(uint32_t t = 0) : t(t) {}
+  uint32_t Unix32Time() const { return t; }
+  void InitWithUnix32Time(uint32_t time) { t = time; }
+
+private:
+  uint32_t t;
+};
+
+template <class T_WIRE_METHOD>
+class RtcDS1302
+{
+public:
+  RtcDS1302(T_WIRE_METHOD &wire) {}
+  void Begin() {}
+  bool IsDateTimeValid() { return NativeHardware::isRtcSet(); }
+  bool GetIsWriteProtected() { return false; }
+  void SetIsWriteProtected(bool isWriteProtected) {}
+  bool GetIsRunning() { return true; }
+  void SetIsRunning(bool isRunning) {}
+  RtcDateTime GetDateTime() { return RtcDateTime(NativeHardware::getRtcTime()); }
+  void SetDateTime(const RtcDateTime &dt) { NativeHardware::setRtcTime(dt.Unix32Time()); }
+};
+
+#endif // NATIVE_RTCDS1302_H
@@ -0,0 +1,21 @@
+#ifndef NATIVE_SPIFFS_H
+#define NATIVE_SPIFFS_H
+
+#include "FS.h"
+
+namespace fs
+{
+  class SPIFFSFS : public FS
+  {
+  public:
+    // Succeeds, if the root directory exists.
+    bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10, const char *partitionLabel = NULL);
+    void end() {}
+    size_t totalBytes() { return 0x300000; }
+    size_t usedBytes() { return 0; }
+  };
+} // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif // NATIVE_SPIFFS_H
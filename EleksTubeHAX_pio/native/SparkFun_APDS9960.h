@@ -0,0 +1,34 @@
+#ifndef NATIVE_SPARKFUN_APDS9960_H
+#define NATIVE_SPARKFUN_APDS9960_H
+
+#include <Arduino.h>
+
+/*
+ * Gesture sensor of the NovelLife SE clocks for the native build: not found, so no gestures.
+ */
+
+#define GGAIN_1X 0
+
+enum
+{
+  DIR_NONE,
+  DIR_LEFT,
+  DIR_RIGHT,
+  DIR_UP,
+  DIR_DOWN,
+  DIR_NEAR,
+  DIR_FAR,
+  DIR_ALL
+};
+
+class SparkFun_APDS9960
+{
+public:
+  bool init() { return false; }
+  bool setGestureGain(uint8_t gain) { return false; }
+  bool enableGestureSensor(bool interrupts = true) { return false; }
+  bool isGestureAvailable() { return false; }
+  int readGesture() { return DIR_NONE; }
+};
+
+#endif // NATIVE_SPARKFUN_APDS9960_H
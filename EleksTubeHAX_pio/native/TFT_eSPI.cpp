@@ -0,0 +1,126 @@
+#include "TFT_eSPI.h"
+#include "NativeHardware.h"
+#include "GLOBAL_DEFINES.h"
+
+const int16_t TFT_eSPI::screenWidth = TFT_WIDTH;
+const int16_t TFT_eSPI::screenHeight = TFT_HEIGHT;
+uint32_t TFT_eSPI::initCount = 0;
+
+static uint16_t framebuffers[NUM_DIGITS][TFT_WIDTH * TFT_HEIGHT];
+static uint64_t pixelsWritten[NUM_DIGITS];
+static uint64_t lastWriteMicros[NUM_DIGITS];
+static uint64_t busBytes = 0;
+
+TFT_eSPI::TFT_eSPI() : swapBytes(false), windowX(0), windowY(0), windowW(TFT_WIDTH), windowH(TFT_HEIGHT), windowPos(0),
+                       textColor(TFT_WHITE), textBackground(TFT_BLACK), textFont(1), cursorX(0), cursorY(0)
+{
+}
+
+const uint16_t *TFT_eSPI::getFramebuffer(uint8_t digit) { return framebuffers[digit]; }
+uint64_t TFT_eSPI::getPixelsWritten(uint8_t digit) { return pixelsWritten[digit]; }
+uint64_t TFT_eSPI::getLastWriteMicros(uint8_t digit) { return lastWriteMicros[digit]; }
+uint64_t TFT_eSPI::getBusBytes() { return busBytes; }
+
+// The pixels take the time of the SPI transfer, once for all selected displays.
+static void transfer(uint32_t pixels)
+{
+  uint64_t microsBefore = busBytes * 8 * 1000000 / SPI_FREQUENCY;
+  busBytes += pixels * sizeof(uint16_t);
+  NativeHardware::advanceMicros(busBytes * 8 * 1000000 / SPI_FREQUENCY - microsBefore);
+}
+
+// Writes the next len pixels of the address window to the framebuffers of the selected displays.
+void TFT_eSPI::writePixels(const uint16_t *pixels, uint16_t color, uint32_t len)
+{
+  transfer(len);
+  uint16_t *selected[NUM_DIGITS];
+  uint8_t count = 0;
+  uint8_t map = NativeHardware::getSelectedDigits();
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (map & (1 << digit))
+    {
+      selected[count++] = framebuffers[digit];
+      pixelsWritten[digit] += len;
+      lastWriteMicros[digit] = NativeHardware::getMicros();
+    }
+  }
+  for (uint32_t i = 0; i < len; i++, windowPos++)
+  {
+    if (windowW <= 0 || windowPos >= windowW * windowH)
+    {
+      continue; // outside of the window, the display ignores them
+    }
+    int32_t x = windowX + windowPos % windowW;
+    int32_t y = windowY + windowPos / windowW;
+    if (x < 0 || y < 0 || x >= TFT_WIDTH || y >= TFT_HEIGHT)
+    {
+      continue;
+    }
+    if (pixels != NULL)
+    {
+      color = swapBytes ? pixels[i] : (uint16_t)((pixels[i] << 8) | (pixels[i] >> 8));
+    }
+    for (uint8_t n = 0; n < count; n++)
+    {
+      selected[n][y * TFT_WIDTH + x] = color;
+    }
+  }
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  windowX = x;
+  windowY = y;
+  windowW = w;
+  windowH = h;
+  windowPos = 0;
+}
+
+// Pixels in memory are sent low byte first; the display reads the first byte as the high byte of the color.
+void TFT_eSPI::pushPixels(const void *data, uint32_t len) { writePixels((const uint16_t *)data, 0, len); }
+
+void TFT_eSPI::pushBlock(uint16_t color, uint32_t len) { writePixels(NULL, color, len); }
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+  setAddrWindow(x, y, w, h);
+  pushPixels(data, w * h);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (w <= 0 || h <= 0)
+  {
+    return;
+  }
+  setAddrWindow(x, y, w, h);
+  pushBlock(color, w * h);
+}
+
+int16_t TFT_eSPI::fontHeight(uint8_t font)
+{
+  switch (font)
+  {
+  case 2:
+    return 16;
+  case 4:
+    return 26;
+  default:
+    return 8;
+  }
+}
+
+size_t TFT_eSPI::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursorX = 0;
+    cursorY += fontHeight();
+  }
+  else if (c != '\r')
+  {
+    cursorX += fontHeight() / 2;
+  }
+  return 1;
+}
@@ -0,0 +1,120 @@
+#ifndef NATIVE_TFT_ESPI_H
+#define NATIVE_TFT_ESPI_H
+
+#include <Arduino.h>
+
+/*
+ * TFT_eSPI for the native build: every display has a framebuffer (RGB565), the pixels go to the framebuffers of all
+ * displays selected by the chip select pins at that moment (see NativeHardware::getSelectedDigits()).
+ * Follows the byte order rules of TFT_eSPI: with setSwapBytes(false) the pixels in memory are sent as they are, so
+ * images stored in the byte order of the display end up as the right colors.
+ * Sending pixels advances the virtual time by the duration of the transfer at SPI_FREQUENCY.
+ * Text is not drawn, only the cursor moves. There is no DMA (ESP32_DMA is not defined), so TFT_DMA_ENABLED is off.
+ */
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_MAROON 0x7800
+#define TFT_PURPLE 0x780F
+#define TFT_OLIVE 0x7BE0
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK 0xFE19
+
+class TFT_eSPI : public Print
+{
+public:
+  TFT_eSPI();
+
+  void init(uint8_t tc = 0) { initCount++; }
+  void begin(uint8_t tc = 0) { init(tc); }
+  void setRotation(uint8_t r) {}
+  int16_t width() { return screenWidth; }
+  int16_t height() { return screenHeight; }
+
+  void startWrite() {}
+  void endWrite() {}
+  void writecommand(uint8_t c) {}
+  void writedata(uint8_t d) {}
+  void setSwapBytes(bool swap) { swapBytes = swap; }
+  bool getSwapBytes() { return swapBytes; }
+
+  void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+  void pushPixels(const void *data, uint32_t len);
+  void pushColor(uint16_t color) { pushBlock(color, 1); }
+  void pushBlock(uint16_t color, uint32_t len);
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) { pushImage(x, y, w, h, (const uint16_t *)data); }
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+  bool initDMA(bool ctrl_cs = false) { return false; }
+  void deInitDMA() {}
+  bool dmaBusy() { return false; }
+  void dmaWait() {}
+  void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t *buffer = nullptr) { pushImage(x, y, w, h, data); }
+  void pushPixelsDMA(uint16_t *image, uint32_t len) { pushPixels(image, len); }
+
+  void fillScreen(uint32_t color) { fillRect(0, 0, screenWidth, screenHeight, color); }
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+
+  void setTextColor(uint16_t color) { textColor = textBackground = color; }
+  void setTextColor(uint16_t color, uint16_t background, bool fill = false)
+  {
+    textColor = color;
+    textBackground = background;
+  }
+  void setCursor(int16_t x, int16_t y)
+  {
+    cursorX = x;
+    cursorY = y;
+  }
+  void setCursor(int16_t x, int16_t y, uint8_t font)
+  {
+    setCursor(x, y);
+    setTextFont(font);
+  }
+  void setTextFont(uint8_t font) { textFont = font; }
+  void setTextSize(uint8_t size) {}
+  int16_t getCursorX() { return cursorX; }
+  int16_t getCursorY() { return cursorY; }
+  int16_t fontHeight() { return fontHeight(textFont); }
+  int16_t fontHeight(uint8_t font);
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Native only: the framebuffer of a display, TFT_WIDTH x TFT_HEIGHT RGB565 pixels, top line first.
+  static const uint16_t *getFramebuffer(uint8_t digit);
+  // Native only: pixels written to each display since the start, to compare the work of different drawing modes.
+  static uint64_t getPixelsWritten(uint8_t digit);
+  // Native only: virtual time (micros) when the last pixel was written to the display.
+  static uint64_t getLastWriteMicros(uint8_t digit);
+  // Native only: bytes sent over the SPI bus since the start, once for all displays selected at that moment.
+  static uint64_t getBusBytes();
+  // Native only: number of init() calls.
+  static uint32_t getInitCount() { return initCount; }
+
+private:
+  static const int16_t screenWidth;
+  static const int16_t screenHeight;
+  static uint32_t initCount;
+  bool swapBytes;
+  int32_t windowX, windowY, windowW, windowH; // address window
+  int32_t windowPos;                          // next pixel in the window
+  uint16_t textColor, textBackground;
+  uint8_t textFont;
+  int16_t cursorX, cursorY;
+
+  void writePixels(const uint16_t *pixels, uint16_t color, uint32_t len);
+};
+
+#endif // NATIVE_TFT_ESPI_H
@@ -0,0 +1,13 @@
+#ifndef NATIVE_THREEWIRE_H
+#define NATIVE_THREEWIRE_H
+
+#include <Arduino.h>
+
+class ThreeWire
+{
+public:
+  ThreeWire(uint8_t ioPin, uint8_t clkPin, uint8_t cePin) {}
+  void begin() {}
+};
+
+#endif // NATIVE_THREEWIRE_H
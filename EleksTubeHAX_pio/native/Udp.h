@@ -0,0 +1,77 @@
+#ifndef NATIVE_UDP_H
+#define NATIVE_UDP_H
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "NativeHardware.h"
+#include <string>
+
+/*
+ * UDP for the native build: packets go to the simulated network of NativeHardware (only the NTP servers answer), see
+ * NativeHardware::setNetwork(). Without it, packets are sent into nowhere and nothing is ever received.
+ */
+
+#define NATIVE_UDP_PACKET_SIZE 512
+
+class UDP : public Stream
+{
+public:
+  virtual uint8_t begin(uint16_t port) { return 1; }
+  virtual void stop() {}
+  virtual int beginPacket(IPAddress ip, uint16_t port) { return startPacket(ip.toString().c_str(), port); }
+  virtual int beginPacket(const char *host, uint16_t port)
+  { // looks the host up and waits for the answer, like on the ESP32
+    uint32_t address;
+    return NativeHardware::hostByName(host, address) && beginPacket(IPAddress(address), port);
+  }
+  virtual int endPacket()
+  {
+    NativeHardware::sendUdp(txHost.c_str(), txPort, txBuffer, txSize);
+    return 1;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    size = std::min(size, sizeof(txBuffer) - txSize);
+    memcpy(&txBuffer[txSize], buffer, size);
+    txSize += size;
+    return size;
+  }
+  using Print::write;
+  virtual int parsePacket()
+  {
+    rxSize = NativeHardware::receiveUdp(rxBuffer, sizeof(rxBuffer));
+    rxPos = 0;
+    return rxSize;
+  }
+  int available() override { return rxSize - rxPos; }
+  int read() override { return rxPos < rxSize ? rxBuffer[rxPos++] : -1; }
+  virtual int read(unsigned char *buffer, size_t len)
+  {
+    len = std::min(len, rxSize - rxPos);
+    memcpy(buffer, &rxBuffer[rxPos], len);
+    rxPos += len;
+    return len;
+  }
+  virtual int read(char *buffer, size_t len) { return read((unsigned char *)buffer, len); }
+  int peek() override { return rxPos < rxSize ? rxBuffer[rxPos] : -1; }
+  void flush() override { rxPos = rxSize = 0; }
+  virtual IPAddress remoteIP() { return IPAddress(); }
+  virtual uint16_t remotePort() { return 0; }
+
+private:
+  uint8_t txBuffer[NATIVE_UDP_PACKET_SIZE], rxBuffer[NATIVE_UDP_PACKET_SIZE];
+  size_t txSize = 0, rxSize = 0, rxPos = 0;
+  std::string txHost;
+  uint16_t txPort = 0;
+
+  int startPacket(const char *host, uint16_t port)
+  {
+    txHost = host;
+    txPort = port;
+    txSize = 0;
+    return 1;
+  }
+};
+
+#endif // NATIVE_UDP_H
@@ -0,0 +1,35 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "WiFiUdp.h"
+#include "NativeHardware.h"
+
+/*
+ * WiFi for the native build: connected, if the simulated network is on (NativeHardware::setNetwork()).
+ */
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass
+{
+public:
+  wl_status_t status() { return NativeHardware::isWifiConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected() { return NativeHardware::isWifiConnected(); }
+  IPAddress localIP() { return IPAddress(); }
+  String SSID() { return String(); }
+  int8_t RSSI() { return 0; }
+  String macAddress() { return String("00:00:00:00:00:00"); }
+};
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
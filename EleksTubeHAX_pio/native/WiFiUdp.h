@@ -0,0 +1,10 @@
+#ifndef NATIVE_WIFIUDP_H
+#define NATIVE_WIFIUDP_H
+
+#include "Udp.h"
+
+class WiFiUDP : public UDP
+{
+};
+
+#endif // NATIVE_WIFIUDP_H
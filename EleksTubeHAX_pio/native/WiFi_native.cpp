@@ -0,0 +1,62 @@
+/*
+ * Replaces src/WiFi_WPS.cpp in the native build: the WiFi is connected, if the simulated network of NativeHardware is
+ * on (only NTP works there). The geolocation query is answered by the simulated service of NativeHardware: Central
+ * European Time, as zone name and as offset.
+ */
+
+#include "WiFi_WPS.h"
+#include "NativeHardware.h"
+
+#if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
+#error "MQTT is not supported in the native build, comment out MQTT_PLAIN_ENABLED and MQTT_HOME_ASSISTANT."
+#endif
+
+WifiState_t WifiState = disconnected;
+double GeoLocTZoffset = 0;
+String GeoLocTZname;
+
+static uint32_t geoLocationQueries = 0;
+
+void WifiBegin()
+{
+  WifiState = NativeHardware::isWifiConnected() ? connected : disconnected;
+  Serial.println(WifiState == connected ? "WiFi connected to the simulated network." : "WiFi not available in the native build.");
+}
+
+void WiFiStartWps() {}
+void WifiReconnect() {}
+
+bool GetGeoLocationTimeZoneOffset()
+{
+  Serial.println("Starting Geolocation query...");
+  geoLocationQueries++;
+  GeoLocTZoffset = NativeHardware::getGeoLocationOffset(NativeHardware::getRtcTime());
+  GeoLocTZname = "Europe/Berlin";
+  Serial.println(String("Geo TZ Offset: ") + String(GeoLocTZoffset));
+  return true;
+}
+
+uint32_t NativeHardware::getGeoLocationQueries() { return geoLocationQueries; }
+
+// 0:00 UTC of the last Sunday of a month with 31 days
+static time_t lastSundayOfMonth(int year, int month)
+{
+  struct tm last = {};
+  last.tm_year = year;
+  last.tm_mon = month;
+  last.tm_mday = 31;
+  time_t t = timegm(&last);
+  gmtime_r(&t, &last);
+  return t - last.tm_wday * 86400;
+}
+
+// CET, CEST from 1:00 UTC on the last Sunday of March to 1:00 UTC on the last Sunday of October
+double NativeHardware::getGeoLocationOffset(uint32_t unixtime)
+{
+  time_t t = unixtime;
+  struct tm utc;
+  gmtime_r(&t, &utc);
+  time_t dstStart = lastSundayOfMonth(utc.tm_year, 2) + 3600;
+  time_t dstEnd = lastSundayOfMonth(utc.tm_year, 9) + 3600;
+  return (t >= dstStart && t < dstEnd) ? 2.0 : 1.0;
+}
@@ -0,0 +1,65 @@
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <Arduino.h>
+#include "NativeHardware.h"
+
+/*
+ * I2C for the native build: only the registers of the simulated DS3231 answer (see NativeHardware::writeI2c()).
+ */
+
+class TwoWire : public Stream
+{
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+  void setClock(uint32_t frequency) {}
+  void beginTransmission(uint16_t address)
+  {
+    txAddress = address;
+    txLength = 0;
+  }
+  uint8_t endTransmission(bool sendStop = true)
+  {
+    return NativeHardware::writeI2c(txAddress, txBuffer, txLength) ? 0 : 2; // 2: received NACK on transmit of address
+  }
+  uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true)
+  {
+    rxLength = NativeHardware::readI2c(address, rxBuffer, min((size_t)size, sizeof(rxBuffer)));
+    rxIndex = 0;
+    return rxLength;
+  }
+  size_t write(uint8_t c) override
+  {
+    if (txLength >= sizeof(txBuffer))
+    {
+      return 0;
+    }
+    txBuffer[txLength++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    size_t written = 0;
+    while (written < size && write(buffer[written]) == 1)
+    {
+      written++;
+    }
+    return written;
+  }
+  using Print::write;
+  int available() override { return rxLength - rxIndex; }
+  int read() override { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+  int peek() override { return rxIndex < rxLength ? rxBuffer[rxIndex] : -1; }
+
+private:
+  uint16_t txAddress = 0;
+  uint8_t txBuffer[32];
+  size_t txLength = 0;
+  uint8_t rxBuffer[32];
+  size_t rxLength = 0;
+  size_t rxIndex = 0;
+};
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif // NATIVE_WIRE_H
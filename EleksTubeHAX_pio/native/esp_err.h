@@ -0,0 +1,24 @@
+#ifndef NATIVE_ESP_ERR_H
+#define NATIVE_ESP_ERR_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_SIZE 0x104
+
+// stops the program, like the abort on the ESP32
+#define ESP_ERROR_CHECK(x)                                 \
+  do                                                       \
+  {                                                        \
+    esp_err_t rc = (x);                                    \
+    if (rc != ESP_OK)                                      \
+    {                                                      \
+      fprintf(stderr, "ESP_ERROR_CHECK failed: %d\n", rc); \
+      abort();                                             \
+    }                                                      \
+  } while (0)
+
+#endif // NATIVE_ESP_ERR_H
@@ -0,0 +1,43 @@
+#ifndef NATIVE_ESP_PARTITION_H
+#define NATIVE_ESP_PARTITION_H
+
+#include <Arduino.h>
+#include "esp_err.h"
+
+/*
+ * Partitions for the native build: a data partition is the file "<label>.bin" in the SPIFFS root directory
+ * (see NativeHardware::setSpiffsRoot()), e.g. the image of the "faces" partition made by tools/face_packer.cpp.
+ * Its size is the file rounded up to 64 KB, the rest reads as erased flash (0xFF). Like on the ESP32, at most 48 pages
+ * of 64 KB can be mapped (the data window is 64 pages, the constants of the app need some).
+ */
+
+typedef enum
+{
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+
+typedef enum
+{
+  SPI_FLASH_MMAP_DATA,
+  SPI_FLASH_MMAP_INST
+} spi_flash_mmap_memory_t;
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct
+{
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size, spi_flash_mmap_memory_t memory,
+                             const void **out_ptr, spi_flash_mmap_handle_t *out_handle);
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+
+#endif // NATIVE_ESP_PARTITION_H
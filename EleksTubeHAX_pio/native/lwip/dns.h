@@ -0,0 +1,29 @@
+#ifndef NATIVE_LWIP_DNS_H
+#define NATIVE_LWIP_DNS_H
+
+#include <Arduino.h>
+
+/*
+ * DNS of lwIP for the native build, IPv4 only: the simulated network answers every lookup after its DNS delay (see
+ * NativeHardware::setDns()). The callback comes from the next delay(), where the lwIP task would run on the ESP32.
+ */
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+typedef struct
+{
+  uint32_t addr; // network byte order
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+#define IP_IS_V4(ipaddr) (1)
+#define ip_2_ip4(ipaddr) (ipaddr)
+#define ip4_addr_get_u32(src_ipaddr) ((src_ipaddr)->addr)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+
+#endif // NATIVE_LWIP_DNS_H
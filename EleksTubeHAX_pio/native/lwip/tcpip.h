@@ -0,0 +1,18 @@
+#ifndef NATIVE_LWIP_TCPIP_H
+#define NATIVE_LWIP_TCPIP_H
+
+#include "dns.h"
+
+/*
+ * lwIP task for the native build: a function passed to it runs at once.
+ */
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+inline err_t tcpip_callback(tcpip_callback_fn function, void *ctx)
+{
+  function(ctx);
+  return ERR_OK;
+}
+
+#endif // NATIVE_LWIP_TCPIP_H
@@ -0,0 +1,512 @@
+/*
+ * Runner of the native build (platformio.ini [env:native]). Runs the real setup() and loop() of src/main.cpp on the
+ * shims in this folder, with the clock faces of the data folder and the simulated RTC:
+ *   1. setup(), then draws every digit of every clock face and reports the host time per clock face,
+ *   2. replays a day (or --seconds) of the main loop in virtual time, by default from midnight before the change to
+ *      daylight saving time in Central Europe (the default time zone, or --time-zone), so the clock moves one hour
+ *      ahead at 2 am (01:00 UTC) by the POSIX TZ rule of the zone,
+ *   3. reports per hour and in total: loop times, images drawn, SPI bytes, cache hits and misses, and the flip phase
+ *      error: how far from the start of every second (true time) its digits were drawn; at the end a checksum of each
+ *      display.
+ * Fails (exit code 1), if a second is shown more than --late-ms early or late, or not at all.
+ *
+ * Virtual time is deterministic: it only moves by delay(), by the SPI transfers (at SPI_FREQUENCY) and by the runner.
+ * CPU time of the code itself is not part of it. Between the seconds the runner skips ahead to --wake-ms before the
+ * next second is due (from shortly after the start of a second on), so a day takes a few seconds; --wake-ms 0 runs
+ * every loop() like on the clock.
+ *
+ * With --golden it only draws every digit of every clock face at several dimming levels and compares the displays with
+ * the hashes in native/golden_frames.txt (see GoldenFrames.h); --update-golden writes them after an intended change.
+ * With --fuzz it only loads mutated copies of the images (see ImageFuzzer.h).
+ * With --bench it only times the line decoders with dimming off and on, against the per-pixel loop of the original
+ * firmware (see DecoderBench.h).
+ *
+ * With --wifi, WiFi is connected and every NTP server (host name) is simulated; they answer after --ntp-delay-ms plus up
+ * to --ntp-jitter-ms in each direction, --ntp-loss n loses every n-th request, --ntp-bogus n makes every n-th reply one
+ * the client has to reject, and the clock of server number --ntp-falseticker n is 2.5 s off. Looking up a server name
+ * takes --dns-delay-ms, --dns-fail n fails every n-th lookup. The loop duration histogram shows how long the NTP
+ * updates stall loop(); the flip phase error shows, if the servers that agree are used.
+ * --rtc-drift-ppm x makes the RTC run x ppm fast (negative: slow); the DS3231 can trim it with its aging offset. Runs of
+ * several days with --wifi show, if the learned drift keeps the time while the NTP updates get rarer (see RtcDrift.h).
+ *
+ * Usage: .pio/build/native/program [--data dir] [--seconds n] [--start unixtime] [--wake-ms n] [--late-ms n] [--verbose]
+ *                                  [--wifi] [--ntp-delay-ms n] [--ntp-loss n] [--ntp-jitter-ms n] [--ntp-bogus n]
+ *                                  [--ntp-falseticker n] [--dns-delay-ms n] [--dns-fail n] [--rtc-drift-ppm x]
+ *                                  [--time-zone zone]
+ *        .pio/build/native/program [--data dir] --golden|--update-golden [--golden-file file] [--diff-dir dir]
+ *        .pio/build/native/program [--data dir] --fuzz iterations [--seed n]
+ *        .pio/build/native/program [--data dir] --bench
+ */
+
+#include "GLOBAL_DEFINES.h"
+#include "TFTs.h"
+#include "Clock.h"
+#include "NativeHardware.h"
+#include "GoldenFrames.h"
+#include "ImageFuzzer.h"
+#include "DecoderBench.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define SIM_START_TIME 1774738800 // 2026-03-28 23:00:00 UTC, midnight CET; CEST starts at 2 am
+#define SIM_SECONDS 86400
+#define SIM_WAKE_MS 100  // wake up this long before the next second is due
+#define SIM_SETTLE_MS 50 // and run until this long after it started
+#define SIM_LATE_MS 100  // a second shown more than this before or after it started fails the run
+#define SIM_MAX_REPORTED_ERRORS 20
+#define SIM_MAX_LAG_S 10 // seconds shown later (or earlier) than this are not found anymore and count as missed
+#define SIM_NTP_DELAY_MS 30 // round trip to the simulated NTP server
+#define SIM_DNS_DELAY_MS 50 // lookup of a server name
+#define SIM_GOLDEN_FILE "native/golden_frames.txt"
+#define SIM_GOLDEN_DIFF_DIR "golden_diff"
+
+#define SIM_LOOP_BUCKET_LIMITS_MS {1, 2, 5, 10, 20, 50, 100, 200, 500}
+#define SIM_PHASE_BUCKET_LIMITS_MS {1, 2, 5, 10, 20, 50, 100, 200, 500}
+
+void updateClockDisplay(TFTs::show_t show); // src/main.cpp
+
+class Histogram
+{
+public:
+  Histogram(std::initializer_list<uint32_t> limits) : limits(limits), counts(limits.size() + 1, 0), max(0) {}
+  void add(uint32_t value)
+  {
+    size_t bucket = 0;
+    while (bucket < limits.size() && value > limits[bucket])
+    {
+      bucket++;
+    }
+    counts[bucket]++;
+    max = std::max(max, value);
+  }
+  void print(const char *title)
+  {
+    char label[16];
+    printf("  %s\n  ", title);
+    for (uint32_t limit : limits)
+    {
+      snprintf(label, sizeof(label), "<=%u", limit);
+      printf(" %9s", label);
+    }
+    snprintf(label, sizeof(label), ">%u", limits.back());
+    printf(" %9s      max\n  ", label);
+    for (uint32_t count : counts)
+    {
+      printf(" %9u", count);
+    }
+    printf(" %8u\n", max);
+  }
+
+private:
+  std::vector<uint32_t> limits;
+  std::vector<uint32_t> counts;
+  uint32_t max;
+};
+
+struct Options
+{
+  const char *data = "data";
+  uint32_t seconds = SIM_SECONDS;
+  uint32_t start = SIM_START_TIME;
+  uint32_t wakeMs = SIM_WAKE_MS;
+  uint32_t lateMs = SIM_LATE_MS;
+  bool verbose = false;
+  bool golden = false;       // only check the golden frames
+  bool updateGolden = false; // only write the golden frames
+  const char *goldenFile = SIM_GOLDEN_FILE;
+  const char *diffDir = SIM_GOLDEN_DIFF_DIR;
+  uint32_t fuzz = 0; // only fuzz the image loaders with this many mutated files
+  uint32_t seed = 1;
+  bool bench = false; // only time the line decoders
+  bool wifi = false; // simulated network with an NTP server
+  uint32_t ntpDelayMs = SIM_NTP_DELAY_MS;
+  uint32_t ntpLoss = 0; // every n-th NTP request is lost
+  uint32_t ntpJitterMs = 0;
+  uint32_t ntpBogus = 0;      // every n-th NTP reply is bogus
+  uint8_t ntpFalseticker = 0; // number of the server that is off, 0: none
+  uint32_t dnsDelayMs = SIM_DNS_DELAY_MS;
+  uint32_t dnsFail = 0; // every n-th DNS lookup fails
+  double rtcDriftPpm = 0.0;
+  const char *timeZone = NULL; // zone name or POSIX TZ rule, NULL: the one of setup()
+};
+
+// counted per hour and for the whole run
+struct Totals
+{
+  uint32_t loops = 0;
+  uint32_t draws = 0;
+  uint32_t cacheHits = 0;
+  uint32_t cacheMisses = 0;
+  uint32_t maxLoopMs = 0;
+  uint32_t maxSecondMs = 0;
+  uint32_t maxPhaseMs = 0; // flip phase error without sign
+  uint32_t off = 0;        // seconds shown more than lateMs early or late
+  uint32_t missed = 0;
+};
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0 || strcmp(arg, "--golden") == 0 || strcmp(arg, "--update-golden") == 0 ||
+        strcmp(arg, "--wifi") == 0 || strcmp(arg, "--bench") == 0)
+    {
+      options.verbose |= strcmp(arg, "--verbose") == 0;
+      options.wifi |= strcmp(arg, "--wifi") == 0;
+      options.golden |= strcmp(arg, "--golden") == 0;
+      options.updateGolden |= strcmp(arg, "--update-golden") == 0;
+      options.bench |= strcmp(arg, "--bench") == 0;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (strcmp(arg, "--data") == 0)
+      options.data = value;
+    else if (strcmp(arg, "--seconds") == 0)
+      options.seconds = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--start") == 0)
+      options.start = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--wake-ms") == 0)
+      options.wakeMs = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--late-ms") == 0)
+      options.lateMs = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--golden-file") == 0)
+      options.goldenFile = value;
+    else if (strcmp(arg, "--diff-dir") == 0)
+      options.diffDir = value;
+    else if (strcmp(arg, "--fuzz") == 0)
+      options.fuzz = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--seed") == 0)
+      options.seed = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--ntp-delay-ms") == 0)
+      options.ntpDelayMs = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--ntp-loss") == 0)
+      options.ntpLoss = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--ntp-jitter-ms") == 0)
+      options.ntpJitterMs = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--ntp-bogus") == 0)
+      options.ntpBogus = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--ntp-falseticker") == 0)
+      options.ntpFalseticker = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--dns-delay-ms") == 0)
+      options.dnsDelayMs = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--dns-fail") == 0)
+      options.dnsFail = strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--rtc-drift-ppm") == 0)
+      options.rtcDriftPpm = strtod(value, NULL);
+    else if (strcmp(arg, "--time-zone") == 0)
+      options.timeZone = value;
+    else
+      return false;
+  }
+  return options.wakeMs < 1000;
+}
+
+static double hostMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void drawAllClockFaces()
+{
+  printf("Drawing all digits of all clock faces (host time):\n");
+  for (uint8_t face = 1; face <= tfts.NumberOfClockFaces; face++)
+  {
+    tfts.current_graphic = face;
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t value = 0; value < 10; value++)
+    {
+      uint8_t values[NUM_DIGITS];
+      memset(values, value, sizeof(values));
+      tfts.setDigits(values, TFTs::force);
+    }
+    printf("  clock face %2u: %8.2f ms for 10 digits on %u displays\n", face, hostMs(start), NUM_DIGITS);
+  }
+  tfts.current_graphic = uclock.getActiveGraphicIdx();
+  updateClockDisplay(TFTs::force);
+}
+
+// true, if the displays show the local time of the second
+static bool isShown(uint32_t second)
+{
+  uint8_t expected[NUM_DIGITS];
+  uclock.getDigitsAt(second + uclock.getTimeZoneOffsetAt(second), expected);
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (tfts.getDigit(digit) != expected[digit])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t trueSecond() { return NativeHardware::getTrueMicros() / 1000000; }
+
+// virtual time, when the digits on the displays were drawn
+static uint64_t lastDrawnMicros()
+{
+  uint64_t last = 0;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    last = std::max(last, TFT_eSPI::getLastWriteMicros(digit));
+  }
+  return last;
+}
+
+static void printTime(const char *label, uint32_t unixtime)
+{
+  time_t local = unixtime + uclock.getTimeZoneOffsetAt(unixtime);
+  printf("%s %02d:%02d:%02d", label, hour(local), minute(local), second(local));
+}
+
+static void printHour(uint32_t index, uint32_t startSecond, const Totals &hour, uint64_t busBytes)
+{
+  time_t local = startSecond + uclock.getTimeZoneOffsetAt(startSecond);
+  printf("  %4u  %02d:%02d  %7u %7u %8llu %6u %7u %6u ms %8u ms %9u ms %5u %7u\n", index, ::hour(local), minute(local),
+         hour.loops, hour.draws, (unsigned long long)(busBytes / 1024), hour.cacheHits, hour.cacheMisses, hour.maxLoopMs,
+         hour.maxSecondMs, hour.maxPhaseMs, hour.off, hour.missed);
+}
+
+static void addTotals(Totals &total, const Totals &hour)
+{
+  total.loops += hour.loops;
+  total.draws += hour.draws;
+  total.cacheHits += hour.cacheHits;
+  total.cacheMisses += hour.cacheMisses;
+  total.maxLoopMs = std::max(total.maxLoopMs, hour.maxLoopMs);
+  total.maxSecondMs = std::max(total.maxSecondMs, hour.maxSecondMs);
+  total.maxPhaseMs = std::max(total.maxPhaseMs, hour.maxPhaseMs);
+  total.off += hour.off;
+  total.missed += hour.missed;
+}
+
+static bool simulate(const Options &options)
+{
+  Histogram loopTimes(SIM_LOOP_BUCKET_LIMITS_MS);    // busy time of every loop()
+  Histogram loopDurations(SIM_LOOP_BUCKET_LIMITS_MS); // every loop() from start to end, incl. delay(): how long it stalls
+  Histogram secondTimes(SIM_LOOP_BUCKET_LIMITS_MS);  // busy time of all loops in one second
+  Histogram phases(SIM_PHASE_BUCKET_LIMITS_MS);      // flip phase error without sign
+  int64_t phaseTotalUs = 0;                          // with sign, > 0 is late
+  int32_t phaseMinMs = 0, phaseMaxMs = 0;
+  uint32_t flips = 0;
+  Totals total, hour;
+  uint32_t errors = 0;
+
+  uint32_t firstSecond = trueSecond();
+  uint32_t lastSecond = firstSecond + options.seconds;
+  uint32_t hourStart = firstSecond;
+  uint32_t hourIndex = 0;
+  uint32_t nextSecond = firstSecond + 1; // next second to be shown, the current one is on the displays already
+  uint32_t busySecond = firstSecond;     // second of secondBusyUs
+  uint64_t secondBusyUs = 0;
+  uint64_t busBytesAtStart = TFT_eSPI::getBusBytes();
+  uint64_t busBytesAtHour = busBytesAtStart;
+  double offsetAtStart = uclock.getTimeZoneOffsetAt(firstSecond) / 3600.0;
+
+  printf("Simulating %u s from", options.seconds);
+  printTime("", firstSecond);
+  printf(" (UTC%+.1f), off after %u ms:\n", offsetAtStart, options.lateMs);
+  printf("  hour  local    loops  images   SPI kB   hits  misses  loop max  second max    phase max   off  missed\n");
+  renderStats.reset();
+  NativeHardware::setSerialOutput(options.verbose);
+  auto start = std::chrono::steady_clock::now();
+
+  auto endHour = [&]()
+  {
+    hour.draws = renderStats.getDraws();
+    hour.cacheHits = renderStats.getCacheHits();
+    hour.cacheMisses = renderStats.getCacheMisses();
+    printHour(hourIndex++, hourStart, hour, TFT_eSPI::getBusBytes() - busBytesAtHour);
+    addTotals(total, hour);
+    hour = Totals();
+    hourStart += 3600;
+    busBytesAtHour = TFT_eSPI::getBusBytes();
+    renderStats.reset();
+  };
+
+  while (trueSecond() < lastSecond)
+  {
+    uint64_t loopStart = NativeHardware::getMicros();
+    uint64_t sleptBefore = NativeHardware::getSleptMicros();
+    loop();
+    uint64_t now = NativeHardware::getMicros();
+    uint32_t busyUs = (now - loopStart) - (NativeHardware::getSleptMicros() - sleptBefore);
+
+    hour.loops++;
+    loopTimes.add(busyUs / 1000);
+    loopDurations.add((now - loopStart) / 1000);
+    hour.maxLoopMs = std::max(hour.maxLoopMs, busyUs / 1000);
+    uint32_t current = trueSecond();
+    if (current != busySecond)
+    {
+      secondTimes.add(secondBusyUs / 1000);
+      hour.maxSecondMs = std::max(hour.maxSecondMs, (uint32_t)(secondBusyUs / 1000));
+      secondBusyUs = 0;
+      busySecond = current;
+    }
+    secondBusyUs += busyUs;
+
+    // the newest second on the displays, if it wasn't shown before; also ahead of the true second, if it was drawn early
+    uint32_t shown = nextSecond - 1;
+    if (!isShown(shown))
+    {
+      shown = current + SIM_MAX_LAG_S;
+      while (shown >= nextSecond && shown + SIM_MAX_LAG_S > current && !isShown(shown))
+      {
+        shown--;
+      }
+    }
+    if (shown >= nextSecond && shown + SIM_MAX_LAG_S > current)
+    {
+      for (uint32_t skipped = nextSecond; skipped < shown; skipped++)
+      {
+        hour.missed++;
+        if (errors++ < SIM_MAX_REPORTED_ERRORS)
+        {
+          printTime("  MISSED: second", skipped);
+          printf(" never shown\n");
+        }
+      }
+      int64_t phaseUs = (int64_t)lastDrawnMicros() - (int64_t)NativeHardware::getTrueSecondMicros(shown);
+      int32_t phaseMs = phaseUs / 1000;
+      uint32_t phaseAbsMs = std::abs(phaseMs);
+      phases.add(phaseAbsMs);
+      phaseTotalUs += phaseUs;
+      phaseMinMs = flips == 0 ? phaseMs : std::min(phaseMinMs, phaseMs);
+      phaseMaxMs = flips == 0 ? phaseMs : std::max(phaseMaxMs, phaseMs);
+      flips++;
+      hour.maxPhaseMs = std::max(hour.maxPhaseMs, phaseAbsMs);
+      if (phaseAbsMs > options.lateMs)
+      {
+        hour.off++;
+        if (errors++ < SIM_MAX_REPORTED_ERRORS)
+        {
+          printTime(phaseMs > 0 ? "  LATE: second" : "  EARLY: second", shown);
+          printf(" shown %u ms %s it started\n", phaseAbsMs, phaseMs > 0 ? "after" : "before");
+        }
+      }
+      nextSecond = shown + 1;
+    }
+
+    if (current >= hourStart + 3600)
+    {
+      endHour();
+    }
+
+    // once the current second is shown and the RTC has started its own (it drifts, see --rtc-drift-ppm), nothing changes
+    // until shortly before the next true or RTC second (or until the NTP reply arrives)
+    uint32_t rtcSecond = NativeHardware::getRtcTime();
+    uint64_t wakeAt = std::min({NativeHardware::getTrueSecondMicros(current + 1) - options.wakeMs * 1000,
+                                NativeHardware::getRtcMicros(rtcSecond + 1) - options.wakeMs * 1000,
+                                NativeHardware::getUdpReplyMicros()});
+    if (options.wakeMs > 0 && nextSecond == current + 1 && NativeHardware::getTrueMicros() % 1000000 >= SIM_SETTLE_MS * 1000 &&
+        NativeHardware::getMicros() >= NativeHardware::getRtcMicros(rtcSecond) + SIM_SETTLE_MS * 1000 &&
+        wakeAt > NativeHardware::getMicros())
+    {
+      NativeHardware::advanceMicros(wakeAt - NativeHardware::getMicros());
+    }
+  }
+  for (uint32_t skipped = nextSecond; skipped < lastSecond; skipped++)
+  {
+    hour.missed++;
+    if (errors++ < SIM_MAX_REPORTED_ERRORS)
+    {
+      printTime("  MISSED: second", skipped);
+      printf(" never shown\n");
+    }
+  }
+  if (hour.loops > 0)
+  {
+    endHour();
+  }
+  NativeHardware::setSerialOutput(true);
+
+  printf("Totals:\n");
+  printf("  %u loops, %u images drawn, %.1f MB sent over SPI, cache hits: %u, misses: %u\n", total.loops, total.draws,
+         (TFT_eSPI::getBusBytes() - busBytesAtStart) / 1048576.0, total.cacheHits, total.cacheMisses);
+  printf("  time zone UTC%+.1f -> UTC%+.1f, %u geolocation queries\n", offsetAtStart, uclock.getTimeZoneOffset() / 3600.0,
+         NativeHardware::getGeoLocationQueries());
+  printf("  %u NTP requests to %u servers, %u lost, %u bogus replies; %u DNS lookups, %u failed\n",
+         NativeHardware::getNtpRequests(), NativeHardware::getNtpServers(), NativeHardware::getNtpLost(),
+         NativeHardware::getNtpBogus(), NativeHardware::getDnsLookups(), NativeHardware::getDnsFailed());
+  const RtcDrift &drift = Clock::getRtcDrift();
+  printf("  RTC drift %+.3f ppm, aging offset %d; learned %+.3f ppm from %.1f h, last error %+d ms, NTP interval %u s\n",
+         options.rtcDriftPpm - NativeHardware::getRtcAgingOffset() * 0.1, NativeHardware::getRtcAgingOffset(),
+         drift.getDriftPpb() / 1000.0, drift.getHours(), drift.getMeasuredError(), Clock::getNtpInterval());
+  loopTimes.print("loop busy time (ms):");
+  loopDurations.print("loop duration incl. delay() (ms):");
+  secondTimes.print("busy time per second (ms):");
+  phases.print("flip phase error, early or late (ms):");
+  printf("  flip phase error: avg %+.1f ms, earliest %+d ms, latest %+d ms\n", flips > 0 ? phaseTotalUs / 1000.0 / flips : 0.0,
+         phaseMinMs, phaseMaxMs);
+  printf("  %u seconds early or late, %u missed; %.2f s host time\n", total.off, total.missed, hostMs(start) / 1000.0);
+  return total.off == 0 && total.missed == 0;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printf("Usage: %s [--data dir] [--seconds n] [--start unixtime] [--wake-ms n] [--late-ms n] [--verbose]\n", argv[0]);
+    printf("       %*s [--wifi] [--ntp-delay-ms n] [--ntp-loss n] [--ntp-jitter-ms n] [--ntp-bogus n] [--ntp-falseticker n]\n",
+           (int)strlen(argv[0]), "");
+    printf("       %*s [--dns-delay-ms n] [--dns-fail n] [--rtc-drift-ppm x] [--time-zone zone]\n", (int)strlen(argv[0]), "");
+    printf("       %s [--data dir] --golden|--update-golden [--golden-file file] [--diff-dir dir]\n", argv[0]);
+    printf("       %s [--data dir] --fuzz iterations [--seed n]\n", argv[0]);
+    printf("       %s [--data dir] --bench\n", argv[0]);
+    return 2;
+  }
+  NativeHardware::setSpiffsRoot(options.data);
+  NativeHardware::setRtcTime(options.start);
+  NativeHardware::setTrueTime(options.start);
+  NativeHardware::setNetwork(options.wifi, options.ntpDelayMs, options.ntpLoss);
+  NativeHardware::setNtpFaults(options.ntpJitterMs, options.ntpBogus, options.ntpFalseticker);
+  NativeHardware::setDns(options.dnsDelayMs, options.dnsFail);
+  NativeHardware::setRtcDrift((int32_t)lround(options.rtcDriftPpm * 1000));
+
+  setup();
+  if (tfts.NumberOfClockFaces == 0)
+  {
+    printf("No clock faces found in \"%s\"!\n", NativeHardware::getSpiffsRoot());
+    return 2;
+  }
+  if (options.timeZone != NULL && !uclock.setTimeZone(options.timeZone))
+  {
+    printf("Unknown time zone \"%s\"!\n", options.timeZone);
+    return 2;
+  }
+  if (options.timeZone != NULL)
+  {
+    uclock.printTimeZone();
+  }
+  if (options.golden || options.updateGolden || options.fuzz > 0 || options.bench)
+  {
+    NativeHardware::setSerialOutput(options.verbose);
+    bool passed = options.bench      ? benchmarkDecoders()
+                  : options.fuzz > 0 ? fuzzImageLoaders(options.fuzz, options.seed)
+                                     : checkGoldenFrames(options.goldenFile, options.updateGolden, options.diffDir);
+    NativeHardware::setSerialOutput(true);
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+  }
+  drawAllClockFaces();
+  renderStats.print();
+
+  bool passed = simulate(options);
+
+  printf("Displays:\n");
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    printf("  digit %u: %12llu pixels written, checksum %08X\n", digit, (unsigned long long)TFT_eSPI::getPixelsWritten(digit),
+           frameChecksum(TFT_eSPI::getFramebuffer(digit)));
+  }
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#ifndef NATIVE_NVS_FLASH_H
+#define NATIVE_NVS_FLASH_H
+
+#include "esp_err.h"
+
+// The NVS of the native build is in memory (see Preferences.h), there is nothing to initialize.
+
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+inline esp_err_t nvs_flash_init() { return ESP_OK; }
+inline esp_err_t nvs_flash_erase() { return ESP_OK; }
+
+#endif // NATIVE_NVS_FLASH_H
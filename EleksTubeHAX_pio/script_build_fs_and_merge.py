@@ -1,6 +1,7 @@
 # script_build_fs_and_merge.py
 
 import os
+import shutil
 import subprocess
 import sys
 import csv
@@ -22,7 +23,8 @@ def parse_partition_table(partition_csv_path):
     app (firmware), and spiffs.
 
     :param partition_csv_path: Path to the partition table CSV file.
-    :return: Dictionary with offsets for 'bootloader', 'partition_table', 'app0' or 'factory', and 'spiffs'.
+    :return: Dictionary with offsets for 'bootloader', 'partition_table', 'app0' or 'factory', 'spiffs' and 'faces' (if there),
+             and the size of 'faces' as 'faces_size'.
     """
     offsets = {}
 
@@ -44,8 +46,8 @@ def parse_partition_table(partition_csv_path):
                 continue  # Not enough columns
             name = row[0].strip()
             offset = row[3].strip()
-            # Store offsets for 'app0', 'factory', and 'spiffs'
-            if name.lower() in ['app0', 'factory', 'spiffs']:
+            # Store offsets for 'app0', 'factory', 'spiffs' and 'faces' (optional, for USE_FACE_PARTITION)
+            if name.lower() in ['app0', 'factory', 'spiffs', 'faces']:
                 # Convert offset from hex or decimal string to integer
                 try:
                     offset_int = int(offset, 0)
@@ -53,6 +55,12 @@ def parse_partition_table(partition_csv_path):
                 except ValueError:
                     print(f"[Error] Invalid offset value for partition '{name}': {offset}")
                     env.Exit(1)
+            if name.lower() == 'faces':
+                try:
+                    offsets['faces_size'] = int(row[4].strip(), 0)
+                except ValueError:
+                    print(f"[Error] Invalid size value for partition '{name}': {row[4].strip()}")
+                    env.Exit(1)
 
     # Verify that required partitions were found
     required_partitions = ['app0', 'factory', 'spiffs']
@@ -114,6 +122,85 @@ def extract_hardware_name(user_defines_path):
         print("[Error] Active hardware define not found in the 'Type of the clock hardware' section.")
         env.Exit(1)
 
+def is_user_define_active(user_defines_path, define_name):
+    """
+    Checks if a define is active (not commented out) in the _User_defines.h file.
+
+    :param user_defines_path: Path to the _User_defines.h file.
+    :param define_name: Name of the define.
+    :return: True if the define is active.
+    """
+    if not os.path.isfile(user_defines_path):
+        return False
+
+    with open(user_defines_path, 'r') as f:
+        for line in f:
+            line_without_comments = line.split('//')[0].split('/*')[0].strip()
+            if re.match(r'#define\s+' + define_name + r'\b', line_without_comments):
+                return True
+    return False
+
+def get_partition_csv_path(env):
+    """
+    :return: Path to the partition table CSV file of the environment (board_build.partitions).
+    """
+    partition_csv = env.GetProjectOption("board_build.partitions")
+    if not partition_csv:
+        print("[Error] 'board_build.partitions' not defined in platformio.ini.")
+        env.Exit(1)
+    if not os.path.isabs(partition_csv):
+        partition_csv = os.path.join(env.subst("$PROJECT_DIR"), partition_csv)
+    return partition_csv
+
+def pack_face_bundles(env, compress, partition_image=None, partition_size=None):
+    """
+    Builds the host tool tools/face_packer.cpp and packs the BMP files of the data dir into one bundle per clock face.
+    All other files (like clockfaces.txt) are copied.
+
+    :param compress: True to store the images compressed.
+    :param partition_image: If given, the bundles are written into this image for the "faces" partition instead of the SPIFFS files.
+    :param partition_size: Size of the "faces" partition, packing fails if the image is larger.
+    :return: Path to the directory with the files for the SPIFFS image.
+    """
+    project_dir = env.subst("$PROJECT_DIR")
+    data_dir = env.subst("$PROJECT_DATA_DIR")
+    bundle_dir = os.path.join(build_dir, "data_bundles")
+    packer_src = os.path.join(project_dir, "tools", "face_packer.cpp")
+    packer_exe = os.path.join(build_dir, "face_packer.exe" if os.name == 'nt' else "face_packer")
+
+    print("[Post-Build] Building face packer...")
+    compiler = getenv("HOST_CXX", "c++")
+    result = subprocess.run([compiler, "-O2", "-o", packer_exe, packer_src], stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    if result.returncode != 0:
+        print(f"[Error] Failed to build the face packer with '{compiler}' (set HOST_CXX to use another compiler).")
+        print(result.stderr)
+        env.Exit(1)
+
+    if os.path.isdir(bundle_dir):
+        shutil.rmtree(bundle_dir)
+    os.makedirs(bundle_dir)
+
+    print("[Post-Build] Packing clock faces...")
+    packer_cmd = [packer_exe]
+    if compress:
+        packer_cmd.append("--compress")
+    if partition_image:
+        packer_cmd += ["--partition", "--max-size", str(partition_size), data_dir, partition_image]
+    else:
+        packer_cmd += [data_dir, bundle_dir]
+    result = subprocess.run(packer_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    print(result.stdout)
+    if result.returncode != 0:
+        print("[Error] Failed to pack the clock faces.")
+        print(result.stderr)
+        env.Exit(1)
+
+    for name in os.listdir(data_dir):
+        if not name.lower().endswith(('.bmp', '.clk')):
+            shutil.copy(os.path.join(data_dir, name), bundle_dir)
+
+    return bundle_dir
+
 def run_buildfs(source, target, env):
     print("\n[Post-Build] Starting SPIFFS build...")
     
@@ -126,8 +213,25 @@ def run_buildfs(source, target, env):
         "--target",
         "buildfs"
     ]
+
+    # With face bundles, the SPIFFS image is built from the packed files instead of the data dir.
+    # With the face partition, the bundles go into faces.bin and SPIFFS only gets the other files.
+    buildfs_env = os.environ.copy()
+    user_defines_path = os.path.join(env.subst("$PROJECT_SRC_DIR"), "_USER_DEFINES.h")
+    faces_bin = os.path.join(build_dir, "faces.bin")
+    if os.path.isfile(faces_bin):
+        os.remove(faces_bin)  # from an earlier build
+    compress = is_user_define_active(user_defines_path, "COMPRESS_FACE_BUNDLES")
+    if is_user_define_active(user_defines_path, "USE_FACE_PARTITION"):
+        offsets = parse_partition_table(get_partition_csv_path(env))
+        if 'faces' not in offsets:
+            print("[Error] USE_FACE_PARTITION is defined, but the partition table has no 'faces' partition.")
+            env.Exit(1)
+        buildfs_env["PLATFORMIO_DATA_DIR"] = pack_face_bundles(env, compress, faces_bin, offsets['faces_size'])
+    elif compress or is_user_define_active(user_defines_path, "USE_FACE_BUNDLES"):
+        buildfs_env["PLATFORMIO_DATA_DIR"] = pack_face_bundles(env, compress)
     
-    result = subprocess.run(buildfs_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    result = subprocess.run(buildfs_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, env=buildfs_env)
     
     if result.returncode != 0:
         print("[Post-Build] Failed to build SPIFFS filesystem.")
@@ -149,14 +253,7 @@ def run_merge_bins(source, target, env):
     partition_bin = os.path.join(build_dir, "partitions.bin")
 
     # Path to the partition table CSV
-    partition_csv = env.GetProjectOption("board_build.partitions")
-    if not partition_csv:
-        print("[Error] 'board_build.partitions' not defined in platformio.ini.")
-        env.Exit(1)
-
-    partition_csv_path = partition_csv
-    if not os.path.isabs(partition_csv_path):
-        partition_csv_path = os.path.join(env.subst("$PROJECT_DIR"), partition_csv_path)
+    partition_csv_path = get_partition_csv_path(env)
 
     # Parse the partition table to get offsets
     offsets = parse_partition_table(partition_csv_path)
@@ -220,6 +317,17 @@ def run_merge_bins(source, target, env):
         spiffs_offset, spiffs_bin
     ]
 
+    # Image for the "faces" partition, made by run_buildfs() if USE_FACE_PARTITION is defined
+    faces_bin = os.path.join(build_dir, "faces.bin")
+    if os.path.isfile(faces_bin):
+        if 'faces' not in offsets:
+            print("[Error] USE_FACE_PARTITION is defined, but the partition table has no 'faces' partition.")
+            env.Exit(1)
+        if os.path.getsize(faces_bin) > offsets['faces_size']:
+            print(f"[Error] {faces_bin} is larger than the 'faces' partition ({offsets['faces_size']} bytes).")
+            env.Exit(1)
+        merge_cmd += [offsets['faces'], faces_bin]
+
     print(f"[Post-Build] Merging binaries into {combined_bin}...")
     result = subprocess.run(merge_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
 
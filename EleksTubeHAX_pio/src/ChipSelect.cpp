@@ -34,11 +34,35 @@ void ChipSelect::begin()
 #endif
 }
 
+void ChipSelect::setDigitMap(uint8_t map, bool update_)
+{
+  if (beforeChange)
+    beforeChange();
+  digits_map = map;
+#ifndef HARDWARE_IPSTUBE_CLOCK
+  if (update_)
+    update();
+#else
+  // select all LCDs of the map at once, they all receive the same data
+  disableAllCSPins();
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (map & (1 << digit))
+    {
+      currentLCD = digit;
+      enableDigitCSPins(digit);
+    }
+  }
+#endif
+}
+
 void ChipSelect::clear(bool update_)
 {
 #ifndef HARDWARE_IPSTUBE_CLOCK
   setDigitMap(all_off, update_);
 #else
+  if (beforeChange)
+    beforeChange();
   disableAllCSPins();
 #endif
 }
@@ -48,6 +72,8 @@ void ChipSelect::setAll(bool update_)
 #ifndef HARDWARE_IPSTUBE_CLOCK
   setDigitMap(all_on, update_);
 #else
+  if (beforeChange)
+    beforeChange();
   enableAllCSPins();
 #endif
 }
@@ -62,8 +88,11 @@ void ChipSelect::setDigit(uint8_t digit, bool update_)
 #else
   // Set the actual currentLCD value for the given digit and activate the corresponding LCD
 
-  // first deactivate the current LCD
-  disableDigitCSPins(currentLCD);
+  // finish writing to the current LCD
+  if (beforeChange)
+    beforeChange();
+  // first deactivate the current LCD; all others too, more than one may be selected by setAll() or setDigitMap()
+  disableAllCSPins();
   // store the current
   currentLCD = digit;
   // activate the new one
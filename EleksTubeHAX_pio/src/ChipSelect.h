@@ -10,7 +10,7 @@
 class ChipSelect
 {
 public:
-  ChipSelect() {};
+  ChipSelect() : beforeChange(NULL) {};
 
   void begin();
   void update();
@@ -21,12 +21,8 @@ public:
   // So 0 is disabled, 1 is enabled (even though CS is active low, this gets mapped.)
   // So bit 0 (LSB), is index 0, is SECONDS_ONES
   // Translation to what the 74HC595 uses is done in update()
-  void setDigitMap(uint8_t map, bool update_ = true)
-  {
-    digits_map = map;
-    if (update_)
-      update();
-  }
+  // On IPSTUBE clocks the CS pins of all digits in the map are enabled directly.
+  void setDigitMap(uint8_t map, bool update_ = true);
   uint8_t getDigitMap() { return digits_map; }
 
   // Helper functions
@@ -54,7 +50,11 @@ public:
   void enableAllCSPins();
   void disableAllCSPins();
 
+  // Called before other displays are selected. Used to finish a running (DMA) transfer to the currently selected display.
+  void setBeforeChangeCallback(void (*callback)()) { beforeChange = callback; }
+
 private:
+  void (*beforeChange)();
   uint8_t digits_map;
   const uint8_t all_on = 0x3F;
   const uint8_t all_off = 0x00;
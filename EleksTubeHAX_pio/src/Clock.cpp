@@ -64,6 +64,11 @@ void RtcSet(uint32_t tt)
 #endif
   RTC.SetDateTime(temptime);
 }
+
+bool RtcTrim(int8_t aging_offset)
+{ // the DS1302 has no trim, its drift is only corrected in software (see RtcDrift)
+  return false;
+}
 #elif defined(HARDWARE_NovelLife_SE_CLOCK) // for NovelLife_SE clone with R8025T RTC chip
 #include <RTC_RX8025T.h>                   // This header will now use Wire1 for I2C operations.
 
@@ -77,6 +82,9 @@ void RtcBegin()
 #endif
   //RTC_RX8025T.init((uint32_t)RTC_SDA_PIN, (uint32_t)RTC_SCL_PIN, Wire1); // setup second I2C for the RX8025T RTC chip
   RTC.init(RTC_SDA_PIN, RTC_SCL_PIN, Wire1); // setup second I2C for the RX8025T RTC chip
+  // The RX8025T has no frequency trim, only its temperature compensation: run it every 0.5 s (INT_0_5_SEC) instead of
+  // every 2 s, so it follows temperature changes closer. The rest of its drift is corrected in software (see RtcDrift).
+  RTC.tempCompensation(0x00);
 #ifdef DEBUG_OUTPUT_RTC
   Serial.println("DEBUG_OUTPUT_RTC: RTC RX8025T initialized!");
 #endif
@@ -119,6 +127,11 @@ uint32_t RtcGet()
 #endif
   return returnvalue;
 }
+
+bool RtcTrim(int8_t aging_offset)
+{ // no frequency trim, see tempCompensation() in RtcBegin()
+  return false;
+}
 #else // for Elekstube and all other clocks with DS3231 RTC chip or DS1307/PCF8523
 #include <RTClib.h>
 
@@ -227,11 +240,54 @@ void RtcSet(uint32_t tt)
   Serial.println("DEBUG_OUTPUT_RTC: DS3231/DS1307 RTC time updated.");
 #endif
 }
+
+// Writes the aging offset register of the DS3231, a positive offset slows it down (see RTC_AGING_STEP_PPB).
+// Returns false, if the clock has no DS3231 (RTC_DS3231_AGING not defined) or it didn't answer.
+bool RtcTrim(int8_t aging_offset)
+{
+#ifdef RTC_DS3231_AGING
+  Wire.beginTransmission(0x68);
+  Wire.write(0x10); // address of the aging offset register
+  Wire.write((uint8_t)aging_offset);
+  if (Wire.endTransmission() != 0)
+  {
+    Serial.println("Writing the DS3231 aging offset failed!");
+    return false;
+  }
+  // the offset takes effect at the next temperature conversion, start one now (CONV bit of the control register)
+  Wire.beginTransmission(0x68);
+  Wire.write(0x0E);
+  Wire.endTransmission();
+  if (Wire.requestFrom(0x68, 1) == 1)
+  {
+    uint8_t ctrl = Wire.read();
+    Wire.beginTransmission(0x68);
+    Wire.write(0x0E);
+    Wire.write(ctrl | 0x20);
+    Wire.endTransmission();
+  }
+#ifdef DEBUG_OUTPUT_RTC
+  Serial.print("DEBUG_OUTPUT_RTC: DS3231 aging offset set to: ");
+  Serial.println(aging_offset);
+#endif
+  return true;
+#else
+  return false;
+#endif
+}
 #endif // end of RTC chip selection
 
-void Clock::begin(StoredConfig::Config::Clock *config_)
+static const char *const ntp_servers[] = {NTP_SERVERS};
+
+void Clock::begin(StoredConfig::Config::Clock *config_, StoredConfig::Config::RtcDrift *rtc_drift_config,
+                  StoredConfig::Config::TimeZone *time_zone_config)
 {
   config = config_;
+  tz_config = time_zone_config;
+  if (tz_config->is_valid != StoredConfig::valid)
+  { // Not picked yet: a new clock starts with the default zone, one updated from a version without zones keeps its offset.
+    snprintf(tz_config->rule, sizeof(tz_config->rule), "%s", config->is_valid == StoredConfig::valid ? "" : TIME_ZONE_DEFAULT);
+  }
 
   if (config->is_valid != StoredConfig::valid)
   {
@@ -240,35 +296,192 @@ void Clock::begin(StoredConfig::Config::Clock *config_)
     Serial.println("Loaded Clock config is invalid, using default config values. This is normal on first boot.");
     setTwelveHour(false);
     setBlankHoursZero(false);
-    setTimeZoneOffset(1 * 3600); // CET
+    config->time_zone_offset = 1 * 3600; // CET, used if the time zone is set to a fixed offset
     setActiveGraphicIdx(1);
     config->is_valid = StoredConfig::valid;
   }
+  if (tz_config->rule[0] == '\0' || !time_zone.set(tz_config->rule))
+  {
+    tz_config->rule[0] = '\0';
+    time_zone.setFixed(config->time_zone_offset);
+  }
+#ifdef TIME_ZONE
+  if (!setTimeZone(TIME_ZONE))
+  {
+    Serial.println("TIME_ZONE is neither a zone of TimeZones.h nor a POSIX TZ rule, ignored.");
+  }
+#endif
 
   RtcBegin();
+  rtc_drift.begin(rtc_drift_config);
+  if (rtc_drift.getAgingOffset() != 0 && !RtcTrim(rtc_drift.getAgingOffset()))
+  { // the trim is lost when the RTC loses power, program it again; an RTC without trim runs at its own rate
+    rtc_drift.trimmed(0);
+  }
+  rtc_drift.print();
   ntpTimeClient.begin();
-  ntpTimeClient.update();  
-  Serial.print("NTP time = ");
-  //millis_last_ntp = millis();
-  Serial.println(ntpTimeClient.getFormattedTime());
-  setSyncProvider(&Clock::syncProvider);
+  ntpTimeClient.setServers(ntp_servers, sizeof(ntp_servers) / sizeof(ntp_servers[0]));
+  ntpTimeClient.setUpdateCallback(&Clock::ntpUpdated);
+  setSyncProvider(&Clock::syncProvider); // starts the first NTP request, if there is WiFi
+  printTimeZone();
 }
 
 void Clock::loop()
 {
+  ntpTimeClient.poll(); // takes the reply of the NTP server, see ntpUpdated()
   if (timeStatus() == timeNotSet)
   {
     time_valid = false;
   }
   else
   {
-    loop_time = now();
+    if (rtc_phase_second != 0)
+    { // the first loop in the next second of the RTC takes it as time base, if the RTC was read shortly before
+      uint32_t rtc_now = RtcGet();
+      uint32_t since_read = millis() - rtc_phase_millis;
+      if (rtc_now != rtc_phase_second && since_read <= CLOCK_RTC_PHASE_MAX_MS)
+      { // the second started between the two reads
+        uint64_t rtc_ms = (uint64_t)rtc_now * 1000 + since_read / 2;
+        if (rtc_phase_measure)
+        {
+          rtcMeasured(rtc_ms);
+        }
+        else
+        {
+          setTimeBase(rtc_ms - rtc_drift.predictError(rtc_ms), false);
+        }
+        rtc_now = 0;
+      }
+      rtc_phase_second = rtc_now;
+      rtc_phase_millis = millis();
+    }
+    uint64_t epoch_ms = getEpochMillis();
+    if (epoch_ms == 0)
+    { // no time base yet
+      loop_time = now();
+    }
+    else
+    {
+      if (rtc_set_after != 0 && epoch_ms / 1000 > rtc_set_after)
+      { // the RTC starts a new second when it is written, so it is set right at the start of a second
+        RtcSet(epoch_ms / 1000);
+        rtc_set_after = 0;
+        rtc_drift.rtcSet(epoch_ms / 1000);
+        Serial.print("RTC is now set to NTP time = ");
+        Serial.println(RtcGet());
+        config_changed = true; // the learned drift and the new baseline
+      }
+      updateFlipLead(epoch_ms);
+      loop_time = (epoch_ms + flip_lead_ms) / 1000;
+    }
+    config->time_zone_offset = time_zone.getOffset(loop_time); // one comparison, until the next change of the offset
     local_time = loop_time + config->time_zone_offset;
     time_valid = true;
   }
 }
 
+uint64_t Clock::getEpochMillis()
+{
+  if (time_base_ms == 0)
+  {
+    return 0;
+  }
+  return time_base_ms + (millis() - time_base_millis);
+}
+
+void Clock::setTimeBase(uint64_t epoch_ms, bool from_ntp)
+{
+  time_base_ms = epoch_ms;
+  time_base_millis = millis();
+  time_base_ntp = from_ntp;
+}
+
+// Called by loop() at the start of the first RTC second after an NTP update, while the time base is the NTP time.
+void Clock::rtcMeasured(uint64_t rtc_ms)
+{
+  rtc_phase_measure = false;
+  uint64_t epoch_ms = getEpochMillis();
+  int64_t error_ms = (int64_t)(rtc_ms - epoch_ms);
+  error_ms = constrain(error_ms, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+  bool drift = rtc_drift.measured(epoch_ms, (int32_t)error_ms);
+  rtc_drift.print();
+
+  int32_t residual_ms = abs(rtc_drift.getResidual());
+  if (!drift || !rtc_drift.isConfident())
+  { // the RTC has to be watched, until the drift is known
+    ntp_interval_ms = CLOCK_NTP_MIN_INTERVAL_S * 1000;
+  }
+  else if (residual_ms > CLOCK_NTP_TARGET_ERROR_MS)
+  {
+    ntp_interval_ms = max(ntp_interval_ms / 2, (uint32_t)CLOCK_NTP_MIN_INTERVAL_S * 1000);
+  }
+  else if (residual_ms <= CLOCK_NTP_TARGET_ERROR_MS / 2)
+  { // the drift predicted the error well, it can do so for longer
+    ntp_interval_ms = min(2 * ntp_interval_ms, (uint32_t)CLOCK_NTP_MAX_INTERVAL_S * 1000);
+  }
+  Serial.printf("Next NTP update in %lu s.\n", (unsigned long)(ntp_interval_ms / 1000));
+
+  bool set = !drift || abs(error_ms) > CLOCK_RTC_MAX_ERROR_MS;
+  int8_t aging_offset = rtc_drift.getBestAgingOffset();
+  if (aging_offset != rtc_drift.getAgingOffset() && RtcTrim(aging_offset))
+  { // a new baseline starts with the new rate
+    Serial.printf("RTC aging offset changed to %d.\n", aging_offset);
+    rtc_drift.trimmed(aging_offset);
+    set = true;
+  }
+  if (set)
+  { // Set the RTC at the start of the next second: that aligns its seconds with NTP.
+    Serial.println(drift ? "RTC is too far off, updating RTC." : "RTC time is not valid, updating RTC.");
+    rtc_set_after = epoch_ms / 1000;
+  }
+}
+
+// Drawing takes about the same time per image, so the lead is that time per image drawn at the next second. Changed
+// digits that show the same value are drawn together (see TFTs::setDigits()), as one image.
+void Clock::updateFlipLead(uint64_t epoch_ms)
+{
+  time_t next_second = epoch_ms / 1000 + 1;
+  if (next_second == flip_lead_second)
+  {
+    return;
+  }
+  flip_lead_second = next_second;
+  uint8_t current[NUM_DIGITS], next[NUM_DIGITS];
+  getDigitsAt(next_second - 1 + time_zone.getOffset(next_second - 1), current);
+  getDigitsAt(next_second + time_zone.getOffset(next_second), next);
+  uint8_t images = 0;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    bool drawn_before = false;
+    for (uint8_t other = 0; other < digit; other++)
+    {
+      drawn_before |= current[other] != next[other] && next[other] == next[digit];
+    }
+    if (current[digit] != next[digit] && !drawn_before)
+    {
+      images++;
+    }
+  }
+  flip_lead_ms = min((uint32_t)(images * flip_us_per_image / 1000), (uint32_t)CLOCK_MAX_FLIP_LEAD_MS);
+}
+
+uint32_t Clock::getMillisToNextFlip()
+{
+  uint64_t epoch_ms = getEpochMillis();
+  if (epoch_ms == 0)
+  {
+    return 1000;
+  }
+  uint32_t ms = 1000 - (epoch_ms + flip_lead_ms) % 1000;
+  if (rtc_set_after != 0)
+  {
+    ms = min(ms, (uint32_t)(1000 - epoch_ms % 1000));
+  }
+  return ms;
+}
+
 // Static methods used for sync provider to TimeLib library.
+// Only reads the RTC; the NTP request is sent from here, but its reply is taken by Clock::loop() (see ntpUpdated()).
 time_t Clock::syncProvider()
 {
 #ifdef DEBUG_OUTPUT_RTC
@@ -277,51 +490,34 @@ time_t Clock::syncProvider()
   time_t rtc_now;
   rtc_now = RtcGet(); // Get the RTC time
 
-  if (millis() - millis_last_ntp > refresh_ntp_every_ms || millis_last_ntp == 0) // Get NTP time only every 10 minutes or if not yet done
+  if (!rtc_phase_measure && (!time_base_ntp || rtc_drift.isConfident() || millis() - millis_last_ntp > 2 * ntp_interval_ms))
+  { // No recent NTP time, or the RTC corrected by its drift is better than millis(): the RTC is the time base. Its
+    // seconds start at the next change of the RTC time (see loop()).
+    if (time_base_ms == 0)
+    {
+      setTimeBase((uint64_t)rtc_now * 1000 - rtc_drift.predictError((uint64_t)rtc_now * 1000), false);
+    }
+    rtc_phase_second = rtc_now;
+    rtc_phase_millis = millis();
+  }
+
+  if (millis() - millis_last_ntp > ntp_interval_ms || millis_last_ntp == 0) // Get NTP time only every interval or if not yet done
   { // It's time to get a new NTP sync
     if (WifiState == connected)
     { // We have WiFi, so try to get NTP time.
-      Serial.print("Try to get the actual time from NTP server...");
-      if (ntpTimeClient.update())
+      if (ntpTimeClient.isUpdating())
       {
-        Serial.println("NTP query done.");
-        time_t ntp_now = ntpTimeClient.getEpochTime();
-        Serial.print("NTP time = ");
-        Serial.println(ntpTimeClient.getFormattedTime());
-        rtc_now = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
-        // Sync the RTC to NTP if needed.
-        Serial.print("NTP  :");
-        Serial.println(ntp_now);
-        Serial.print("RTC  :");
-        Serial.println(rtc_now);
-        Serial.print("Diff: ");
-        Serial.println(ntp_now - rtc_now);
-        if ((ntp_now != rtc_now) && (ntp_now > 1743364444)) // check if we have a difference and a valid NTP time
-        {                                                   // NTP time is valid and different from RTC time
-          Serial.println("RTC time is not valid, updating RTC.");
-          RtcSet(ntp_now);
-          Serial.println("RTC is now set to NTP time.");
-          rtc_now = RtcGet(); // Check if RTC time is set correctly
-          Serial.print("RTC time = ");
-          Serial.println(rtc_now);
-        }
-        else if ((ntp_now != rtc_now) && (ntp_now < 1743364444))
-        { // NTP can't be valid!
-          Serial.println("Time returned from NTP is not valid! Using RTC time!");
-          rtc_now = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
-          return rtc_now;
-        }
-        millis_last_ntp = millis(); // store the last time we tried to get NTP time
-
-        Serial.println("Using NTP time!");
-        return ntp_now;
+        Serial.println("Waiting for the NTP server, using RTC time.");
+      }
+      else if (ntpTimeClient.beginUpdate())
+      {
+        Serial.println("NTP update started, using RTC time until the replies.");
       }
       else
-      {                     // NTP return value is not valid
-        rtc_now = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
-        Serial.println("Invalid NTP response, using RTC time.");
-        return rtc_now;
+      {
+        Serial.println("NTP request failed, using RTC time.");
       }
+      return rtc_now;
     } // no WiFi!
     Serial.println("No WiFi, using RTC time.");
     return rtc_now;
@@ -330,6 +526,95 @@ time_t Clock::syncProvider()
   return rtc_now;
 }
 
+// Called by ntpTimeClient.poll() in Clock::loop() at the end of the NTP update.
+void Clock::ntpUpdated(bool success)
+{
+  ntpTimeClient.printServers();
+  if (!success)
+  { // the servers don't agree or didn't answer, try again at the next sync
+    Serial.println("No valid NTP time, using RTC time.");
+    return;
+  }
+  Serial.println("NTP query done.");
+  time_t ntp_now = ntpTimeClient.getEpochTime();
+  Serial.print("NTP time = ");
+  Serial.println(ntpTimeClient.getFormattedTime());
+  time_t rtc_now = RtcGet();
+  Serial.print("NTP  :");
+  Serial.println(ntp_now);
+  Serial.print("RTC  :");
+  Serial.println(rtc_now);
+  Serial.print("Diff: ");
+  Serial.println(ntp_now - rtc_now);
+  Serial.print("Round trip (us): ");
+  Serial.println(ntpTimeClient.getRoundTrip());
+  if (ntpTimeClient.isConfident())
+  { // Measure the RTC error at the start of its next second, that decides if the RTC is set (see rtcMeasured()).
+    rtc_phase_second = rtc_now;
+    rtc_phase_millis = millis();
+    rtc_phase_measure = true;
+  }
+  else
+  {
+    Serial.println("NTP time is not exact enough to measure or set the RTC.");
+    rtc_phase_second = 0;
+    rtc_phase_measure = false;
+  }
+  millis_last_ntp = millis(); // store the last time we got the NTP time
+  setTimeBase(ntpTimeClient.getEpochMillis(), true);
+
+  Serial.println("Using NTP time!");
+  setTime(ntp_now); // TimeLib: use it now, not only from the next sync on
+}
+
+void Clock::setTimeZoneOffset(time_t offset)
+{
+  config->time_zone_offset = offset;
+  time_zone.setFixed(offset);
+  tz_config->rule[0] = '\0';
+  tz_config->is_valid = StoredConfig::valid;
+}
+
+bool Clock::setTimeZone(const char *zone)
+{
+  const char *rule = TimeZone::lookup(zone);
+  if (rule == NULL)
+  {
+    rule = zone;
+  }
+  if (strlen(rule) >= sizeof(tz_config->rule) || !time_zone.set(rule))
+  {
+    return false;
+  }
+  snprintf(tz_config->rule, sizeof(tz_config->rule), "%s", rule);
+  tz_config->is_valid = StoredConfig::valid;
+  config->time_zone_offset = time_zone.getOffset(loop_time);
+  return true;
+}
+
+void Clock::printTimeZone()
+{
+  time_t utc = getEpochMillis() > 0 ? getEpochMillis() / 1000 : now();
+  int32_t offset = time_zone.getOffset(utc);
+  Serial.printf("Time zone %s: UTC%c%ld:%02ld%s\n", tz_config->rule[0] != '\0' ? tz_config->rule : "with fixed offset",
+                offset < 0 ? '-' : '+', (long)(abs(offset) / 3600), (long)(abs(offset) % 3600 / 60),
+                time_zone.isDst(utc) ? " (daylight saving time)" : "");
+  time_t change = time_zone.getNextChange(utc);
+  if (change != 0)
+  {
+    int32_t next_offset = time_zone.getOffset(change);
+    Serial.printf("Next change %04d-%02d-%02d %02d:%02d UTC, to UTC%c%ld:%02ld\n", year(change), month(change), day(change),
+                  hour(change), minute(change), next_offset < 0 ? '-' : '+', (long)(abs(next_offset) / 3600),
+                  (long)(abs(next_offset) % 3600 / 60));
+  }
+}
+
+void Clock::printRtcDrift()
+{
+  rtc_drift.print();
+  Serial.printf("NTP update interval %lu s\n", (unsigned long)(ntp_interval_ms / 1000));
+}
+
 uint8_t Clock::getHoursTens()
 {
   uint8_t hour_tens = getHour() / 10;
@@ -344,6 +629,36 @@ uint8_t Clock::getHoursTens()
   }
 }
 
+void Clock::getDigitsAt(time_t local, uint8_t *digits)
+{
+  uint8_t hours = config->twelve_hour ? hourFormat12(local) : hour(local);
+  uint8_t minutes = minute(local);
+  uint8_t seconds = second(local);
+
+  digits[SECONDS_ONES] = seconds % 10;
+  digits[SECONDS_TENS] = seconds / 10;
+  digits[MINUTES_ONES] = minutes % 10;
+  digits[MINUTES_TENS] = minutes / 10;
+  digits[HOURS_ONES] = hours % 10;
+  if (config->blank_hours_zero && hours / 10 == 0)
+  {
+    digits[HOURS_TENS] = TFTs::blanked;
+  }
+  else
+  {
+    digits[HOURS_TENS] = hours / 10;
+  }
+}
+
 uint32_t Clock::millis_last_ntp = 0;
+uint32_t Clock::ntp_interval_ms = CLOCK_NTP_MIN_INTERVAL_S * 1000;
+RtcDrift Clock::rtc_drift;
+uint64_t Clock::time_base_ms = 0;
+uint32_t Clock::time_base_millis = 0;
+bool Clock::time_base_ntp = false;
+uint32_t Clock::rtc_phase_second = 0;
+uint32_t Clock::rtc_phase_millis = 0;
+bool Clock::rtc_phase_measure = false;
+uint32_t Clock::rtc_set_after = 0;
 WiFiUDP Clock::ntpUDP;
 NTPClient Clock::ntpTimeClient(ntpUDP);
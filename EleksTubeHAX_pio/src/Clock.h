@@ -10,21 +10,46 @@
 #include "NTPClient_AO.h"
 
 #include "StoredConfig.h"
+#include "RtcDrift.h"
+#include "TimeZone.h"
 // For TFTs::blanked
 #include "TFTs.h"
 
 class Clock
 {
 public:
-  Clock() : loop_time(0), local_time(0), time_valid(false), config(NULL) {}
+  Clock() : loop_time(0), local_time(0), time_valid(false), config_changed(false), config(NULL), tz_config(NULL), flip_us_per_image(0), flip_lead_ms(0), flip_lead_second(0) {}
 
   // The global WiFi from WiFi.h must already be .begin()'d before calling Clock::begin()
-  void begin(StoredConfig::Config::Clock *config_);
+  void begin(StoredConfig::Config::Clock *config_, StoredConfig::Config::RtcDrift *rtc_drift_config,
+             StoredConfig::Config::TimeZone *time_zone_config);
   void loop();
+  // Returns true once after loop() changed the stored config (the learned RTC drift), so the caller saves it.
+  bool configChanged()
+  {
+    bool changed = config_changed;
+    config_changed = false;
+    return changed;
+  }
 
-  // Calls NTPClient::getEpochTime() or RTC::get() as appropriate
+  // Returns the RTC time and starts an NTP update, if one is due. Never waits for the NTP server.
   // This has to be static to pass to TimeLib::setSyncProvider.
   static time_t syncProvider();
+  // Takes the NTP time, when the update started by syncProvider() is done. Called from loop() via NTPClient::poll().
+  static void ntpUpdated(bool success);
+
+  // Time with millisecond resolution next to TimeLib, in UTC ms since 1970 (0, if not known yet). Taken from the NTP
+  // reply, or from the moment the RTC starts a new second (corrected by its learned drift), and counted on with millis().
+  static uint64_t getEpochMillis();
+  // Time to draw one image at a second change, in us. loop_time moves to the next second that many us per image to
+  // draw (at most CLOCK_MAX_FLIP_LEAD_MS) before the second starts, so the digits are on the displays at its start.
+  void setFlipTimePerImage(uint32_t us) { flip_us_per_image = us; }
+  // ms until loop_time moves to the next second (or until the RTC is set at the start of a second), 1..1000.
+  uint32_t getMillisToNextFlip();
+  // Diagnostics of the RTC: its learned drift and the NTP update interval that follows from it.
+  static const RtcDrift &getRtcDrift() { return rtc_drift; }
+  static uint32_t getNtpInterval() { return ntp_interval_ms / 1000; } // s
+  static void printRtcDrift();
 
   // Set preferred hour format. true = 12hr, false = 24hr
   void setTwelveHour(bool th) { config->twelve_hour = th; }
@@ -36,9 +61,20 @@ public:
   void toggleBlankHoursZero() { config->blank_hours_zero = !config->blank_hours_zero; }
 
   // Internal time is kept in UTC. This affects the displayed time.
-  void setTimeZoneOffset(time_t offset) { config->time_zone_offset = offset; }
+  // A fixed UTC offset, without daylight saving time (replaces the time zone).
+  void setTimeZoneOffset(time_t offset);
+  // The offset now, of the time zone or the fixed one.
   time_t getTimeZoneOffset() { return config->time_zone_offset; }
-  void adjustTimeZoneOffset(time_t adj) { config->time_zone_offset += adj; }
+  void adjustTimeZoneOffset(time_t adj) { setTimeZoneOffset(config->time_zone_offset + adj); }
+  // The offset at utc: the time zone switches daylight saving time right at the second it changes.
+  time_t getTimeZoneOffsetAt(time_t utc) { return time_zone.getOffset(utc); }
+  // Time zone by name (see TimeZones.h) or POSIX TZ rule, stored as its rule. Returns false, if it is neither.
+  bool setTimeZone(const char *zone);
+  // The POSIX TZ rule of the time zone, "" if a fixed offset is used.
+  const char *getTimeZone() { return tz_config->rule; }
+  // true, if the time zone or offset was picked (TIME_ZONE, geolocation, menu, serial command), not the default one.
+  bool isTimeZonePicked() { return tz_config->is_valid == StoredConfig::valid; }
+  void printTimeZone();
   void setActiveGraphicIdx(int8_t idx) { config->selected_graphic = idx; }
   int8_t getActiveGraphicIdx() { return config->selected_graphic; }
   void adjustClockGraphicsIdx(int8_t adj)
@@ -96,17 +132,40 @@ public:
   uint8_t getSecondsTens() { return getSecond() / 10; }
   uint8_t getSecondsOnes() { return getSecond() % 10; }
 
+  // Fills digits[NUM_DIGITS] with the values shown at the given local time, incl. 12/24 hour format and blanking of the hours zero.
+  // Used to find out in advance, which images will be needed.
+  void getDigitsAt(time_t local, uint8_t *digits);
+
   time_t loop_time, local_time;
 
 private:
   bool time_valid;
+  bool config_changed;
   StoredConfig::Config::Clock *config;
+  StoredConfig::Config::TimeZone *tz_config;
+  TimeZone time_zone;
+  uint32_t flip_us_per_image;
+  uint32_t flip_lead_ms;   // the next second is shown this much early
+  time_t flip_lead_second; // the second flip_lead_ms was calculated for
+  void updateFlipLead(uint64_t epoch_ms);
 
   // Static variables needed for syncProvider()
   static WiFiUDP ntpUDP;
   static NTPClient ntpTimeClient;
   static uint32_t millis_last_ntp;
-  const static uint32_t refresh_ntp_every_ms = 3600000; // Get new NTP every hour, use RTC in between.
+  static uint32_t ntp_interval_ms; // NTP updates are this far apart: longer while the drift predicts the RTC well
+  static RtcDrift rtc_drift;
+  // Time base of getEpochMillis()
+  static uint64_t time_base_ms;     // UTC ms since 1970 at time_base_millis
+  static uint32_t time_base_millis;
+  static bool time_base_ntp;        // taken from NTP, not from the RTC
+  static uint32_t rtc_phase_second; // RTC time, whose end is awaited to find the start of the RTC seconds (0: none)
+  static uint32_t rtc_phase_millis; // when rtc_phase_second was read
+  static bool rtc_phase_measure;    // compare the start of the RTC second with the NTP time, instead of taking it
+  static uint32_t rtc_set_after;    // set the RTC to the time base at the start of the second after this (0: none)
+  static void setTimeBase(uint64_t epoch_ms, bool from_ntp);
+  // Learns from the RTC error at the NTP time, trims the RTC and decides if it is set, adapts the NTP interval.
+  static void rtcMeasured(uint64_t rtc_ms);
 };
 
 extern Clock uclock;
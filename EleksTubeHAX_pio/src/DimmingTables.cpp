@@ -0,0 +1,19 @@
+#include "DimmingTables.h"
+
+void DimmingTables::build()
+{
+#ifdef DIMMING_GAMMA
+  uint32_t factor = (uint32_t)(pow(level / 255.0, DIMMING_GAMMA) * 256.0 + 0.5); // 0..256
+#else
+  uint32_t factor = level + (level >> 7); // 0..256, so 255 doesn't change the colors
+#endif
+  for (uint8_t i = 0; i < 32; i++)
+  {
+    red[i] = ((i * factor) >> 8) << 11;
+    blue[i] = (i * factor) >> 8;
+  }
+  for (uint8_t i = 0; i < 64; i++)
+  {
+    green[i] = ((i * factor) >> 8) << 5;
+  }
+}
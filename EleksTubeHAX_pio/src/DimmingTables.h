@@ -0,0 +1,43 @@
+#ifndef DIMMING_TABLES_H
+#define DIMMING_TABLES_H
+
+#include "GLOBAL_DEFINES.h"
+
+/*
+ * Lookup tables for the software dimming of RGB565 pixels, one table per color channel (5, 6 and 5 bit).
+ * The tables are rebuilt only when the dimming value changes, dimming a pixel is then three lookups.
+ * If DIMMING_GAMMA is defined, the dimming value is handled as perceived brightness: channels are scaled by (dimming/255)^gamma.
+ */
+
+class DimmingTables
+{
+public:
+  DimmingTables() : level(255) { build(); }
+
+  // Rebuilds the tables, if the dimming value is different from the last one.
+  void setLevel(uint8_t dimming)
+  {
+    if (dimming != level)
+    {
+      level = dimming;
+      build();
+    }
+  }
+  uint8_t getLevel() { return level; }
+
+  uint16_t dim(uint16_t color) const
+  {
+    return red[color >> 11] | green[(color >> 5) & 0x3F] | blue[color & 0x1F];
+  }
+
+private:
+  uint8_t level;
+  // already shifted to their position in the RGB565 value
+  uint16_t red[32];
+  uint16_t green[64];
+  uint16_t blue[32];
+
+  void build();
+};
+
+#endif // DIMMING_TABLES_H
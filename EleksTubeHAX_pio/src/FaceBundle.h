@@ -0,0 +1,79 @@
+#ifndef FACE_BUNDLE_H
+#define FACE_BUNDLE_H
+
+#include <stdint.h>
+
+/*
+ * Clock face bundle: all ten digit images of one clock face in one file ("/1.fcb" for clock face 1, ...).
+ * Made from the BMP files by tools/face_packer.cpp. Used by the firmware if USE_FACE_BUNDLES is defined.
+ *
+ * All values are little-endian.
+ *   0: magic "FB"
+ *   2: version (FACE_BUNDLE_VERSION)
+ *   3: number of entries (always FACE_BUNDLE_DIGITS)
+ *   4: FACE_BUNDLE_DIGITS entries of FaceBundleEntry, index is the digit
+ *   FACE_BUNDLE_HEADER_SIZE: image data, every image starts at a multiple of 4
+ *
+ * Shared with the host tool, so only plain C types here.
+ */
+
+#define FACE_BUNDLE_MAGIC (0x4246) // "FB"
+#define FACE_BUNDLE_VERSION (1)
+#define FACE_BUNDLE_DIGITS (10)
+#define FACE_BUNDLE_ENTRY_SIZE (16)
+#define FACE_BUNDLE_HEADER_SIZE (4 + FACE_BUNDLE_DIGITS * FACE_BUNDLE_ENTRY_SIZE)
+
+// Formats of the image data
+#define FACE_BUNDLE_FORMAT_RGB565 (0) // w * h pixels, top line first, RGB565 in the byte order of the display (MSB first)
+#define FACE_BUNDLE_FORMAT_QOI565 (1) // the same pixels, compressed (see Qoi565.h)
+
+/*
+ * Face partition: the bundles of all clock faces in the data partition "faces", if USE_FACE_PARTITION is defined.
+ *   0: magic "FP"
+ *   2: version (FACE_PARTITION_VERSION)
+ *   3: number of clock faces
+ *   4: FACE_PARTITION_MAX_FACES offsets of the bundles (clock face 1 first), 0 if the clock face is not there
+ * The bundles start at multiples of 4, so the images in the memory-mapped partition can be read as 32-bit words.
+ * Only FACE_PARTITION_MAX_MAP_SIZE bytes of it can be used: the ESP32 maps flash for data through a window of 4 MB
+ * (64 pages of 64 KB), and the constants of the app need some of these pages. tools/face_packer.cpp checks it.
+ */
+#define FACE_PARTITION_MAGIC (0x5046) // "FP"
+#define FACE_PARTITION_VERSION (1)
+#define FACE_PARTITION_MAX_FACES (9)
+#define FACE_PARTITION_HEADER_SIZE (4 + FACE_PARTITION_MAX_FACES * 4)
+#define FACE_PARTITION_NAME "faces"
+#define FACE_PARTITION_SUBTYPE (0x40) // first custom data subtype
+#define FACE_PARTITION_MAX_MAP_SIZE (0x300000) // 48 pages of 64 KB, 16 are left for the app
+
+struct FaceBundleEntry
+{
+  uint32_t offset; // position of the image data in the file
+  uint32_t size;   // bytes of image data
+  uint16_t w, h;   // image size
+  uint8_t format;  // FACE_BUNDLE_FORMAT_...
+  uint8_t reserved[3];
+};
+
+// true, if size bytes at offset fit into total bytes; without the overflow of offset + size
+static inline bool faceBundleRangeValid(uint32_t offset, uint32_t size, uint32_t total)
+{
+  return offset <= total && size <= total - offset;
+}
+
+// Checks size and format of an image, not its position in the file.
+static inline bool faceBundleEntryValid(const FaceBundleEntry &entry, uint16_t maxW, uint16_t maxH)
+{
+  if (entry.w == 0 || entry.h == 0 || entry.w > maxW || entry.h > maxH)
+    return false;
+  switch (entry.format)
+  {
+  case FACE_BUNDLE_FORMAT_RGB565:
+    return entry.size == (uint32_t)entry.w * entry.h * 2;
+  case FACE_BUNDLE_FORMAT_QOI565:
+    return entry.size > 0;
+  default:
+    return false;
+  }
+}
+
+#endif // FACE_BUNDLE_H
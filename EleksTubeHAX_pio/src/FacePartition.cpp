@@ -0,0 +1,115 @@
+#include "FacePartition.h"
+
+bool FacePartition::begin()
+{
+  faces = 0;
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)FACE_PARTITION_SUBTYPE, FACE_PARTITION_NAME);
+  if (partition == NULL)
+  {
+    Serial.println("Partition \"" FACE_PARTITION_NAME "\" not found! Check the partition table.");
+    return false;
+  }
+  uint8_t header[FACE_PARTITION_HEADER_SIZE];
+  if (esp_partition_read(partition, 0, header, sizeof(header)) != ESP_OK || get16(&header[0]) != FACE_PARTITION_MAGIC ||
+      header[2] != FACE_PARTITION_VERSION || header[3] > FACE_PARTITION_MAX_FACES)
+  {
+    Serial.println("Face partition is empty or broken! Flash the partition image made by tools/face_packer.cpp.");
+    return false;
+  }
+  size = usedSize(partition, header);
+  if (size > FACE_PARTITION_MAX_MAP_SIZE)
+  {
+    Serial.printf("Clock faces take %u bytes of the face partition, only %u can be mapped! Use COMPRESS_FACE_BUNDLES or fewer clock faces.\n",
+                  (unsigned)size, (unsigned)FACE_PARTITION_MAX_MAP_SIZE);
+    size = FACE_PARTITION_MAX_MAP_SIZE; // the clock faces after that are dropped by checkBundle()
+  }
+  const void *mapped;
+  if (esp_partition_mmap(partition, 0, size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK)
+  {
+    Serial.println("Mapping the face partition failed!");
+    return false;
+  }
+  data = (const uint8_t *)mapped;
+
+  // use the clock faces up to the first broken one
+  uint8_t count = data[3];
+  while ((faces < count) && checkBundle(faces + 1))
+  {
+    faces++;
+  }
+  return faces > 0;
+}
+
+// End of the last image of the clock faces in the header, read from the partition without mapping it.
+// Broken offsets are left out here, checkBundle() finds them.
+uint32_t FacePartition::usedSize(const esp_partition_t *partition, const uint8_t *header)
+{
+  uint32_t used = FACE_PARTITION_HEADER_SIZE;
+  for (uint8_t face = 1; face <= header[3]; face++)
+  {
+    uint32_t bundle = get32(&header[4 + (face - 1) * 4]);
+    uint8_t raw[FACE_BUNDLE_HEADER_SIZE];
+    if (!faceBundleRangeValid(bundle, sizeof(raw), partition->size) || esp_partition_read(partition, bundle, raw, sizeof(raw)) != ESP_OK)
+    {
+      break;
+    }
+    used = max(used, bundle + (uint32_t)sizeof(raw));
+    for (uint8_t digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+    {
+      uint32_t offset = get32(&raw[4 + digit * FACE_BUNDLE_ENTRY_SIZE]);
+      uint32_t bytes = get32(&raw[8 + digit * FACE_BUNDLE_ENTRY_SIZE]);
+      if (faceBundleRangeValid(offset, bytes, partition->size - bundle))
+      {
+        used = max(used, bundle + offset + bytes);
+      }
+    }
+  }
+  return used;
+}
+
+void FacePartition::readEntry(uint32_t bundle, uint8_t digit, FaceBundleEntry &entry)
+{
+  const uint8_t *raw = &data[bundle + 4 + digit * FACE_BUNDLE_ENTRY_SIZE];
+  entry.offset = get32(&raw[0]);
+  entry.size = get32(&raw[4]);
+  entry.w = get16(&raw[8]);
+  entry.h = get16(&raw[10]);
+  entry.format = raw[12];
+}
+
+// Same checks as TFTs::OpenBundle(), done once at boot, so getImage() doesn't need them.
+bool FacePartition::checkBundle(uint8_t face)
+{
+  uint32_t bundle = bundleOffset(face);
+  if ((bundle < FACE_PARTITION_HEADER_SIZE) || (bundle % 4) || !faceBundleRangeValid(bundle, FACE_BUNDLE_HEADER_SIZE, size) ||
+      (get16(&data[bundle]) != FACE_BUNDLE_MAGIC) || (data[bundle + 2] != FACE_BUNDLE_VERSION) || (data[bundle + 3] != FACE_BUNDLE_DIGITS))
+  {
+    Serial.print("Clock face bundle broken in partition: ");
+    Serial.println(face);
+    return false;
+  }
+  for (uint8_t digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+  {
+    FaceBundleEntry entry;
+    readEntry(bundle, digit, entry);
+    if (!faceBundleEntryValid(entry, TFT_WIDTH, TFT_HEIGHT) || entry.offset < FACE_BUNDLE_HEADER_SIZE ||
+        (entry.offset % 4) || !faceBundleRangeValid(entry.offset, entry.size, size - bundle))
+    {
+      Serial.print("Clock face bundle broken in partition: ");
+      Serial.println(face);
+      return false;
+    }
+  }
+  return true;
+}
+
+const uint8_t *FacePartition::getImage(uint8_t face, uint8_t digit, FaceBundleEntry &entry)
+{
+  if ((face < 1) || (face > faces) || (digit >= FACE_BUNDLE_DIGITS))
+  {
+    return NULL;
+  }
+  uint32_t bundle = bundleOffset(face);
+  readEntry(bundle, digit, entry);
+  return &data[bundle + entry.offset];
+}
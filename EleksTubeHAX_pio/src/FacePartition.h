@@ -0,0 +1,41 @@
+#ifndef FACE_PARTITION_H
+#define FACE_PARTITION_H
+
+#include "GLOBAL_DEFINES.h"
+#include "FaceBundle.h"
+#include <esp_partition.h>
+
+/*
+ * Reads the clock face bundles from the data partition "faces" (see FaceBundle.h), if USE_FACE_PARTITION is defined.
+ * The partition is memory-mapped once, up to the end of the last bundle, so the pixels of an image can be read directly
+ * from flash, without opening files and without copying them into RAM first. The headers are read before, to find that
+ * end: the partition may be larger than what can be mapped (see FACE_PARTITION_MAX_MAP_SIZE).
+ */
+
+class FacePartition
+{
+public:
+  FacePartition() : data(NULL), size(0), faces(0) {}
+
+  // Finds and maps the partition and checks all bundles in it. Returns false, if there are no usable clock faces.
+  bool begin();
+  uint8_t getNumberOfClockFaces() { return faces; }
+
+  // Returns the pixels of the image in the mapped flash and fills entry, NULL if the image is not there.
+  const uint8_t *getImage(uint8_t face, uint8_t digit, FaceBundleEntry &entry);
+
+private:
+  const uint8_t *data; // start of the mapped partition
+  uint32_t size;
+  uint8_t faces;
+  spi_flash_mmap_handle_t handle;
+
+  uint32_t bundleOffset(uint8_t face) { return get32(&data[4 + (face - 1) * 4]); }
+  void readEntry(uint32_t bundle, uint8_t digit, FaceBundleEntry &entry);
+  bool checkBundle(uint8_t face);
+  static uint32_t usedSize(const esp_partition_t *partition, const uint8_t *header);
+  static uint16_t get16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+  static uint32_t get32(const uint8_t *data) { return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24); }
+};
+
+#endif // FACE_PARTITION_H
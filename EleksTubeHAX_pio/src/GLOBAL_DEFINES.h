@@ -34,6 +34,39 @@
 // ************ MQTT config *********************
 #define MQTT_RECONNECT_WAIT_SEC 30      // how long to wait between retries to connect to broker
 #define MQTT_REPORT_STATUS_EVERY_SEC 15 // How often report status to MQTT Broker
+#define MQTT_REPORT_DIAGNOSTICS_EVERY_SEC 300 // How often to send the render statistics to "<MQTT_CLIENT>/diagnostics/render" and the RTC drift to ".../diagnostics/rtc"
+
+// ************ Clock config *********************
+#define CLOCK_MAX_FLIP_LEAD_MS 500 // the digits of the next second are drawn at most this long before the second starts
+#define CLOCK_RTC_PHASE_MAX_MS 100 // the start of an RTC second is taken only if the RTC was read this shortly before
+#define CLOCK_RTC_MAX_ERROR_MS 250 // the RTC is set to the NTP time only if it is further off (its drift is corrected)
+#define CLOCK_NTP_MIN_INTERVAL_S 3600  // NTP update interval while the RTC drift is not known or not predicted well
+#define CLOCK_NTP_MAX_INTERVAL_S 86400 // the interval doubles up to this while the drift predicts the RTC error within half
+#define CLOCK_NTP_TARGET_ERROR_MS 50   // of this, and halves if the error is larger
+
+// ************ Time zone config *********************
+#define TIME_ZONE_DEFAULT "CET-1CEST,M3.5.0,M10.5.0/3" // POSIX TZ rule of a new clock, until the zone is picked (TIME_ZONE, geolocation, menu, serial command "tz")
+
+// ************ RTC drift config *********************
+#define RTC_DRIFT_MIN_HOURS 6         // the learned drift corrects the RTC time after this many hours of measurements
+#define RTC_DRIFT_MAX_HOURS 168       // older measurements count as this many hours at most, so the drift follows aging
+#define RTC_DRIFT_MIN_BASELINE_S 1800 // a measurement is used only if the RTC was set this long before
+#define RTC_DRIFT_MAX_PPM 200         // a larger error is not drift: the RTC lost power or was set by someone else
+#define RTC_AGING_STEP_PPB 100        // DS3231: one step of the aging offset slows the RTC down by about 0.1 ppm
+#define RTC_AGING_HYSTERESIS 2        // the aging offset is changed only if the drift with it is this many steps off
+#define RTC_AGING_MIN_HOURS 24        // and after this many hours of measurements, so noise doesn't move it
+
+// ************ NTP config *********************
+#ifndef NTP_SERVERS // can be set in _USER_DEFINES.h
+#define NTP_SERVERS "0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "3.pool.ntp.org"
+#endif
+#define NTP_MAX_SERVERS 4             // servers of NTP_SERVERS that are used at most
+#define NTP_BURST 4                   // requests to every server per update
+#define NTP_BURST_SPACING_MS 2000     // between two requests to the same server; public servers limit the request rate
+#define NTP_FILTER_SAMPLES 8          // samples kept per server; the one with the shortest round trip (and age) is used
+#define NTP_MIN_SURVIVORS 2           // the time is used only if this many servers agree (all, if fewer are configured)
+#define NTP_MAX_DISTANCE_MS 100       // and the RTC is set only if the time is known this exactly
+#define NTP_MIN_VALID_TIME 1743364444 // replies before this time (2025-03-30) are bogus
 
 // ************ Backlight config *********************
 #define DEFAULT_BL_RAINBOW_DURATION_SEC 8
@@ -215,6 +248,7 @@
 // I2C to DS3231 RTC.
 #define RTC_SCL_PIN (22)
 #define RTC_SDA_PIN (21)
+#define RTC_DS3231_AGING // trim the frequency of the RTC with its aging offset register (see RtcDrift)
 
 // Chip Select shift register, to select the display
 #define CSSR_DATA_PIN (14)
@@ -275,6 +309,7 @@
 // I2C to DS3231 RTC.
 #define RTC_SCL_PIN (22)
 #define RTC_SDA_PIN (21)
+#define RTC_DS3231_AGING // trim the frequency of the RTC with its aging offset register (see RtcDrift)
 
 // Chip Select shift register, to select the display
 #define CSSR_DATA_PIN (14)
@@ -433,6 +468,35 @@
 
 #endif // IPSTUBE clock models (H401 and H402) XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
+// ************ Image cache config *********************
+// Number of decoded images kept in RAM (one 135x240 RGB565 frame = 64800 bytes each). The first one is static, the others
+// are taken from PSRAM or the heap at start-up, if there is enough free memory. A hardware section with more memory (PSRAM)
+// can define more.
+#ifndef IMAGE_CACHE_SLOTS
+#define IMAGE_CACHE_SLOTS (3)
+#endif
+#ifdef IMAGE_CACHE_INDEXED
+#if defined(USE_CLK_FILES) || defined(USE_FACE_BUNDLES) || defined(TFT_STREAMING_RENDER)
+#error "IMAGE_CACHE_INDEXED needs BMP files and the image cache, don't use it with USE_CLK_FILES, face bundles or TFT_STREAMING_RENDER."
+#endif
+#undef IMAGE_CACHE_SLOTS
+#define IMAGE_CACHE_SLOTS (10) // all digits of a clock face, as far as the memory is enough; an indexed frame takes 32920 bytes
+#endif
+#if defined(IMAGE_DECODER_TASK) && defined(TFT_STREAMING_RENDER)
+#error "IMAGE_DECODER_TASK fills the image cache, it can't be used with TFT_STREAMING_RENDER."
+#endif
+#define IMAGE_DECODER_TASK_STACK (6144) // bytes; LoadImageIntoBuffer() keeps the ImageInfo (with the palettes) on the stack
+#define IMAGE_CACHE_MIN_FREE_HEAP (120000) // don't take heap for extra cache slots, if less than this would remain for WiFi, MQTT and TLS
+#define IMAGE_PRELOAD_LOOKAHEAD_SEC (10)   // look this many seconds ahead for digits that will change and preload their images
+#define TFT_STREAMING_BAND_LINES (8)       // lines decoded and sent at once, if TFT_STREAMING_RENDER is used
+#define IMAGE_READ_CHUNK_BYTES (4096)      // image lines are read from flash in blocks of up to this size
+#define TFT_USE_DMA                        // send images via DMA (if TFT_eSPI supports it for the hardware), the loop goes on while the image is sent
+#define IMAGE_DIFF_BAND_LINES (8)          // images are compared in bands of this many lines, only the changed bands are sent to the display
+#define IMAGE_DIFF_BANDS ((TFT_HEIGHT + IMAGE_DIFF_BAND_LINES - 1) / IMAGE_DIFF_BAND_LINES)
+#if (defined(USE_FACE_PARTITION) || defined(COMPRESS_FACE_BUNDLES)) && !defined(USE_FACE_BUNDLES)
+#define USE_FACE_BUNDLES // the face partition and compressed images use clock face bundles
+#endif
+
 // ************ Helper macros *********************
 #define concat2(first, second) first second
 #define concat3(first, second, third) first second third
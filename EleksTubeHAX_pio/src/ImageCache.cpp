@@ -0,0 +1,241 @@
+#include "ImageCache.h"
+
+void ImageCache::begin(CachedFrame *staticFrames)
+{
+  for (numSlots = 0; numSlots < IMAGE_CACHE_STATIC_FRAMES && numSlots < IMAGE_CACHE_SLOTS; numSlots++)
+  {
+    slots[numSlots].frame = &staticFrames[numSlots];
+    slots[numSlots].dmaCapable = true;
+    slots[numSlots].pinned = 0;
+  }
+
+  // try to get the other slots; PSRAM first (if the board has some), heap as fallback
+  while (numSlots < IMAGE_CACHE_SLOTS)
+  {
+    CachedFrame *buffer = NULL;
+    bool dmaCapable = false;
+    if (psramFound())
+    {
+      buffer = (CachedFrame *)ps_malloc(IMAGE_CACHE_FRAME_BYTES);
+    }
+    if ((buffer == NULL) &&
+        (ESP.getFreeHeap() > IMAGE_CACHE_FRAME_BYTES + IMAGE_CACHE_MIN_FREE_HEAP) &&
+        (ESP.getMaxAllocHeap() >= IMAGE_CACHE_FRAME_BYTES))
+    {
+      buffer = (CachedFrame *)heap_caps_malloc(IMAGE_CACHE_FRAME_BYTES, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+      dmaCapable = true;
+    }
+    if (buffer == NULL)
+    {
+      break; // not enough memory, use what we have
+    }
+    slots[numSlots].frame = buffer;
+    slots[numSlots].dmaCapable = dmaCapable;
+    slots[numSlots].pinned = 0;
+    numSlots++;
+  }
+  invalidateAll();
+
+  Serial.print("Image cache slots: ");
+  Serial.print(numSlots);
+  Serial.print(" of ");
+  Serial.println(IMAGE_CACHE_SLOTS);
+}
+
+int8_t ImageCache::findSlot(uint8_t file_index)
+{
+  for (uint8_t i = 0; i < numSlots; i++)
+  {
+    if (slots[i].valid && slots[i].file_index == file_index)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+CachedFrame *ImageCache::find(uint8_t file_index)
+{
+  CachedFrame *frame = NULL;
+  portENTER_CRITICAL(&lock);
+  int8_t slot = findSlot(file_index);
+  if (slot >= 0)
+  {
+    slots[slot].lastUsed = ++useCounter;
+    frame = slots[slot].frame;
+  }
+  portEXIT_CRITICAL(&lock);
+  return frame;
+}
+
+bool ImageCache::contains(uint8_t file_index)
+{
+  portENTER_CRITICAL(&lock);
+  bool found = findSlot(file_index) >= 0;
+  portEXIT_CRITICAL(&lock);
+  return found;
+}
+
+CachedFrame *ImageCache::acquire(uint8_t file_index)
+{
+  CachedFrame *frame = NULL;
+  portENTER_CRITICAL(&lock);
+  int8_t slot = findSlot(file_index);
+  if (slot >= 0)
+  {
+    slots[slot].lastUsed = ++useCounter;
+    slots[slot].pinned++;
+    frame = slots[slot].frame;
+  }
+  portEXIT_CRITICAL(&lock);
+  return frame;
+}
+
+void ImageCache::release(const CachedFrame *frame)
+{
+  portENTER_CRITICAL(&lock);
+  int8_t slot = slotOf(frame);
+  if (slot >= 0 && slots[slot].pinned > 0)
+  {
+    slots[slot].pinned--;
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+int8_t ImageCache::slotOf(const CachedFrame *frame)
+{
+  for (uint8_t i = 0; i < numSlots; i++)
+  {
+    if (slots[i].frame == frame)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// The frame and its slot don't change while it is pinned, no lock needed.
+bool ImageCache::isDmaCapable(const CachedFrame *frame)
+{
+  int8_t slot = slotOf(frame);
+  return (slot >= 0) && slots[slot].dmaCapable;
+}
+
+const uint32_t *ImageCache::getBandHashes(const CachedFrame *frame)
+{
+  int8_t slot = slotOf(frame);
+  return (slot >= 0) ? slots[slot].bandHash : NULL;
+}
+
+int8_t ImageCache::reserve()
+{
+  int8_t oldest = -1;
+  portENTER_CRITICAL(&lock);
+  for (uint8_t i = 0; i < numSlots; i++)
+  {
+    if (slots[i].pinned > 0)
+    { // in use, don't touch it
+      continue;
+    }
+    if (!slots[i].valid)
+    { // empty slot, take it
+      oldest = i;
+      break;
+    }
+    if (oldest < 0 || slots[i].lastUsed < slots[oldest].lastUsed)
+    {
+      oldest = i;
+    }
+  }
+  if (oldest >= 0)
+  {
+    slots[oldest].valid = false; // content will be overwritten
+  }
+  portEXIT_CRITICAL(&lock);
+  return oldest;
+}
+
+void ImageCache::store(int8_t slot, uint8_t file_index)
+{
+  // FNV-1a hash over the pixels of every band; the slot is not valid yet, so no one else reads them
+  const CachedFrame *frame = slots[slot].frame;
+  for (uint8_t band = 0; band < IMAGE_DIFF_BANDS; band++)
+  {
+    int16_t firstLine = band * IMAGE_DIFF_BAND_LINES;
+    int16_t endLine = min(firstLine + IMAGE_DIFF_BAND_LINES, TFT_HEIGHT);
+    uint32_t hash = 2166136261UL;
+    for (int16_t line = firstLine; line < endLine; line++)
+    {
+#ifdef IMAGE_CACHE_INDEXED
+      uint16_t pixel[TFT_WIDTH];
+      expandLine(frame, line, frame->palette, pixel);
+#else
+      const uint16_t *pixel = &frame->pixels[line * TFT_WIDTH];
+#endif
+      for (int16_t i = 0; i < TFT_WIDTH; i++)
+      {
+        hash = (hash ^ pixel[i]) * 16777619UL;
+      }
+    }
+    slots[slot].bandHash[band] = hash;
+  }
+
+  portENTER_CRITICAL(&lock);
+  slots[slot].file_index = file_index;
+  slots[slot].lastUsed = ++useCounter;
+  slots[slot].valid = true;
+  portEXIT_CRITICAL(&lock);
+}
+
+#ifdef IMAGE_CACHE_INDEXED
+void ImageCache::expandLine(const CachedFrame *frame, int16_t line, const uint16_t *palette, uint16_t *dest)
+{
+  int16_t row = line - frame->y;
+  if (row < 0 || row >= frame->h)
+  {
+    memset(dest, 0, TFT_WIDTH * sizeof(uint16_t));
+    return;
+  }
+  memset(dest, 0, frame->x * sizeof(uint16_t));
+  const uint8_t *index = &frame->pixels[row * frame->w];
+  uint16_t *pixel = &dest[frame->x];
+  for (int16_t col = 0; col < frame->w; col++)
+  {
+    pixel[col] = palette[index[col]];
+  }
+  memset(&pixel[frame->w], 0, (TFT_WIDTH - frame->x - frame->w) * sizeof(uint16_t));
+}
+#endif
+
+void ImageCache::invalidateAll()
+{
+  portENTER_CRITICAL(&lock);
+  for (uint8_t i = 0; i < numSlots; i++)
+  {
+    slots[i].valid = false; // a pinned image is still sent, but can't be found anymore
+    slots[i].lastUsed = 0;
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+void ImageCache::countMiss(uint32_t loadTime)
+{
+  misses++;
+  missLoadTimeTotal += loadTime;
+  if (loadTime > missLoadTimeMax)
+  {
+    missLoadTimeMax = loadTime;
+  }
+}
+
+void ImageCache::printStats()
+{
+  Serial.print("Image cache: hits ");
+  Serial.print(hits);
+  Serial.print(", misses ");
+  Serial.print(misses);
+  Serial.print(", load time on miss (ms) total ");
+  Serial.print(missLoadTimeTotal);
+  Serial.print(", max ");
+  Serial.println(missLoadTimeMax);
+}
@@ -0,0 +1,99 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include "GLOBAL_DEFINES.h"
+
+/*
+ * Keeps up to IMAGE_CACHE_SLOTS decoded images (TFT_WIDTH x TFT_HEIGHT, RGB565) in RAM.
+ * An image is identified by its file index (clock face * 10 + digit). Images are kept undimmed, software dimming is
+ * applied while they are sent, so a brightness change doesn't need to read the images from flash again.
+ * If all slots are in use, the least recently used image is replaced.
+ * Pixels are stored in the byte order of the display (bytes swapped), so they can be sent without conversion, also via DMA.
+ * For every band of IMAGE_DIFF_BAND_LINES lines a hash is kept, so only the changed parts of an image need to be sent.
+ * With IMAGE_CACHE_INDEXED, images are kept as palette indices instead (one byte per pixel), see CachedFrame.
+ * The cache can be used by two tasks (see IMAGE_DECODER_TASK): the slot list is guarded by a spinlock, only held for
+ * the bookkeeping. An image in use is pinned with acquire(), so it is never replaced while it is sent.
+ */
+
+#ifdef IMAGE_CACHE_INDEXED
+// Image of a 1, 4 or 8 bit BMP file: the pixels are indices into the palette. Only the image is stored, the rest of the
+// display is black. Half the size of an RGB565 frame; expanded line by line, while it is sent.
+struct CachedFrame
+{
+  uint16_t palette[256];                   // RGB565 in the byte order of the display, undimmed
+  int16_t x, y, w, h;                      // position of the image on the display
+  uint8_t pixels[TFT_WIDTH * TFT_HEIGHT]; // w * h indices, top line first
+};
+#define IMAGE_CACHE_STATIC_FRAMES (2) // fit into the RAM of one RGB565 frame
+#else
+struct CachedFrame
+{
+  uint16_t pixels[TFT_WIDTH * TFT_HEIGHT]; // RGB565 in the byte order of the display
+};
+#define IMAGE_CACHE_STATIC_FRAMES (1)
+#endif
+#define IMAGE_CACHE_FRAME_BYTES (sizeof(CachedFrame))
+
+class ImageCache
+{
+public:
+  ImageCache() : numSlots(0), useCounter(0), lock(portMUX_INITIALIZER_UNLOCKED), hits(0), misses(0), missLoadTimeTotal(0), missLoadTimeMax(0) {}
+
+  // The first slots use the given IMAGE_CACHE_STATIC_FRAMES static frames, all others are allocated from PSRAM or the heap.
+  void begin(CachedFrame *staticFrames);
+
+  // Returns the image or NULL if not cached. Marks the image as most recently used.
+  CachedFrame *find(uint8_t file_index);
+  bool contains(uint8_t file_index);
+  // Like find(), but the image is pinned: its slot is not reused until release() is called.
+  CachedFrame *acquire(uint8_t file_index);
+  void release(const CachedFrame *frame);
+
+  // Returns the slot that should be filled next (empty or least recently used, not pinned), -1 if all are pinned.
+  // The slot is invalid until store() is called.
+  int8_t reserve();
+  CachedFrame *getFrame(int8_t slot) { return slots[slot].frame; }
+  bool isDmaCapable(const CachedFrame *frame);
+  // Hashes of the bands of the image, IMAGE_DIFF_BANDS values.
+  const uint32_t *getBandHashes(const CachedFrame *frame);
+#ifdef IMAGE_CACHE_INDEXED
+  // Writes the line of the display as RGB565 pixels, with the colors from palette (the frame's one or a dimmed copy).
+  static void expandLine(const CachedFrame *frame, int16_t line, const uint16_t *palette, uint16_t *dest);
+#endif
+  // Marks the slot as filled with the image and calculates the band hashes.
+  void store(int8_t slot, uint8_t file_index);
+  void invalidateAll();
+
+  // Statistics, counted by the user of the cache when an image is drawn.
+  void countHit() { hits++; }
+  void countMiss(uint32_t loadTime);
+  void printStats();
+  uint8_t getNumSlots() { return numSlots; }
+
+private:
+  struct Slot
+  {
+    CachedFrame *frame;
+    uint32_t lastUsed;
+    uint8_t file_index;
+    bool valid;
+    uint8_t pinned;  // number of acquire() calls without release()
+    bool dmaCapable; // PSRAM can't be used for SPI DMA transfers
+    uint32_t bandHash[IMAGE_DIFF_BANDS];
+  };
+
+  Slot slots[IMAGE_CACHE_SLOTS];
+  uint8_t numSlots;
+  uint32_t useCounter;
+  portMUX_TYPE lock; // for the slot list, not for the pixels
+
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t missLoadTimeTotal; // ms
+  uint32_t missLoadTimeMax;   // ms
+
+  int8_t findSlot(uint8_t file_index);
+  int8_t slotOf(const CachedFrame *frame);
+};
+
+#endif // IMAGE_CACHE_H
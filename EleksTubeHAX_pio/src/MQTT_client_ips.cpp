@@ -53,6 +53,7 @@ void MQTTReportState(bool forceUpdateEverything);
 void MQTTReportBackOnChange();
 void MQTTReportBackEverything(bool forceUpdateEverything);
 void MQTTPeriodicReportBack();
+void MQTTReportDiagnostics();
 
 // plain MQTT mode functions
 void MQTTReportPowerState(bool forceUpdate);
@@ -73,6 +74,7 @@ bool loadCARootCert();
 // variables
 uint32_t lastTimeSent = (uint32_t)(MQTT_REPORT_STATUS_EVERY_SEC * -1000);
 uint32_t LastTimeTriedToConnect = 0;
+uint32_t lastTimeDiagnosticsSent = 0;
 
 bool MQTTConnected = false;     // Show connection status on the clock's LCD
 bool discoveryReported = false; // initial state of discovery messages sent to HA
@@ -835,6 +837,7 @@ void MQTTLoopInFreeTime()
 {
   MQTTReportBackOnChange();
   MQTTPeriodicReportBack();
+  MQTTReportDiagnostics();
 }
 
 #ifdef MQTT_PLAIN_ENABLED
@@ -949,6 +952,75 @@ void MQTTPeriodicReportBack()
   }
 }
 
+// Render statistics (see RenderStats.h), counted since boot or the last "stats reset" on the serial interface.
+void MQTTReportDiagnostics()
+{
+  if (((millis() - lastTimeDiagnosticsSent) < (MQTT_REPORT_DIAGNOSTICS_EVERY_SEC * 1000)) || !MQTTclient.connected())
+    return;
+  lastTimeDiagnosticsSent = millis();
+
+  JsonDocument diagnostics;
+  diagnostics["uptime_s"] = millis() / 1000;
+  diagnostics["since_s"] = renderStats.getSince() / 1000;
+  diagnostics["clock_face"] = tfts.current_graphic;
+  diagnostics["draws"] = renderStats.getDraws();
+  diagnostics["bytes_pushed"] = renderStats.getBytesPushed();
+  diagnostics["cache_hits"] = renderStats.getCacheHits();
+  diagnostics["cache_misses"] = renderStats.getCacheMisses();
+  for (uint8_t bucket = 0; bucket < RENDER_STATS_BUCKETS - 1; bucket++)
+  {
+    diagnostics["bucket_limits_us"][bucket] = RenderStats::bucketLimits[bucket];
+  }
+  for (uint8_t s = 0; s < RenderStats::num_stages; s++)
+  {
+    const RenderStats::Stage &stage = renderStats.getStage((RenderStats::stage_t)s);
+    JsonObject json = diagnostics["stages"][RenderStats::stageNames[s]].to<JsonObject>();
+    json["count"] = stage.count;
+    json["avg_us"] = stage.count > 0 ? stage.totalTime / stage.count : 0;
+    json["max_us"] = stage.maxTime;
+    for (uint8_t bucket = 0; bucket < RENDER_STATS_BUCKETS; bucket++)
+    {
+      json["histogram"][bucket] = stage.histogram[bucket];
+    }
+  }
+  for (uint8_t face = 1; face < RENDER_STATS_FACES; face++)
+  {
+    const RenderStats::Face &stats = renderStats.getFace(face);
+    if (stats.loads == 0)
+      continue;
+    JsonObject json = diagnostics["faces"].add<JsonObject>();
+    json["face"] = face;
+    json["loads"] = stats.loads;
+    json["avg_us"] = stats.totalTime / stats.loads;
+    json["max_us"] = stats.maxTime;
+  }
+  const RenderStats::Flips &flips = renderStats.getFlips();
+  JsonObject flip_phase = diagnostics["flip_phase"].to<JsonObject>();
+  flip_phase["count"] = flips.count;
+  flip_phase["avg_ms"] = flips.count > 0 ? (int32_t)(flips.totalError / flips.count) : 0;
+  flip_phase["min_ms"] = flips.minError;
+  flip_phase["max_ms"] = flips.maxError;
+  for (uint8_t bucket = 0; bucket < RENDER_STATS_FLIP_BUCKETS; bucket++)
+  {
+    if (bucket < RENDER_STATS_FLIP_BUCKETS - 1)
+      flip_phase["bucket_limits_ms"][bucket] = RenderStats::flipLimits[bucket];
+    flip_phase["histogram"][bucket] = flips.histogram[bucket];
+  }
+  MQTTPublish(concat2(MQTT_CLIENT, "/diagnostics/render"), &diagnostics, MQTT_RETAIN_STATE_MESSAGES);
+
+  const RtcDrift &drift = Clock::getRtcDrift();
+  JsonDocument rtc;
+  rtc["drift_ppm"] = drift.getDriftPpb() / 1000.0;
+  rtc["oscillator_ppm"] = drift.getRawDriftPpb() / 1000.0;
+  rtc["aging_offset"] = drift.getAgingOffset();
+  rtc["hours"] = round1(drift.getHours());
+  rtc["confident"] = drift.isConfident();
+  rtc["error_ms"] = drift.getMeasuredError();
+  rtc["residual_ms"] = drift.getResidual();
+  rtc["ntp_interval_s"] = Clock::getNtpInterval();
+  MQTTPublish(concat2(MQTT_CLIENT, "/diagnostics/rtc"), &rtc, MQTT_RETAIN_STATE_MESSAGES);
+}
+
 #ifdef MQTT_HOME_ASSISTANT
 bool MQTTReportDiscovery()
 {
@@ -7,9 +7,11 @@
  * - more debug outputs
  * - clearing data buffer before contacting server
  * - checking NTP protocol version
+ * - several servers, the time is selected from their replies by NTPFilter
  */
 
 #include "NTPClient_AO.h"
+#include <lwip/tcpip.h>
 
 #ifdef DEBUG_NTPClient
 #define DBG(X) Serial.println(F(X))
@@ -31,21 +33,21 @@ NTPClient::NTPClient(UDP &udp, long timeOffset)
 NTPClient::NTPClient(UDP &udp, const char *poolServerName)
 {
   this->_udp = &udp;
-  this->_poolServerName = poolServerName;
+  this->_servers[0] = poolServerName;
 }
 
 NTPClient::NTPClient(UDP &udp, const char *poolServerName, long timeOffset)
 {
   this->_udp = &udp;
   this->_timeOffset = timeOffset;
-  this->_poolServerName = poolServerName;
+  this->_servers[0] = poolServerName;
 }
 
 NTPClient::NTPClient(UDP &udp, const char *poolServerName, long timeOffset, unsigned long updateInterval)
 {
   this->_udp = &udp;
   this->_timeOffset = timeOffset;
-  this->_poolServerName = poolServerName;
+  this->_servers[0] = poolServerName;
   this->_updateInterval = updateInterval;
 }
 
@@ -59,40 +61,136 @@ void NTPClient::begin(int port)
   this->_port = port;
 
   this->_udp->begin(this->_port);
+  this->_filter.begin(this->_numServers);
 
   this->_udpSetup = true;
 }
 
-bool NTPClient::forceUpdate()
+bool NTPClient::beginUpdate()
 {
-  DBG("Update from NTP Server...");
+  DBG("Update from NTP Servers...");
+  if (this->_waiting)
+    return false;
+
+  this->_waiting = true;
+  this->_pass = 0;
+  this->_server = 0;
+  this->_lookupStarted = millis();
+  for (uint8_t i = 0; i < this->_numServers; i++)
+  {
+    this->_lookups[i].name = this->_servers[i];
+    this->_lookups[i].state = lookup_pending;
+    if (tcpip_callback(&NTPClient::startLookup, &this->_lookups[i]) != ERR_OK)
+      this->_lookups[i].state = lookup_failed;
+  }
+  this->nextRequest();
+  return this->_waiting;
+}
+
+void NTPClient::startLookup(void *lookup)
+{
+  Lookup *l = (Lookup *)lookup;
+  ip_addr_t address;
+  err_t err = dns_gethostbyname(l->name, &address, &NTPClient::lookupDone, l);
+  if (err == ERR_OK)
+    lookupDone(l->name, &address, l); // known already
+  else if (err != ERR_INPROGRESS)
+    lookupDone(l->name, NULL, l);
+}
+
+void NTPClient::lookupDone(const char *name, const ip_addr_t *ipaddr, void *lookup)
+{
+  Lookup *l = (Lookup *)lookup;
+  if (ipaddr == NULL || !IP_IS_V4(ipaddr))
+  {
+    l->state = lookup_failed;
+    return;
+  }
+  l->address = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+  l->state = lookup_done;
+}
+
+void NTPClient::nextRequest()
+{
+  if (this->_pass >= NTP_BURST)
+  { // all requests done
+    this->_waiting = false;
+    this->_success = this->_filter.select();
+    if (this->_success)
+      this->_lastUpdate = millis();
+    if (this->_updateCallback != NULL)
+      this->_updateCallback(this->_success);
+    return;
+  }
+
+  if (this->_server == 0 && this->_pass > 0 && millis() - this->_passStarted < NTP_BURST_SPACING_MS)
+    return; // poll() sends it later
+  uint8_t server = this->_server;
+  if (this->_lookups[server].state == lookup_pending && millis() - this->_lookupStarted < NTP_LOOKUP_TIMEOUT_MS)
+    return; // no address yet
+  if (this->_server == 0)
+    this->_passStarted = millis();
+  if (++this->_server >= this->_numServers)
+  {
+    this->_server = 0;
+    this->_pass++;
+  }
 
   // flush any existing packets
   while (this->_udp->parsePacket() != 0)
     this->_udp->flush();
 
-  if (!this->sendNTPPacket())
+  if (this->_lookups[server].state == lookup_done && this->sendNTPPacket(server))
   {
-    DBG("NTP err: Could not send packet");
-    return false;
+    this->_requestServer = server;
+    this->_requestSent = millis();
+    this->_requestMicros = micros();
+    this->_requestPending = true;
+    return;
   }
+  DBG("NTP err: No address or could not send packet"); // the next poll() goes on
+}
+
+void NTPClient::poll()
+{
+  if (!this->_waiting)
+    return;
 
-  // Wait till data is there or timeout...
-  byte timeout = 0;
-  int cb = 0;
-  do
+  if (this->_requestPending)
   {
-    delay(10);
-    cb = this->_udp->parsePacket();
-    if (timeout > 100)
+    int8_t result = this->receiveNTPPacket();
+    if (result < 0)
     {
+      if (millis() - this->_requestSent <= NTP_TIMEOUT_MS)
+        return; // no reply yet
       DBG("NTP Timeout!");
-      return false; // timeout after 1000 ms
     }
-    timeout++;
-  } while (cb == 0);
+    this->_requestPending = false;
+  }
+  this->nextRequest();
+}
+
+bool NTPClient::forceUpdate()
+{
+  if (!this->beginUpdate())
+    return false;
+
+  // Wait till all requests are done
+  while (this->_waiting)
+  {
+    delay(10);
+    this->poll();
+  }
+  return this->_success;
+}
+
+int8_t NTPClient::receiveNTPPacket()
+{
+  if (this->_udp->parsePacket() == 0)
+    return -1;
 
-  this->_lastUpdate = millis() - (10 * (timeout + 1)); // Account for delay in reading the time
+  uint32_t receivedMicros = micros(); // the reply came at most one poll() (or 10 ms in forceUpdate()) ago
+  uint32_t receivedMillis = millis();
 
   byte _packetBuffer[NTP_PACKET_SIZE];
   // clear  buffer before receiving data from server
@@ -101,7 +199,7 @@ bool NTPClient::forceUpdate()
   if (this->_udp->read(_packetBuffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE)
   {
     DBG("NTP err: Incorrect data size");
-    return false;
+    return 0;
   }
 
 #ifdef DEBUG_NTPClient
@@ -122,10 +220,16 @@ bool NTPClient::forceUpdate()
       #ifdef DEBUG_NTPClient
         Serial.println("Incorrect NTP version!");
       #endif
-      return false;
+      return 0;
       }
   */
 
+  if (memcmp(&_packetBuffer[24], this->_requestTransmit, sizeof(this->_requestTransmit)) != 0) // Check for Originate == our Transmit
+  { // a late reply to an earlier request, or not from the server at all; the reply may still come
+    DBG("NTP err: Not the reply to the request");
+    return -1;
+  }
+
   // code from: https://github.com/arduino-libraries/NTPClient/pull/28/commits/bbcc429f68c7624ada4a24f1a103fc34be8d72f8
   // Perform a few validity checks on the packet
   if ((_packetBuffer[0] & 0b11000000) == 0b11000000) // Check for LI=UNSYNC
@@ -133,7 +237,7 @@ bool NTPClient::forceUpdate()
 #ifdef DEBUG_NTPClient
     Serial.println("err: NTP UnSync");
 #endif
-    return false;
+    return 0;
   }
 
   if ((_packetBuffer[0] & 0b00111000) >> 3 < 0b100) // Check for Version >= 4
@@ -141,7 +245,7 @@ bool NTPClient::forceUpdate()
 #ifdef DEBUG_NTPClient
     Serial.println("err: Incorrect NTP Version");
 #endif
-    return false;
+    return 0;
   }
 
   if ((_packetBuffer[0] & 0b00000111) != 0b100) // Check for Mode == Server
@@ -149,7 +253,7 @@ bool NTPClient::forceUpdate()
 #ifdef DEBUG_NTPClient
     Serial.println("err: NTP mode is not Server");
 #endif
-    return false;
+    return 0;
   }
 
   if ((_packetBuffer[1] < 1) || (_packetBuffer[1] > 15)) // Check for valid Stratum
@@ -157,7 +261,7 @@ bool NTPClient::forceUpdate()
 #ifdef DEBUG_NTPClient
     Serial.println("err: Incorrect NTP Stratum");
 #endif
-    return false;
+    return 0;
   }
 
   if (_packetBuffer[16] == 0 && _packetBuffer[17] == 0 &&
@@ -168,18 +272,60 @@ bool NTPClient::forceUpdate()
 #ifdef DEBUG_NTPClient
     Serial.println("err: Incorrect NTP Ref Timestamp");
 #endif
-    return false;
+    return 0;
   }
 
-  unsigned long highWord = word(_packetBuffer[40], _packetBuffer[41]);
-  unsigned long lowWord = word(_packetBuffer[42], _packetBuffer[43]);
+  // receive and transmit timestamp of the server
+  unsigned long long serverReceived = ntpTimestampMicros(&_packetBuffer[32]);
+  unsigned long long serverSent = ntpTimestampMicros(&_packetBuffer[40]);
+  if (serverSent < NTP_MIN_VALID_TIME * 1000000ULL || serverSent < serverReceived)
+  {
+    DBG("NTP err: Invalid server time");
+    return 0;
+  }
+  unsigned long long serverTime = serverSent - serverReceived;
+  uint32_t roundTrip = receivedMicros - this->_requestMicros;
+  if (roundTrip > NTP_TIMEOUT_MS * 1000UL || serverTime > roundTrip)
+  { // half the round trip is added to the time, so a reply that was taken that late is not exact enough
+    DBG("NTP err: Reply too late");
+    return 0;
+  }
+  roundTrip -= serverTime;
+
+  // errors the server reports: half its round trip to the reference clock, its dispersion and precision
+  unsigned long rootDelay = ntpShortMicros(&_packetBuffer[4]);
+  unsigned long rootDispersion = ntpShortMicros(&_packetBuffer[8]);
+  int8_t precision = (int8_t)_packetBuffer[3];
+  unsigned long precisionMicros = precision <= -20 ? 1 : precision >= 0 ? 1000000UL : 1000000UL >> -precision;
+
+  // the reply was on the way for about half the round trip
+  this->_filter.addSample(this->_requestServer, serverSent + roundTrip / 2, receivedMillis, roundTrip,
+                          rootDelay / 2 + rootDispersion + precisionMicros);
+  return 1;
+}
+
+unsigned long NTPClient::ntpShortMicros(const byte *value)
+{
+  unsigned long seconds = word(value[0], value[1]);
+  unsigned long fraction = word(value[2], value[3]);
+  if (seconds >= 4000)
+    return 4000000000UL; // more than an hour, that's no use anyway
+  return seconds * 1000000UL + ((fraction * 1000000UL) >> 16);
+}
+
+unsigned long long NTPClient::ntpTimestampMicros(const byte *timestamp)
+{
+  unsigned long highWord = word(timestamp[0], timestamp[1]);
+  unsigned long lowWord = word(timestamp[2], timestamp[3]);
   // combine the four bytes (two words) into a long integer
   // this is NTP time (seconds since Jan 1 1900):
   unsigned long secsSince1900 = highWord << 16 | lowWord;
+  // the fraction of the second in 1/2^32 s
+  unsigned long highFraction = word(timestamp[4], timestamp[5]);
+  unsigned long lowFraction = word(timestamp[6], timestamp[7]);
+  unsigned long fraction = highFraction << 16 | lowFraction;
 
-  this->_currentEpoc = secsSince1900 - SEVENZYYEARS;
-
-  return true;
+  return (unsigned long long)(secsSince1900 - SEVENZYYEARS) * 1000000ULL + (((unsigned long long)fraction * 1000000ULL) >> 32);
 }
 
 bool NTPClient::update()
@@ -196,9 +342,13 @@ bool NTPClient::update()
 
 unsigned long NTPClient::getEpochTime() const
 {
-  return this->_timeOffset +                      // User offset
-         this->_currentEpoc +                     // Epoc returned by the NTP server
-         ((millis() - this->_lastUpdate) / 1000); // Time since last update
+  return this->getEpochMillis() / 1000;
+}
+
+unsigned long long NTPClient::getEpochMillis() const
+{
+  return this->_timeOffset * 1000LL +            // User offset
+         this->_filter.getEpochMicros() / 1000; // Selected from the servers, moved on with millis()
 }
 
 int NTPClient::getDay() const
@@ -250,12 +400,25 @@ void NTPClient::setUpdateInterval(unsigned long updateInterval)
   this->_updateInterval = updateInterval;
 }
 
+void NTPClient::setUpdateCallback(void (*callback)(bool success))
+{
+  this->_updateCallback = callback;
+}
+
 void NTPClient::setPoolServerName(const char *poolServerName)
 {
-  this->_poolServerName = poolServerName;
+  this->setServers(&poolServerName, 1);
+}
+
+void NTPClient::setServers(const char *const *serverNames, uint8_t count)
+{
+  this->_numServers = min(count, (uint8_t)NTP_MAX_SERVERS);
+  for (uint8_t i = 0; i < this->_numServers; i++)
+    this->_servers[i] = serverNames[i];
+  this->_filter.begin(this->_numServers);
 }
 
-bool NTPClient::sendNTPPacket()
+bool NTPClient::sendNTPPacket(uint8_t server)
 {
   byte _packetBuffer[NTP_PACKET_SIZE];
   // set all bytes in the buffer to 0
@@ -271,12 +434,16 @@ bool NTPClient::sendNTPPacket()
   _packetBuffer[13] = 0x4E;
   _packetBuffer[14] = 49;
   _packetBuffer[15] = 52;
+  // random transmit timestamp, the reply has to return it
+  for (uint8_t i = 0; i < sizeof(this->_requestTransmit); i++)
+    this->_requestTransmit[i] = random(256);
+  memcpy(&_packetBuffer[40], this->_requestTransmit, sizeof(this->_requestTransmit));
 
   // all NTP fields have been given values, now
   // you can send a packet requesting a timestamp:
   bool returnValue;
 
-  returnValue = this->_udp->beginPacket(this->_poolServerName, 123); // NTP requests are to port 123
+  returnValue = this->_udp->beginPacket(IPAddress(this->_lookups[server].address), 123); // NTP requests are to port 123
 
   if (returnValue)
   {
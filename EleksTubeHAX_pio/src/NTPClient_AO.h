@@ -7,10 +7,14 @@
 #include <_USER_DEFINES.h> // User defines (located in the src folder)
 
 #include <Udp.h>
+#include <lwip/dns.h>
+#include "NTPFilter.h"
 
 #define SEVENZYYEARS 2208988800UL
 #define NTP_PACKET_SIZE 48
 #define NTP_DEFAULT_LOCAL_PORT 1337
+#define NTP_TIMEOUT_MS 1000 // wait this long for the reply of the server
+#define NTP_LOOKUP_TIMEOUT_MS 5000 // wait this long for the address of a server, then skip its requests
 
 //#define DEBUG_NTPClient
 
@@ -20,16 +24,59 @@ private:
   UDP *_udp;
   bool _udpSetup = false;
 
-  const char *_poolServerName = "pool.ntp.org"; // Default time server
+  const char *_servers[NTP_MAX_SERVERS] = {"pool.ntp.org"}; // Default time server
+  uint8_t _numServers = 1;
   int _port = NTP_DEFAULT_LOCAL_PORT;
   long _timeOffset = 0;
 
   unsigned long _updateInterval = 60000; // In ms
 
-  unsigned long _currentEpoc = 0; // In s
-  unsigned long _lastUpdate = 0;  // In ms
-
-  bool sendNTPPacket();
+  unsigned long _lastUpdate = 0; // In ms
+  NTPFilter _filter;             // samples of all servers, selects the time
+
+  // Address of a server, looked up at the start of every update by the lwIP task, so the loop never waits for DNS
+  // (WiFiUDP::beginPacket() with a host name does).
+  enum lookup_t : uint8_t
+  {
+    lookup_pending,
+    lookup_done,
+    lookup_failed
+  };
+  struct Lookup
+  {
+    const char *name;
+    volatile lookup_t state;
+    volatile uint32_t address; // IPv4, network byte order
+  };
+  Lookup _lookups[NTP_MAX_SERVERS] = {};
+  unsigned long _lookupStarted = 0; // In ms
+  // Run in the lwIP task
+  static void startLookup(void *lookup);
+  static void lookupDone(const char *name, const ip_addr_t *ipaddr, void *lookup);
+
+  bool _waiting = false;             // update running: NTP_BURST requests to every server
+  bool _success = false;             // result of the last update
+  uint8_t _pass = 0;                 // of the burst
+  uint8_t _server = 0;               // gets the next request
+  unsigned long _passStarted = 0;    // In ms
+  bool _requestPending = false;      // request sent, reply not received yet
+  uint8_t _requestServer = 0;
+  byte _requestTransmit[8];          // transmit timestamp of the request, the server returns it as originate timestamp
+  unsigned long _requestSent = 0;    // In ms
+  uint32_t _requestMicros = 0;       // In us, for the round trip
+  void (*_updateCallback)(bool success) = NULL;
+
+  bool sendNTPPacket(uint8_t server);
+  // Sends the next request of the update, or ends the update after the last one. At most one request per call: if the
+  // address of the server is not known yet, or the send fails, the next poll() goes on.
+  void nextRequest();
+  // Reads and checks the reply, if there is one: 1 valid reply, 0 invalid reply, -1 no reply yet (or not the reply to
+  // the request, e.g. a late reply to an earlier one).
+  int8_t receiveNTPPacket();
+  // NTP timestamp (seconds since 1900 and fraction, 8 bytes) as microseconds since Jan. 1, 1970
+  static unsigned long long ntpTimestampMicros(const byte *timestamp);
+  // NTP short format (seconds and fraction, 16 bit each) as microseconds
+  static unsigned long ntpShortMicros(const byte *value);
 
 public:
   explicit NTPClient(UDP &udp);
@@ -45,6 +92,12 @@ public:
    */
   void setPoolServerName(const char *poolServerName);
 
+  /**
+   * Set several time servers (up to NTP_MAX_SERVERS), e.g. members of a pool. Every update asks each of them NTP_BURST
+   * times; the time is taken from the servers that agree (see NTPFilter).
+   */
+  void setServers(const char *const *serverNames, uint8_t count);
+
   /**
    * Starts the underlying UDP client with the default local port
    */
@@ -64,12 +117,37 @@ public:
   bool update();
 
   /**
-   * This will force the update from the NTP Server.
+   * This will force the update from the NTP Servers. Waits until all requests of the update are done.
    *
    * @return true on success, false on failure
    */
   bool forceUpdate();
 
+  /**
+   * Sends the first request of an update and returns at once, without waiting for the reply.
+   * poll() takes the replies, sends the other requests and calls the callback set by setUpdateCallback() at the end.
+   *
+   * @return true, if the update was started
+   */
+  bool beginUpdate();
+
+  /**
+   * Call this in the main loop while an update is running. Takes the reply of the server (or gives up on it after
+   * NTP_TIMEOUT_MS) and sends the next request; after the last one it selects the time and calls the update callback.
+   * Returns at once.
+   */
+  void poll();
+
+  /**
+   * @return true between beginUpdate() and the end of the update
+   */
+  bool isUpdating() const { return _waiting; }
+
+  /**
+   * Called by poll() at the end of every update started by beginUpdate(), with true if the servers agree on the time.
+   */
+  void setUpdateCallback(void (*callback)(bool success));
+
   int getDay() const;
   int getHours() const;
   int getMinutes() const;
@@ -96,6 +174,27 @@ public:
    */
   unsigned long getEpochTime() const;
 
+  /**
+   * @return time in milliseconds since Jan. 1, 1970. Uses the fraction of the NTP timestamps and corrects them by half
+   * the round trip, so it is as exact as the network allows (the reply is taken at the next poll()).
+   */
+  unsigned long long getEpochMillis() const;
+
+  /**
+   * @return round trip of the best reply in us, without the time spent in the server
+   */
+  unsigned long getRoundTrip() const { return _filter.getRoundTrip(); }
+
+  /**
+   * @return true, if the time of the last update is good enough to set the RTC (see NTPFilter::isConfident())
+   */
+  bool isConfident() const { return _success && _filter.isConfident(); }
+
+  /**
+   * Prints the state of every server after the last update.
+   */
+  void printServers() { _filter.print(_servers); }
+
   /**
    * Stops the underlying UDP client
    */
@@ -0,0 +1,193 @@
+#include "NTPFilter.h"
+
+#define NTP_TICK_US 1000 // resolution of millis(), added to the distance of every sample
+
+void NTPFilter::begin(uint8_t servers)
+{
+  numServers = min(servers, (uint8_t)NTP_MAX_SERVERS);
+  memset(this->servers, 0, sizeof(this->servers));
+  selected = false;
+  survivors = 0;
+  candidates = 0;
+}
+
+void NTPFilter::addSample(uint8_t server, uint64_t epoch_us, uint32_t taken_millis, uint32_t round_trip_us, uint32_t root_us)
+{
+  if (server >= numServers)
+  {
+    return;
+  }
+  Server &s = servers[server];
+  Sample &sample = s.samples[s.next];
+  sample.epochUs = epoch_us;
+  sample.takenMillis = taken_millis;
+  sample.roundTripUs = round_trip_us;
+  sample.rootUs = root_us;
+  sample.valid = true;
+  s.next = (s.next + 1) % NTP_FILTER_SAMPLES;
+}
+
+uint32_t NTPFilter::distance(const Sample &sample, uint32_t now)
+{
+  uint64_t age_dispersion = (uint64_t)(now - sample.takenMillis) * NTP_PHI_PPM / 1000; // ms * ppm / 1000 = us
+  uint64_t distance = sample.roundTripUs / 2 + (uint64_t)sample.rootUs + NTP_TICK_US + age_dispersion;
+  return distance > UINT32_MAX ? UINT32_MAX : (uint32_t)distance;
+}
+
+const NTPFilter::Sample *NTPFilter::bestSample(uint8_t server, uint32_t now, uint32_t &distance_us)
+{
+  const Sample *best = NULL;
+  for (uint8_t i = 0; i < NTP_FILTER_SAMPLES; i++)
+  {
+    const Sample &sample = servers[server].samples[i];
+    if (!sample.valid)
+    {
+      continue;
+    }
+    uint32_t d = distance(sample, now);
+    if (best == NULL || d < distance_us)
+    {
+      best = &sample;
+      distance_us = d;
+    }
+  }
+  return best;
+}
+
+bool NTPFilter::select()
+{
+  uint32_t now = millis();
+  uint64_t base = 0; // all times relative to the first candidate, in us
+  int64_t low[NTP_MAX_SERVERS], high[NTP_MAX_SERVERS], time[NTP_MAX_SERVERS];
+  const Sample *best[NTP_MAX_SERVERS];
+  candidates = 0;
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    best[i] = bestSample(i, now, servers[i].distanceUs);
+    servers[i].state = no_sample;
+    if (best[i] == NULL)
+    {
+      continue;
+    }
+    uint64_t epoch_us = best[i]->epochUs + (uint64_t)(now - best[i]->takenMillis) * 1000;
+    if (candidates == 0)
+    {
+      base = epoch_us;
+    }
+    candidates++;
+    time[i] = (int64_t)(epoch_us - base);
+    low[i] = time[i] - servers[i].distanceUs;
+    high[i] = time[i] + servers[i].distanceUs;
+    servers[i].state = falseticker;
+  }
+
+  // Marzullo: sweep over the ends of the intervals, the most intervals overlap between best_low and best_high
+  struct End
+  {
+    int64_t at;
+    int8_t step; // +1 start, -1 end of an interval
+  };
+  End ends[2 * NTP_MAX_SERVERS];
+  uint8_t numEnds = 0;
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    if (best[i] != NULL)
+    {
+      ends[numEnds++] = {low[i], +1};
+      ends[numEnds++] = {high[i], -1};
+    }
+  }
+  for (uint8_t i = 1; i < numEnds; i++)
+  { // sort, starts before ends at the same time, so touching intervals overlap
+    End end = ends[i];
+    uint8_t j = i;
+    while (j > 0 && (ends[j - 1].at > end.at || (ends[j - 1].at == end.at && ends[j - 1].step < end.step)))
+    {
+      ends[j] = ends[j - 1];
+      j--;
+    }
+    ends[j] = end;
+  }
+  uint8_t overlap = 0, most = 0;
+  int64_t best_low = 0, best_high = 0;
+  for (uint8_t i = 0; i < numEnds; i++)
+  {
+    overlap += ends[i].step;
+    if (ends[i].step > 0 && overlap > most)
+    {
+      most = overlap;
+      best_low = ends[i].at;
+      best_high = ends[i + 1].at; // there is always an end after a start
+    }
+  }
+
+  uint8_t needed = min((uint8_t)NTP_MIN_SURVIVORS, numServers);
+  if (candidates == 0 || most * 2 <= candidates || most < needed)
+  { // no majority: keep the time selected before
+    survivors = 0;
+    return false;
+  }
+
+  // combine the survivors, the intervals that contain the intersection
+  int64_t weighted = 0;
+  uint64_t weights = 0;
+  int64_t reference = 0;
+  survivors = 0;
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    if (best[i] == NULL || low[i] > best_low || high[i] < best_high)
+    {
+      continue;
+    }
+    servers[i].state = survivor;
+    if (survivors == 0 || servers[i].distanceUs < distanceUs)
+    {
+      distanceUs = servers[i].distanceUs;
+      roundTripUs = best[i]->roundTripUs;
+    }
+    if (survivors == 0)
+    {
+      reference = time[i];
+    }
+    survivors++;
+    uint32_t weight = 1000000000UL / max(servers[i].distanceUs, 1U);
+    weighted += (time[i] - reference) * weight;
+    weights += weight;
+  }
+  int64_t combined = reference + weighted / (int64_t)weights;
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    servers[i].offsetUs = best[i] != NULL ? time[i] - combined : 0;
+  }
+  selectedEpochUs = base + combined;
+  selectedMillis = now;
+  selected = true;
+  return true;
+}
+
+uint64_t NTPFilter::getEpochMicros() const
+{
+  if (!selected)
+  {
+    return 0;
+  }
+  return selectedEpochUs + (uint64_t)(millis() - selectedMillis) * 1000;
+}
+
+void NTPFilter::print(const char *const *names)
+{
+  static const char *stateNames[] = {"no reply", "falseticker", "survivor"};
+  for (uint8_t i = 0; i < numServers; i++)
+  {
+    const Server &s = servers[i];
+    Serial.printf("  %-20s %-11s", names[i], stateNames[s.state]);
+    if (s.state != no_sample)
+    {
+      Serial.printf(" offset %c%lu.%03u ms, distance %lu us", s.offsetUs < 0 ? '-' : '+',
+                    (unsigned long)(llabs(s.offsetUs) / 1000), (unsigned)(llabs(s.offsetUs) % 1000),
+                    (unsigned long)s.distanceUs);
+    }
+    Serial.println();
+  }
+  Serial.printf("  %u of %u servers agree, distance %lu us\n", survivors, candidates, (unsigned long)distanceUs);
+}
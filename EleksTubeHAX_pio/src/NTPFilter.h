@@ -0,0 +1,85 @@
+#ifndef NTP_FILTER_H
+#define NTP_FILTER_H
+
+#include "GLOBAL_DEFINES.h"
+#include <Arduino.h>
+
+/*
+ * Selects the time from the replies of several NTP servers, like the NTP daemon does (RFC 5905), scaled down:
+ *   1. clock filter: of the last NTP_FILTER_SAMPLES samples of a server, the one with the lowest distance is used; the
+ *      distance is half the round trip plus the errors the server reports plus the age (NTP_PHI ppm of drift),
+ *   2. intersection (Marzullo): every server gives an interval, its time +- distance. The intersection of the most
+ *      intervals is the true time; servers outside it are falsetickers. A majority of the servers has to agree,
+ *   3. combine: the time of the survivors, weighted by 1 / distance.
+ * A sample is kept as the time of the server at a millis() value, so it can be moved to any later moment.
+ */
+
+#define NTP_PHI_PPM 15 // frequency tolerance of the local clock, the distance of a sample grows this much per second
+
+class NTPFilter
+{
+public:
+  NTPFilter() : numServers(0), selected(false), selectedEpochUs(0), selectedMillis(0), distanceUs(0), roundTripUs(0), survivors(0), candidates(0) {}
+
+  // Forgets all samples.
+  void begin(uint8_t servers);
+  // Adds a reply of the server: its time at taken_millis (us since 1970), the round trip without the time in the
+  // server and the errors it reports itself (half its root delay plus its root dispersion and precision), in us.
+  void addSample(uint8_t server, uint64_t epoch_us, uint32_t taken_millis, uint32_t round_trip_us, uint32_t root_us);
+  // Selects the time from the samples. Returns true, if at least NTP_MIN_SURVIVORS servers (all, if fewer are used)
+  // and a majority of the servers with samples agree.
+  bool select();
+
+  // The selected time (us since 1970) now, 0 if none was selected.
+  uint64_t getEpochMicros() const;
+  // Error bound of the selected time, in us: the lowest distance of the survivors.
+  uint32_t getDistance() const { return distanceUs; }
+  // Round trip of the best sample of the survivors, in us.
+  uint32_t getRoundTrip() const { return roundTripUs; }
+  uint8_t getSurvivors() const { return survivors; }
+  uint8_t getCandidates() const { return candidates; } // servers with samples
+  // true, if the selected time is good enough to set the RTC: it was selected and has at most NTP_MAX_DISTANCE_MS.
+  bool isConfident() const { return selected && distanceUs <= NTP_MAX_DISTANCE_MS * 1000UL; }
+  // Prints the best sample of every server and its offset to the selected time.
+  void print(const char *const *names);
+
+private:
+  struct Sample
+  {
+    uint64_t epochUs;     // time of the server at takenMillis
+    uint32_t takenMillis;
+    uint32_t roundTripUs;
+    uint32_t rootUs;
+    bool valid;
+  };
+  enum state_t
+  {
+    no_sample,
+    falseticker,
+    survivor
+  };
+  struct Server
+  {
+    Sample samples[NTP_FILTER_SAMPLES];
+    uint8_t next; // slot for the next sample
+    state_t state;
+    int64_t offsetUs; // of the best sample to the selected time
+    uint32_t distanceUs;
+  };
+
+  Server servers[NTP_MAX_SERVERS];
+  uint8_t numServers;
+  bool selected;
+  uint64_t selectedEpochUs; // at selectedMillis
+  uint32_t selectedMillis;
+  uint32_t distanceUs;
+  uint32_t roundTripUs;
+  uint8_t survivors;
+  uint8_t candidates;
+
+  // The sample with the lowest distance now, NULL if the server has none.
+  const Sample *bestSample(uint8_t server, uint32_t now, uint32_t &distance_us);
+  static uint32_t distance(const Sample &sample, uint32_t now);
+};
+
+#endif // NTP_FILTER_H
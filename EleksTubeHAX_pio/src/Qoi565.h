@@ -0,0 +1,129 @@
+#ifndef QOI565_H
+#define QOI565_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * QOI ("Quite OK Image" format), changed for RGB565 pixels: the compressed image format of the clock face bundles.
+ * Every pixel is coded relative to the one before (left, or the last one of the line above), in one of these ops:
+ *   00iiiiii           INDEX: pixel from the table of recently seen pixels (hash of the color)
+ *   01rrggbb           DIFF:  red, green, blue differ by -2..1
+ *   10gggggg rrrrbbbb  LUMA:  green differs by -32..31, red and blue differ by -8..7 more than green
+ *   11nnnnnn           RUN:   previous pixel repeated 1..62 times
+ *   11111110 hi lo     RGB:   the RGB565 value
+ * Differences wrap around (5 bit for red and blue, 6 bit for green). The image starts with black, the table is black too.
+ * Decoding is one table lookup and a few shifts per pixel, and needs no buffer except the 64 entry table.
+ * Encoded by tools/face_packer.cpp; shared with it, so only plain C++ here.
+ */
+
+#define QOI565_OP_INDEX (0x00)
+#define QOI565_OP_DIFF (0x40)
+#define QOI565_OP_LUMA (0x80)
+#define QOI565_OP_RUN (0xC0)
+#define QOI565_OP_RGB (0xFE)
+#define QOI565_MAX_RUN (62)
+#define QOI565_MAX_BYTES_PER_PIXEL (3)
+
+class Qoi565
+{
+public:
+  Qoi565() { reset(); }
+
+  // Call before the first pixel of an image.
+  void reset()
+  {
+    memset(index, 0, sizeof(index));
+    prev = 0;
+    run = 0;
+  }
+
+  static uint8_t hash(uint16_t color)
+  {
+    return ((color >> 11) * 3 + ((color >> 5) & 0x3F) * 5 + (color & 0x1F) * 7) & 63;
+  }
+
+  /*
+   * Decodes the next count pixels from src and writes them with out(dest, color). Never reads at or after end;
+   * if the data ends too early, the rest is black. Runs can go on into the next call.
+   * Returns the position after the used data.
+   */
+  template <class Output>
+  const uint8_t *decode(const uint8_t *src, const uint8_t *end, uint16_t *dest, int16_t count, Output out)
+  {
+    for (int16_t i = 0; i < count; i++)
+    {
+      if (run > 0)
+      {
+        run--;
+        out(&dest[i], prev);
+        continue;
+      }
+      if (src >= end)
+      {
+        prev = 0;
+        out(&dest[i], 0);
+        continue;
+      }
+      uint8_t op = *src++;
+      if (op == QOI565_OP_RGB)
+      {
+        if (end - src < 2)
+        {
+          src = end;
+          prev = 0;
+          out(&dest[i], 0);
+          continue;
+        }
+        prev = (src[0] << 8) | src[1];
+        src += 2;
+      }
+      else
+      {
+        switch (op & 0xC0)
+        {
+        case QOI565_OP_INDEX:
+          prev = index[op];
+          out(&dest[i], prev);
+          continue; // already in the table
+        case QOI565_OP_DIFF:
+          prev = add(prev, ((op >> 4) & 3) - 2, ((op >> 2) & 3) - 2, (op & 3) - 2);
+          break;
+        case QOI565_OP_LUMA:
+        {
+          if (src >= end)
+          {
+            prev = 0;
+            out(&dest[i], 0);
+            continue;
+          }
+          int8_t dg = (op & 0x3F) - 32;
+          uint8_t rb = *src++;
+          prev = add(prev, dg + (rb >> 4) - 8, dg, dg + (rb & 0x0F) - 8);
+          break;
+        }
+        default: // QOI565_OP_RUN
+          run = op & 0x3F; // this pixel and run more
+          out(&dest[i], prev);
+          continue; // the same pixel, already in the table
+        }
+      }
+      index[hash(prev)] = prev;
+      out(&dest[i], prev);
+    }
+    return src;
+  }
+
+  // Adds the differences to the channels of color, with wrap-around.
+  static uint16_t add(uint16_t color, int8_t dr, int8_t dg, int8_t db)
+  {
+    return ((((color >> 11) + dr) & 0x1F) << 11) | (((((color >> 5) & 0x3F) + dg) & 0x3F) << 5) | (((color & 0x1F) + db) & 0x1F);
+  }
+
+private:
+  uint16_t index[64]; // recently seen pixels, by hash
+  uint16_t prev;      // last decoded pixel
+  uint8_t run;        // pixels of the current run not written yet
+};
+
+#endif // QOI565_H
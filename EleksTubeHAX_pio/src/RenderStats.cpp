@@ -0,0 +1,118 @@
+#include "RenderStats.h"
+
+RenderStats renderStats;
+
+const char *RenderStats::stageNames[num_stages] = {"file_open", "header_parse", "decode", "dimming", "spi_push", "cs_switch"};
+const uint32_t RenderStats::bucketLimits[RENDER_STATS_BUCKETS - 1] = RENDER_STATS_BUCKET_LIMITS_US;
+const uint32_t RenderStats::flipLimits[RENDER_STATS_FLIP_BUCKETS - 1] = RENDER_STATS_FLIP_LIMITS_MS;
+
+void RenderStats::add(Stage &stage, uint32_t time)
+{
+  uint8_t bucket = 0;
+  while (bucket < RENDER_STATS_BUCKETS - 1 && time > bucketLimits[bucket])
+  {
+    bucket++;
+  }
+  stage.histogram[bucket]++;
+  stage.count++;
+  stage.totalTime += time;
+  if (time > stage.maxTime)
+  {
+    stage.maxTime = time;
+  }
+}
+
+void RenderStats::recordLoad(uint8_t file_index, uint32_t start)
+{
+  uint8_t face = file_index / 10;
+  if (face >= RENDER_STATS_FACES)
+  {
+    return;
+  }
+  uint32_t time = elapsed(start);
+  faces[face].loads++;
+  faces[face].totalTime += time;
+  if (time > faces[face].maxTime)
+  {
+    faces[face].maxTime = time;
+  }
+}
+
+void RenderStats::recordFlip(int32_t error_ms)
+{
+  uint32_t error = abs(error_ms);
+  uint8_t bucket = 0;
+  while (bucket < RENDER_STATS_FLIP_BUCKETS - 1 && error > flipLimits[bucket])
+  {
+    bucket++;
+  }
+  flips.histogram[bucket]++;
+  if (flips.count == 0 || error_ms < flips.minError)
+  {
+    flips.minError = error_ms;
+  }
+  if (flips.count == 0 || error_ms > flips.maxError)
+  {
+    flips.maxError = error_ms;
+  }
+  flips.count++;
+  flips.totalError += error_ms;
+}
+
+void RenderStats::reset()
+{
+  memset(stages, 0, sizeof(stages));
+  memset(faces, 0, sizeof(faces));
+  memset(&flips, 0, sizeof(flips));
+  bytesPushed = 0;
+  draws = 0;
+  cacheHits = 0;
+  cacheMisses = 0;
+  since = millis();
+}
+
+void RenderStats::print()
+{
+  Serial.print("Render stats of the last ");
+  Serial.print((millis() - since) / 1000);
+  Serial.println(" s (times in us):");
+  Serial.print("  stage         count      avg      max |");
+  for (uint8_t bucket = 0; bucket < RENDER_STATS_BUCKETS - 1; bucket++)
+  {
+    Serial.printf(" <=%-5u", bucketLimits[bucket]);
+  }
+  Serial.printf("  >%-5u\n", bucketLimits[RENDER_STATS_BUCKETS - 2]);
+  for (uint8_t s = 0; s < num_stages; s++)
+  {
+    const Stage &stage = stages[s];
+    Serial.printf("  %-12s %6u %8u %8u |", stageNames[s], stage.count, stage.count > 0 ? stage.totalTime / stage.count : 0, stage.maxTime);
+    for (uint8_t bucket = 0; bucket < RENDER_STATS_BUCKETS; bucket++)
+    {
+      Serial.printf(" %7u", stage.histogram[bucket]);
+    }
+    Serial.println();
+  }
+  for (uint8_t face = 1; face < RENDER_STATS_FACES; face++)
+  {
+    if (faces[face].loads == 0)
+    {
+      continue;
+    }
+    Serial.printf("  clock face %u: %u images loaded, avg %u, max %u\n", face, faces[face].loads,
+                  faces[face].totalTime / faces[face].loads, faces[face].maxTime);
+  }
+  Serial.printf("  images drawn: %u, bytes pushed: %u, cache hits: %u, misses: %u\n", draws, bytesPushed, cacheHits, cacheMisses);
+  Serial.printf("  flip phase error (ms, > 0 is late): %u flips, avg %d, min %d, max %d\n", flips.count,
+                flips.count > 0 ? (int32_t)(flips.totalError / flips.count) : 0, flips.minError, flips.maxError);
+  Serial.print("   ");
+  for (uint8_t bucket = 0; bucket < RENDER_STATS_FLIP_BUCKETS - 1; bucket++)
+  {
+    Serial.printf(" <=%-5u", flipLimits[bucket]);
+  }
+  Serial.printf("  >%-5u\n   ", flipLimits[RENDER_STATS_FLIP_BUCKETS - 2]);
+  for (uint8_t bucket = 0; bucket < RENDER_STATS_FLIP_BUCKETS; bucket++)
+  {
+    Serial.printf(" %7u", flips.histogram[bucket]);
+  }
+  Serial.println();
+}
@@ -0,0 +1,121 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include "GLOBAL_DEFINES.h"
+
+/*
+ * Timing of the render pipeline, always compiled in. Every stage has a histogram with fixed buckets (upper limits in
+ * RENDER_STATS_BUCKET_LIMITS_US), plus count, total and max. The flip phase error is how far from the start of a second
+ * (Clock::getEpochMillis()) the digits of that second were on the displays. Times are taken with the CPU cycle counter, so a
+ * measurement costs a few cycles and doesn't depend on the millis() resolution.
+ * Dumped by the serial command "stats" and published as MQTT diagnostics (see MQTTReportDiagnostics()).
+ * Every stage is recorded by one task only (the decoder task, if IMAGE_DECODER_TASK is used, or the loop), so no lock
+ * is needed; a reset() during a measurement may only lose that one count.
+ */
+
+#define RENDER_STATS_BUCKET_LIMITS_US {20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000}
+#define RENDER_STATS_BUCKETS (12) // the limits above and one open bucket
+#define RENDER_STATS_FACES (10)   // clock faces 1..9, index is the clock face
+#define RENDER_STATS_FLIP_LIMITS_MS {1, 2, 5, 10, 20, 50, 100, 200, 500}
+#define RENDER_STATS_FLIP_BUCKETS (10) // the limits above and one open bucket
+
+class RenderStats
+{
+public:
+  enum stage_t
+  {
+    file_open,    // opening the image file (or finding the bundle / partition entry)
+    header_parse, // reading and checking the header and the palette
+    decode,       // reading the pixels and converting them (with dimming, if TFT_STREAMING_RENDER)
+    dimming,      // dimming or expanding cached images, while they are sent
+    spi_push,     // sending pixels to the displays, includes waiting for DMA
+    cs_switch,    // selecting other displays, includes finishing the previous transfer
+    num_stages
+  };
+  static const char *stageNames[num_stages];
+  static const uint32_t bucketLimits[RENDER_STATS_BUCKETS - 1]; // us
+  static const uint32_t flipLimits[RENDER_STATS_FLIP_BUCKETS - 1]; // ms
+
+  struct Stage
+  {
+    uint32_t count;
+    uint32_t totalTime; // us
+    uint32_t maxTime;   // us
+    uint32_t histogram[RENDER_STATS_BUCKETS];
+  };
+  struct Face
+  {
+    uint32_t loads;     // images opened and decoded
+    uint32_t totalTime; // us, from opening the file until the image is decoded (and sent, with TFT_STREAMING_RENDER)
+    uint32_t maxTime;   // us
+  };
+  struct Flips
+  {
+    uint32_t count;
+    int64_t totalError; // ms, > 0 is late
+    int32_t minError;   // ms, the earliest flip
+    int32_t maxError;   // ms, the latest flip
+    uint32_t histogram[RENDER_STATS_FLIP_BUCKETS]; // of the error without sign
+  };
+
+  RenderStats() : cyclesPerUs(240) { reset(); }
+  // Takes the CPU clock, call it after the clock is set.
+  void begin()
+  {
+    cyclesPerUs = getCpuFrequencyMhz();
+    reset();
+  }
+
+  static uint32_t now() { return ESP.getCycleCount(); }
+  // Records the time since start (from now()).
+  void record(stage_t stage, uint32_t start) { add(stages[stage], elapsed(start)); }
+  // Records a time summed up from several parts, in cycles.
+  void recordCycles(stage_t stage, uint32_t cycles) { add(stages[stage], cycles / cyclesPerUs); }
+  // Records the time since start and restarts start, for stages done one after the other.
+  void lap(stage_t stage, uint32_t &start)
+  {
+    uint32_t end = now();
+    add(stages[stage], (end - start) / cyclesPerUs);
+    start = end;
+  }
+  // Records the time since start as one image load of the clock face of file_index.
+  void recordLoad(uint8_t file_index, uint32_t start);
+  // Records a flip to a new second, error_ms after (> 0) or before (< 0) the second started.
+  void recordFlip(int32_t error_ms);
+
+  void countBytes(uint32_t bytes) { bytesPushed += bytes; }
+  void countDraw() { draws++; }
+  void countCacheHit() { cacheHits++; }
+  void countCacheMiss() { cacheMisses++; }
+
+  const Stage &getStage(stage_t stage) { return stages[stage]; }
+  const Face &getFace(uint8_t face) { return faces[face]; }
+  const Flips &getFlips() { return flips; }
+  uint32_t getBytesPushed() { return bytesPushed; }
+  uint32_t getDraws() { return draws; } // images drawn, each on one or more displays at once
+  uint32_t getCacheHits() { return cacheHits; }
+  uint32_t getCacheMisses() { return cacheMisses; }
+  uint32_t getSince() { return since; } // millis() of the last reset
+
+  void print();
+  void reset();
+
+private:
+  uint32_t cyclesPerUs;
+  Stage stages[num_stages];
+  Face faces[RENDER_STATS_FACES];
+  Flips flips;
+  uint32_t bytesPushed;
+  uint32_t draws;
+  uint32_t cacheHits;
+  uint32_t cacheMisses;
+  uint32_t since;
+
+  // Cycle counter differences are right for up to 2^32 cycles (17 s at 240 MHz).
+  uint32_t elapsed(uint32_t start) { return (now() - start) / cyclesPerUs; }
+  static void add(Stage &stage, uint32_t time);
+};
+
+extern RenderStats renderStats;
+
+#endif // RENDER_STATS_H
@@ -0,0 +1,108 @@
+#include "RtcDrift.h"
+
+void RtcDrift::begin(StoredConfig::Config::RtcDrift *config_)
+{
+  config = config_;
+  if (config->is_valid != StoredConfig::valid)
+  { // Config is invalid (never saved, or saved by a version without it): the drift is learned from scratch.
+    Serial.println("Loaded RTC drift config is invalid, learning the drift of the RTC from scratch.");
+    config->set_time = 0;
+    config->drift_ppb = 0;
+    config->weight_h = 0;
+    config->aging_offset = 0;
+    config->is_valid = StoredConfig::valid;
+  }
+  baseline_ppb = 0;
+  baseline_h = 0.0f;
+}
+
+bool RtcDrift::measured(uint64_t utc_ms, int32_t error_ms)
+{
+  measured_error_ms = error_ms;
+  residual_ms = 0;
+  uint64_t set_ms = (uint64_t)config->set_time * 1000;
+  if (config->set_time == 0 || utc_ms <= set_ms)
+  {
+    return false;
+  }
+  uint64_t elapsed_ms = utc_ms - set_ms;
+  // setting the RTC and finding the start of its seconds add a few ms, allowed on top of the drift
+  if ((uint64_t)abs(error_ms) > elapsed_ms * RTC_DRIFT_MAX_PPM / 1000000 + CLOCK_RTC_PHASE_MAX_MS)
+  {
+    return false;
+  }
+  residual_ms = error_ms - (int32_t)((int64_t)getDriftPpb() * (int64_t)elapsed_ms / 1000000000LL);
+  if (elapsed_ms >= RTC_DRIFT_MIN_BASELINE_S * 1000ULL)
+  { // replaces the measurement of the same baseline before, this one is longer
+    baseline_ppb = (int32_t)((int64_t)error_ms * 1000000000LL / (int64_t)elapsed_ms) + config->aging_offset * RTC_AGING_STEP_PPB;
+    baseline_h = elapsed_ms / 3600000.0f;
+  }
+  return true;
+}
+
+void RtcDrift::rtcSet(uint32_t utc)
+{
+  fold();
+  config->set_time = utc;
+}
+
+void RtcDrift::trimmed(int8_t aging_offset)
+{
+  fold();
+  config->aging_offset = aging_offset;
+  config->set_time = 0;
+}
+
+void RtcDrift::fold()
+{
+  if (baseline_h > 0.0f)
+  {
+    config->drift_ppb = getRawDriftPpb();
+    config->weight_h = min(config->weight_h + (uint16_t)lroundf(baseline_h), RTC_DRIFT_MAX_HOURS);
+  }
+  baseline_ppb = 0;
+  baseline_h = 0.0f;
+}
+
+int32_t RtcDrift::predictError(uint64_t utc_ms) const
+{
+  uint64_t set_ms = (uint64_t)config->set_time * 1000;
+  if (!isConfident() || config->set_time == 0 || utc_ms <= set_ms)
+  {
+    return 0;
+  }
+  return (int32_t)((int64_t)getDriftPpb() * (int64_t)(utc_ms - set_ms) / 1000000000LL);
+}
+
+int8_t RtcDrift::getBestAgingOffset() const
+{
+  if (getHours() < RTC_AGING_MIN_HOURS || abs(getDriftPpb()) < RTC_AGING_HYSTERESIS * RTC_AGING_STEP_PPB)
+  {
+    return config->aging_offset;
+  }
+  long best = lroundf(getRawDriftPpb() / (float)RTC_AGING_STEP_PPB);
+  return (int8_t)constrain(best, -127L, 127L);
+}
+
+int32_t RtcDrift::getDriftPpb() const
+{
+  return getRawDriftPpb() - config->aging_offset * RTC_AGING_STEP_PPB;
+}
+
+int32_t RtcDrift::getRawDriftPpb() const
+{
+  float hours = getHours();
+  if (hours <= 0.0f)
+  {
+    return 0;
+  }
+  return (int32_t)lroundf((config->drift_ppb * (float)config->weight_h + baseline_ppb * baseline_h) / hours);
+}
+
+void RtcDrift::print() const
+{
+  Serial.printf("RTC drift %+.3f ppm (oscillator %+.3f ppm, aging offset %d), %.1f h of measurements%s\n",
+                getDriftPpb() / 1000.0f, getRawDriftPpb() / 1000.0f, config->aging_offset, getHours(),
+                isConfident() ? "" : ", not used yet");
+  Serial.printf("Last RTC error %+ld ms, %+ld ms from the prediction\n", (long)measured_error_ms, (long)residual_ms);
+}
@@ -0,0 +1,60 @@
+#ifndef RTC_DRIFT_H
+#define RTC_DRIFT_H
+
+#include "GLOBAL_DEFINES.h"
+#include <Arduino.h>
+#include "StoredConfig.h"
+
+/*
+ * Learns how fast the RTC runs from its error at the NTP updates, and predicts its error in between.
+ * The drift is measured from the last time the RTC was set to NTP time: error / time since then. Measurements of the
+ * same baseline replace each other (the longer one is better); when the RTC is set again, the drift of the baseline is
+ * merged into the learned drift, weighted by hours. So the RTC is only set when it is too far off and the baselines
+ * get long. The drift is kept without the trim of the RTC (DS3231 aging offset), so it stays valid when the trim changes.
+ * The learned drift, its weight, the trim and the start of the baseline are stored in the config; the drift of the
+ * current baseline is measured again at the next NTP update.
+ */
+
+class RtcDrift
+{
+public:
+  RtcDrift() : config(NULL), baseline_ppb(0), baseline_h(0.0f), residual_ms(0), measured_error_ms(0) {}
+  void begin(StoredConfig::Config::RtcDrift *config_);
+
+  // The RTC error (RTC - NTP time, in ms) measured at utc_ms. Returns false, if it doesn't tell the drift, because
+  // the RTC wasn't set to NTP time before or is too far off (lost power); the RTC has to be set then.
+  bool measured(uint64_t utc_ms, int32_t error_ms);
+  // The RTC was set to the start of the second utc: starts a new baseline.
+  void rtcSet(uint32_t utc);
+  // The trim of the RTC was changed to aging_offset: it runs at another rate, the RTC has to be set for a new baseline.
+  void trimmed(int8_t aging_offset);
+
+  // The RTC error expected at utc_ms (RTC - true time, in ms), 0 if the drift isn't known well enough yet.
+  int32_t predictError(uint64_t utc_ms) const;
+  // true, if there are RTC_DRIFT_MIN_HOURS of measurements.
+  bool isConfident() const { return getHours() >= RTC_DRIFT_MIN_HOURS; }
+  // The aging offset that cancels most of the drift, the current one if that is within RTC_AGING_HYSTERESIS steps or
+  // there are less than RTC_AGING_MIN_HOURS of measurements.
+  int8_t getBestAgingOffset() const;
+
+  int32_t getDriftPpb() const; // drift with the trim, > 0: the RTC runs fast
+  int32_t getRawDriftPpb() const; // drift of the oscillator without the trim
+  int8_t getAgingOffset() const { return config->aging_offset; }
+  float getHours() const { return config->weight_h + baseline_h; } // of measurements in the drift
+  // The last measured error, and how far the prediction was off (measured - predicted error), in ms.
+  int32_t getMeasuredError() const { return measured_error_ms; }
+  int32_t getResidual() const { return residual_ms; }
+  void print() const;
+
+private:
+  StoredConfig::Config::RtcDrift *config;
+  int32_t baseline_ppb; // raw drift measured since config->set_time
+  float baseline_h;     // hours of that measurement
+  int32_t residual_ms;
+  int32_t measured_error_ms;
+
+  // Merges the drift of the baseline into the learned drift.
+  void fold();
+};
+
+#endif // RTC_DRIFT_H
@@ -35,6 +35,7 @@ public:
   bool isLoaded() { return loaded; }
 
   const static uint8_t str_buffer_size = 32;
+  const static uint8_t time_zone_rule_size = 48;
 
   struct Config
   {
@@ -64,6 +65,22 @@ public:
       char password[str_buffer_size];
       uint8_t WPS_connected; // Write StoredConfig::valid here when valid data is loaded.
     } wifi;
+
+    // New parts go at the end: a config saved by an older version is loaded into the parts before, the new ones stay 0.
+    struct RtcDrift
+    {
+      uint32_t set_time;   // UTC when the RTC was set to NTP time last, its drift is measured from here (0: unknown)
+      int32_t drift_ppb;   // learned drift of the RTC oscillator without trim, > 0: the RTC runs fast
+      uint16_t weight_h;   // hours of measurements in drift_ppb
+      int8_t aging_offset; // trim programmed into the RTC (DS3231 aging offset)
+      uint8_t is_valid;    // Write StoredConfig::valid here when valid data is loaded.
+    } rtc_drift;
+
+    struct TimeZone
+    {
+      char rule[time_zone_rule_size]; // POSIX TZ rule of the local time, empty: the fixed uclock.time_zone_offset is used
+      uint8_t is_valid;               // Write StoredConfig::valid here, when the zone was picked (not the default).
+    } time_zone;
   } config;
 
   const static uint8_t valid = 0x55; // neither 0x00 nor 0xFF, signaling loaded config isn't just default data.
@@ -1,9 +1,17 @@
 #include "TFTs.h"
 #include "WiFi_WPS.h"
 #include "MQTT_client_ips.h"
+#include "Clock.h"
+
+// chip_select can't call a member function of tfts directly
+static void tftsBeforeChipSelectChange()
+{
+  tfts.beforeChipSelectChange();
+}
 
 void TFTs::begin()
 {
+  chip_select.setBeforeChangeCallback(tftsBeforeChipSelectChange);
   chip_select.begin();
   chip_select.setAll(); // Start with all displays selected
 
@@ -13,9 +21,24 @@ void TFTs::begin()
   ledcAttachPin(TFT_ENABLE_PIN, TFT_PWM_CHANNEL); // Attach the pin to the PWM channel
 #else
   pinMode(TFT_ENABLE_PIN, OUTPUT); // Set pin for turning display power on and off.
+#endif
+#ifndef TFT_STREAMING_RENDER
+  imageCache.begin(UnpackedImageBuffer); // get the memory for the image cache
+#endif
+#ifdef IMAGE_DECODER_TASK
+  // images are loaded on the other core; the loop runs on ARDUINO_RUNNING_CORE
+  decodeJobs = xQueueCreate(1, sizeof(DecodeJob));
+  decoderIdle = xSemaphoreCreateBinary();
+  xSemaphoreGive(decoderIdle);
+  decoderCore = 1 - xPortGetCoreID();
+  decoderStatsStart = millis();
+  xTaskCreatePinnedToCore(DecoderTask, "ImageDecoder", IMAGE_DECODER_TASK_STACK, this, 1, NULL, decoderCore);
 #endif
   InvalidateImageInBuffer(); // Signal, that the image in the buffer is invalid and needs to be reloaded and refilled
   init();                    // Initialize the super class.
+#ifdef TFT_DMA_ENABLED
+  initDMA(); // images are sent via DMA, while the next one is loaded
+#endif
   fillScreen(TFT_BLACK);     // to avoid/reduce flickering patterns on the screens
   enableAllDisplays();       // Signal, that the displays are enabled now and do the hardware dimming, if available and enabled
 
@@ -26,7 +49,14 @@ void TFTs::begin()
     return;
   }
 
+#ifdef DEBUG_OUTPUT_IMAGES
+  uint32_t StartTime = millis();
+#endif
   NumberOfClockFaces = CountNumberOfClockFaces();
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("Clock face search time: ");
+  Serial.println(millis() - StartTime);
+#endif
   loadClockFacesNames();
 }
 
@@ -47,6 +77,9 @@ void TFTs::reinit()
 #endif
     InvalidateImageInBuffer(); // Signal, that the image in the buffer is invalid and needs to be reloaded and refilled
     init();                    // Initialize the super class (again).
+#ifdef TFT_DMA_ENABLED
+    initDMA();
+#endif
     fillScreen(TFT_BLACK);     // to avoid/reduce flickering patterns on the screens
     enableAllDisplays();       // Signal, that the displays are enabled now
 #else                          // TFT_SKIP_REINIT
@@ -85,7 +118,11 @@ void TFTs::loadClockFacesNames()
 
 void TFTs::showNoWifiStatus()
 {
+  // the status is drawn over the image, so the next image has to be sent in full
+  selectingDigit = true;
   chip_select.setSecondsOnes();
+  selectingDigit = false;
+  invalidateShownImage(SECONDS_ONES);
   setTextColor(TFT_RED, TFT_BLACK);
   fillRect(0, TFT_HEIGHT - 27, TFT_WIDTH, 27, TFT_BLACK);
   setCursor(5, TFT_HEIGHT - 27, 4); // Font 4. 26 pixel high
@@ -94,7 +131,10 @@ void TFTs::showNoWifiStatus()
 
 void TFTs::showNoMqttStatus()
 {
+  selectingDigit = true;
   chip_select.setSecondsTens();
+  selectingDigit = false;
+  invalidateShownImage(SECONDS_TENS);
   setTextColor(TFT_RED, TFT_BLACK);
   fillRect(0, TFT_HEIGHT - 27, TFT_WIDTH, 27, TFT_BLACK);
   setCursor(5, TFT_HEIGHT - 27, 4);
@@ -146,48 +186,124 @@ void TFTs::setDigit(uint8_t digit, uint8_t value, show_t show)
 
     if (show != no && (old_value != value || show == force))
     {
+      if (show == force)
+      { // send the whole image, the display may show something else now
+        invalidateShownImage(digit);
+      }
       showDigit(digit);
+      showStatus(1 << digit);
+    }
+  }
+}
 
-      if (digit == SECONDS_ONES)
-        if (WifiState != connected)
-        {
-          showNoWifiStatus();
-        }
+/*
+ * Sets the values of all digits. The changed digits that show the same value (same image) are drawn together,
+ * e.g. all six on a forced redraw at 11:11:11, and the image is sent only once.
+ */
+void TFTs::setDigits(const uint8_t *values, show_t show)
+{
+  if (!TFTsEnabled)
+  { // only do this, if the displays are enabled
+    return;
+  }
 
-#if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
-      if (digit == SECONDS_TENS)
-        if (!MQTTConnected)
-        {
-          showNoMqttStatus();
-        }
-#endif
+  uint8_t changed = 0; // map of the digits to draw
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (show != no && (digits[digit] != values[digit] || show == force))
+    {
+      changed |= (1 << digit);
+    }
+    digits[digit] = values[digit];
+  }
+  if (show == force)
+  { // send the whole images, the displays may show something else now
+    invalidateShownImages(changed);
+  }
+
+  // refresh starting on seconds
+  const uint8_t drawOrder[NUM_DIGITS] = {SECONDS_ONES, SECONDS_TENS, MINUTES_ONES, MINUTES_TENS, HOURS_ONES, HOURS_TENS};
+  uint8_t drawn = changed;
+  for (uint8_t i = 0; i < NUM_DIGITS; i++)
+  {
+    uint8_t digit = drawOrder[i];
+    if (!(changed & (1 << digit)))
+    {
+      continue;
+    }
+    uint8_t map = 0;
+    for (uint8_t other = 0; other < NUM_DIGITS; other++)
+    {
+      if ((changed & (1 << other)) && digits[other] == digits[digit])
+      {
+        map |= (1 << other);
+      }
     }
+    changed &= ~map;
+#ifdef DEBUG_OUTPUT_IMAGES
+    Serial.print("Digits drawn together (map): ");
+    Serial.println(map, BIN);
+#endif
+    showDigits(map);
   }
+  showStatus(drawn);
+}
+
+// Draws the WiFi and MQTT status over the digits, if they were just redrawn.
+void TFTs::showStatus(uint8_t map)
+{
+  if (map & (1 << SECONDS_ONES))
+    if (WifiState != connected)
+    {
+      showNoWifiStatus();
+    }
+
+#if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
+  if (map & (1 << SECONDS_TENS))
+    if (!MQTTConnected)
+    {
+      showNoMqttStatus();
+    }
+#endif
 }
 
 /*
- * Displays the bitmap for the value to the given digit.
+ * Displays the bitmap for the value to the given digits. All selected displays get the image at once.
  */
 
-void TFTs::showDigit(uint8_t digit)
+void TFTs::showDigits(uint8_t map)
 {
-  if (TFTsEnabled)
+  if (TFTsEnabled && map != 0)
   { // only do this, if the displays are enabled
-    chip_select.setDigit(digit);
+    uint8_t first = 0;
+    while (!(map & (1 << first)))
+    {
+      first++;
+    }
+    renderStats.countDraw();
 
-    if (digits[digit] == blanked)
+    if (digits[first] == blanked)
     { // Blank Zero
+      selectDigits(map);
       fillScreen(TFT_BLACK);
+      invalidateShownImages(map);
+      countTransfer(TFT_WIDTH * TFT_HEIGHT * sizeof(uint16_t));
     }
     else
     {
-      uint8_t file_index = current_graphic * 10 + digits[digit];
+      uint8_t file_index = current_graphic * 10 + digits[first];
+#ifndef TFT_STREAMING_RENDER
+      // get the image before selecting the displays: the previous image may still be sent via DMA meanwhile
+      CachedFrame *frame = GetImage(file_index);
+      selectDigits(map);
+      if (frame != NULL)
+      {
+        PushImage(map, frame);
+      }
+#else
+      selectDigits(map);
       DrawImage(file_index);
-
-      uint8_t NextNumber = digits[SECONDS_ONES] + 1;
-      if (NextNumber > 9)
-        NextNumber = 0; // pre-load only seconds, because they are drawn first
-      NextFileRequired = current_graphic * 10 + NextNumber;
+#endif
     }
 #ifdef HARDWARE_IPSTUBE_CLOCK
     chip_select.update();
@@ -196,20 +312,139 @@ void TFTs::showDigit(uint8_t digit)
   // else { } //display is disabled, do nothing
 }
 
+#ifndef TFT_STREAMING_RENDER
+/*
+ * Collects the images of the digits, that will change in the next IMAGE_PRELOAD_LOOKAHEAD_SEC seconds,
+ * in the order they will be drawn. Every image is listed only once.
+ * Stops when maxFiles images are found, so images needed soon are not pushed out of the cache by images needed later.
+ */
+uint8_t TFTs::planImagePreload(uint8_t *files, uint8_t maxFiles)
+{
+  uint8_t numFiles = 0;
+  uint8_t shown[NUM_DIGITS];
+  uint8_t upcoming[NUM_DIGITS];
+  // the order in which updateClockDisplay() draws the digits
+  const uint8_t drawOrder[NUM_DIGITS] = {SECONDS_ONES, SECONDS_TENS, MINUTES_ONES, MINUTES_TENS, HOURS_ONES, HOURS_TENS};
+
+  memcpy(shown, digits, sizeof(shown));
+  for (uint16_t ahead = 1; ahead <= IMAGE_PRELOAD_LOOKAHEAD_SEC; ahead++)
+  {
+    uclock.getDigitsAt(uclock.local_time + ahead, upcoming);
+    for (uint8_t i = 0; i < NUM_DIGITS; i++)
+    {
+      uint8_t digit = drawOrder[i];
+      if (upcoming[digit] == shown[digit] || upcoming[digit] == blanked)
+      {
+        continue;
+      }
+      uint8_t file_index = current_graphic * 10 + upcoming[digit];
+      bool listed = false;
+      for (uint8_t f = 0; f < numFiles; f++)
+      {
+        listed |= (files[f] == file_index);
+      }
+      if (!listed)
+      {
+        files[numFiles++] = file_index;
+        if (numFiles >= maxFiles)
+        {
+          return numFiles;
+        }
+      }
+    }
+    memcpy(shown, upcoming, sizeof(shown));
+  }
+  return numFiles;
+}
+
 void TFTs::LoadNextImage()
 {
-  if (NextFileRequired != FileInBuffer)
+  if (!TFTsEnabled)
+  {
+    return;
+  }
+  uint8_t files[IMAGE_CACHE_SLOTS];
+  // the image sent last stays pinned until the next transfer, so plan one image less than there are slots;
+  // otherwise the planned images push each other out of the cache in turn
+  uint8_t numFiles = planImagePreload(files, max(imageCache.getNumSlots() - 1, 1));
+
+  // mark the planned images that are already loaded as used, so they are not replaced by the ones loaded now
+  for (uint8_t f = numFiles; f > 0; f--)
+  {
+    imageCache.find(files[f - 1]);
+  }
+
+  // load only one image per call, the loop has to stay responsive
+  for (uint8_t f = 0; f < numFiles; f++)
   {
+    if (!imageCache.contains(files[f]))
+    {
 #ifdef DEBUG_OUTPUT_IMAGES
-    Serial.println("Preload next img");
+      Serial.print("Preload img: ");
+      Serial.println(files[f]);
+#endif
+#ifdef IMAGE_DECODER_TASK
+      QueueImageLoad(files[f], false); // the next one is queued by a later call
+#else
+      LoadImageIntoBuffer(files[f]);
 #endif
-    LoadImageIntoBuffer(NextFileRequired);
+      return;
+    }
   }
 }
 
+#else  // TFT_STREAMING_RENDER
+void TFTs::LoadNextImage()
+{
+  // nothing to preload, images are decoded while they are drawn
+}
+#endif // TFT_STREAMING_RENDER
+
 void TFTs::InvalidateImageInBuffer()
-{                     // force reload from Flash with new dimming settings
-  FileInBuffer = 255; // invalid, always load first image
+{ // force reload from Flash
+#ifndef TFT_STREAMING_RENDER
+  imageCache.invalidateAll();
+#endif
+#if defined(USE_FACE_BUNDLES) && !defined(USE_FACE_PARTITION)
+  bundleFace = 0; // read the index of the bundle again
+#endif
+}
+
+void TFTs::beforeChipSelectChange()
+{
+  finishTransfer();
+  if (!selectingDigit)
+  { // the displays are selected to draw something else than a digit image
+    invalidateShownImages();
+  }
+}
+
+void TFTs::finishTransfer()
+{
+#ifdef TFT_DMA_ENABLED
+  if (dmaPixels != NULL)
+  {
+    dmaWait();
+    endWrite();
+    dmaPixels = NULL;
+  }
+#endif
+#ifndef TFT_STREAMING_RENDER
+  if (pushedFrame != NULL)
+  { // the cache may replace the image now
+    imageCache.release(pushedFrame);
+    pushedFrame = NULL;
+  }
+#endif
+}
+
+uint8_t TFTs::imageDimming()
+{
+#ifdef DIM_WITH_ENABLE_PIN_PWM
+  return 255; // hardware dimming, images are always loaded with full brightness
+#else
+  return dimming;
+#endif
 }
 
 void TFTs::ProcessUpdatedDimming()
@@ -227,10 +462,51 @@ void TFTs::ProcessUpdatedDimming()
     ledcWrite(TFT_PWM_CHANNEL, CALCDIMVALUE(0));
   }
 #else
-  // "software" dimming is done via alpha blending in the image drawing function
-  // signal that the image in the buffer is invalid and needs to be reloaded and refilled
-  InvalidateImageInBuffer();
+#ifndef TFT_STREAMING_RENDER
+  // "software" dimming is done while the images are sent, the cached images are kept undimmed
+#else
+  // "software" dimming is done while the images are decoded
 #endif
+#endif
+}
+
+void TFTs::selectDigits(uint8_t map)
+{
+  uint32_t cycles = RenderStats::now();
+  selectingDigit = true;
+  chip_select.setDigitMap(map);
+  selectingDigit = false;
+  renderStats.record(RenderStats::cs_switch, cycles);
+}
+
+void TFTs::countTransfer(uint32_t bytes)
+{
+  renderStats.countBytes(bytes);
+  if (current_graphic < 10)
+  {
+    spiBytesPerFace[current_graphic] += bytes;
+    imagesPerFace[current_graphic]++;
+  }
+}
+
+void TFTs::printTransferStats()
+{
+  for (uint8_t face = 1; face < 10; face++)
+  {
+    if (imagesPerFace[face] == 0)
+    {
+      continue;
+    }
+    Serial.print("Clock face ");
+    Serial.print(face);
+    Serial.print(": ");
+    Serial.print(imagesPerFace[face]);
+    Serial.print(" images, ");
+    Serial.print(spiBytesPerFace[face]);
+    Serial.print(" bytes sent (");
+    Serial.print((uint32_t)(100ULL * spiBytesPerFace[face] / ((uint64_t)imagesPerFace[face] * TFT_WIDTH * TFT_HEIGHT * sizeof(uint16_t))));
+    Serial.println("% of full images)");
+  }
 }
 
 bool TFTs::FileExists(const char *path)
@@ -244,11 +520,26 @@ bool TFTs::FileExists(const char *path)
 // These BMP functions are stolen directly from the TFT_SPIFFS_BMP example in the TFT_eSPI library.
 // Unfortunately, they aren't part of the library itself, so I had to copy them.
 // I've modified DrawImage to buffer the whole image at once instead of doing it line-by-line.
+// The header parsing is split from the pixel conversion, so the same code is used for buffering and for streaming.
+
+#ifndef TFT_STREAMING_RENDER
+// Too big to fit on the stack. First slots of the image cache.
+CachedFrame TFTs::UnpackedImageBuffer[IMAGE_CACHE_STATIC_FRAMES];
+// Lines read from the file at once.
+uint8_t TFTs::RawChunkBuffer[IMAGE_READ_CHUNK_BYTES];
+// Two bands of dimmed (or expanded) pixels: one is filled while the other one is sent to the display.
+uint16_t TFTs::DimBuffer[2][IMAGE_DIFF_BAND_LINES * TFT_WIDTH];
+#ifdef IMAGE_CACHE_INDEXED
+uint16_t TFTs::DimmedPalette[256];
+#endif
+#else
+// Two bands of pixels: one is decoded while the other one is sent to the display.
+uint16_t TFTs::BandBuffer[2][TFT_STREAMING_BAND_LINES * TFT_WIDTH];
+// Lines from the file for one band; 24 bits per pixel is the largest format. Also used to read compressed images.
+uint8_t TFTs::RawBandBuffer[RAW_BAND_BUFFER_SIZE];
+#endif
 
-// Too big to fit on the stack.
-uint16_t TFTs::UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
-
-#ifndef USE_CLK_FILES
+#if !defined(USE_CLK_FILES) && !defined(USE_FACE_BUNDLES)
 
 int8_t TFTs::CountNumberOfClockFaces()
 {
@@ -271,11 +562,8 @@ int8_t TFTs::CountNumberOfClockFaces()
   return found;
 }
 
-bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
+bool TFTs::OpenImage(uint8_t file_index, fs::File &bmpFS, ImageInfo &info)
 {
-  uint32_t StartTime = millis();
-
-  fs::File bmpFS;
   // Filenames are no bigger than "255.bmp\0"
   char filename[10];
   sprintf(filename, "/%d.bmp", file_index);
@@ -286,6 +574,7 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
 #endif
 
   // Open requested file on SD card
+  uint32_t cycles = RenderStats::now();
   bmpFS = SPIFFS.open(filename, "r");
   if (!bmpFS)
   {
@@ -293,15 +582,14 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
     Serial.println(filename);
     return (false);
   }
+  renderStats.lap(RenderStats::file_open, cycles);
 
+  // file header and info header in one read
+  uint8_t header[BMP_HEADER_SIZE];
+  size_t headerRead = bmpFS.read(header, sizeof(header));
   uint32_t seekOffset, headerSize, paletteSize = 0;
-  int16_t w, h, row, col;
-  uint16_t r, g, b, bitDepth;
-
-  // black background - clear whole buffer
-  memset(UnpackedImageBuffer, '\0', sizeof(UnpackedImageBuffer));
 
-  uint16_t magic = read16(bmpFS);
+  uint16_t magic = (headerRead >= 2) ? get16(&header[0]) : 0xFFFF;
   if (magic == 0xFFFF)
   {
     Serial.print("Can't openfile. Make sure you upload the SPIFFs image with BMPs. : ");
@@ -318,123 +606,97 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
     return (false);
   }
 
-  read32(bmpFS);              // filesize in bytes
-  read32(bmpFS);              // reserved
-  seekOffset = read32(bmpFS); // start of bitmap
-  headerSize = read32(bmpFS); // header size
-  w = read32(bmpFS);          // width
-  h = read32(bmpFS);          // height
-  read16(bmpFS);              // color planes (must be 1)
-  bitDepth = read16(bmpFS);
+  if (headerRead < sizeof(header))
+  {
+    Serial.println("BMP file truncated.");
+    bmpFS.close();
+    return (false);
+  }
+
+  // 2: filesize in bytes, 6: reserved
+  seekOffset = get32(&header[10]);          // start of bitmap
+  headerSize = get32(&header[14]);          // header size
+  info.w = (int32_t)get32(&header[18]);     // width
+  info.h = (int32_t)get32(&header[22]);     // height
+  // 26: color planes (must be 1)
+  info.bitDepth = get16(&header[28]);
 
   // center image on the display
-  int16_t x = (TFT_WIDTH - w) / 2;
-  int16_t y = (TFT_HEIGHT - h) / 2;
+  info.x = (TFT_WIDTH - info.w) / 2;
+  info.y = (TFT_HEIGHT - info.h) / 2;
 
 #ifdef DEBUG_OUTPUT_IMAGES
   Serial.print(" image W, H, BPP: ");
-  Serial.print(w);
+  Serial.print(info.w);
   Serial.print(", ");
-  Serial.print(h);
+  Serial.print(info.h);
   Serial.print(", ");
-  Serial.println(bitDepth);
+  Serial.println(info.bitDepth);
   Serial.print(" dimming: ");
   Serial.println(dimming);
   Serial.print(" offset x, y: ");
-  Serial.print(x);
+  Serial.print(info.x);
   Serial.print(", ");
-  Serial.println(y);
+  Serial.println(info.y);
 #endif
-  if (read32(bmpFS) != 0 || (bitDepth != 24 && bitDepth != 1 && bitDepth != 4 && bitDepth != 8))
+  // 30: compression
+  if (get32(&header[30]) != 0 || (info.bitDepth != 24 && info.bitDepth != 1 && info.bitDepth != 4 && info.bitDepth != 8) ||
+      headerSize < BMP_HEADER_SIZE - 14 || headerSize > bmpFS.size())
   {
     Serial.println("BMP format not recognized.");
     bmpFS.close();
     return (false);
   }
 
-  uint32_t palette[256];
-  if (bitDepth <= 8) // 1,4,8 bit bitmap: read color palette
+  if ((int32_t)get32(&header[18]) != info.w || (int32_t)get32(&header[22]) != info.h ||
+      info.w <= 0 || info.h <= 0 || info.w > TFT_WIDTH || info.h > TFT_HEIGHT)
+  {
+    Serial.println("BMP size not supported, must fit the display.");
+    bmpFS.close();
+    return (false);
+  }
+
+  if (info.bitDepth <= 8) // 1,4,8 bit bitmap: read color palette
   {
-    read32(bmpFS);
-    read32(bmpFS);
-    read32(bmpFS); // size, w resolution, h resolution
-    paletteSize = read32(bmpFS);
+    // 34: image size, 38: w resolution, 42: h resolution
+    paletteSize = get32(&header[46]);
     if (paletteSize == 0)
-      paletteSize = pow(2, bitDepth); // if 0, size is 2^bitDepth
-    bmpFS.seek(14 + headerSize);      // start of color palette
-    for (uint16_t i = 0; i < paletteSize; i++)
+      paletteSize = 1 << info.bitDepth; // if 0, size is 2^bitDepth
+    if (paletteSize > (1UL << info.bitDepth))
+    {
+      Serial.println("BMP palette too large.");
+      bmpFS.close();
+      return (false);
+    }
+    // the whole palette in one read, directly into place; BMP and ESP32 are both little-endian
+    memset(info.palette, 0, sizeof(info.palette)); // missing entries are black
+    bmpFS.seek(14 + headerSize); // start of color palette
+    if (bmpFS.read((uint8_t *)info.palette, paletteSize * 4) != paletteSize * 4)
     {
-      palette[i] = read32(bmpFS);
+      Serial.println("BMP file truncated.");
+      bmpFS.close();
+      return (false);
     }
   }
 
-  bmpFS.seek(seekOffset);
-
-  uint32_t lineSize = ((bitDepth * w + 31) >> 5) * 4;
-  uint8_t lineBuffer[lineSize];
-
-  // row is decremented as the BMP image is drawn bottom up
-  for (row = h - 1; row >= 0; row--)
+  info.dataOffset = seekOffset;
+  info.lineSize = ((info.bitDepth * info.w + 31) >> 5) * 4;
+  info.bottomUp = true; // BMP image is stored bottom up
+  info.swapped = false;
+  // no overflow: headerSize and lineSize * h are both limited above
+  if (info.dataOffset < 14 + headerSize || info.dataOffset > bmpFS.size() || info.lineSize * info.h > bmpFS.size() - info.dataOffset)
   {
-    bmpFS.read(lineBuffer, sizeof(lineBuffer));
-    uint8_t *bptr = lineBuffer;
-
-    // Convert 24 to 16 bit colours while copying to output buffer.
-    for (col = 0; col < w; col++)
-    {
-      if (bitDepth == 24)
-      {
-        b = *bptr++;
-        g = *bptr++;
-        r = *bptr++;
-      }
-      else
-      {
-        uint32_t c = 0;
-        if (bitDepth == 8)
-        {
-          c = palette[*bptr++];
-        }
-        else if (bitDepth == 4)
-        {
-          c = palette[(*bptr >> ((col & 0x01) ? 0 : 4)) & 0x0F];
-          if (col & 0x01)
-            bptr++;
-        }
-        else
-        { // bitDepth == 1
-          c = palette[(*bptr >> (7 - (col & 0x07))) & 0x01];
-          if ((col & 0x07) == 0x07)
-            bptr++;
-        }
-        b = c;
-        g = c >> 8;
-        r = c >> 16;
-      }
-
-      uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xFF) >> 3);
-#ifndef DIM_WITH_ENABLE_PIN_PWM // skip alpha blending for dimming if hardware dimming is used
-      if (dimming < 255)
-      { // only dim when needed
-        color = alphaBlend(dimming, color, TFT_BLACK);
-      } // dimming
-#endif
-
-      UnpackedImageBuffer[row + y][col + x] = color;
-    } // col
-  } // row
-  FileInBuffer = file_index;
-
-  bmpFS.close();
-#ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("img load time: ");
-  Serial.println(millis() - StartTime);
-#endif
+    Serial.println("BMP file truncated.");
+    bmpFS.close();
+    return (false);
+  }
+  bmpFS.seek(info.dataOffset);
+  renderStats.record(RenderStats::header_parse, cycles);
   return (true);
 }
 #endif
 
-#ifdef USE_CLK_FILES
+#if defined(USE_CLK_FILES) && !defined(USE_FACE_BUNDLES)
 
 int8_t TFTs::CountNumberOfClockFaces()
 {
@@ -457,11 +719,8 @@ int8_t TFTs::CountNumberOfClockFaces()
   return found;
 }
 
-bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
+bool TFTs::OpenImage(uint8_t file_index, fs::File &bmpFS, ImageInfo &info)
 {
-  uint32_t StartTime = millis();
-
-  fs::File bmpFS;
   // Filenames are no bigger than "255.clk\0"
   char filename[10];
   sprintf(filename, "/%d.clk", file_index);
@@ -472,6 +731,7 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
 #endif
 
   // Open requested file on SD card
+  uint32_t cycles = RenderStats::now();
   bmpFS = SPIFFS.open(filename, "r");
   if (!bmpFS)
   {
@@ -479,14 +739,13 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
     Serial.println(filename);
     return (false);
   }
+  renderStats.lap(RenderStats::file_open, cycles);
 
-  int16_t w, h, row, col;
-  uint16_t r, g, b;
+  // the whole header in one read
+  uint8_t header[CLK_HEADER_SIZE];
+  size_t headerRead = bmpFS.read(header, sizeof(header));
 
-  // black background - clear whole buffer
-  memset(UnpackedImageBuffer, '\0', sizeof(UnpackedImageBuffer));
-
-  uint16_t magic = read16(bmpFS);
+  uint16_t magic = (headerRead >= 2) ? get16(&header[0]) : 0xFFFF;
   if (magic == 0xFFFF)
   {
     Serial.print("Can't openfile. Make sure you upload the SPIFFs image with images. : ");
@@ -503,98 +762,952 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
     return (false);
   }
 
-  w = read16(bmpFS);
-  h = read16(bmpFS);
+  if (headerRead < sizeof(header))
+  {
+    Serial.println("CLK file truncated.");
+    bmpFS.close();
+    return (false);
+  }
+
+  info.w = get16(&header[2]);
+  info.h = get16(&header[4]);
 
   // center image on the display
-  int16_t x = (TFT_WIDTH - w) / 2;
-  int16_t y = (TFT_HEIGHT - h) / 2;
+  info.x = (TFT_WIDTH - info.w) / 2;
+  info.y = (TFT_HEIGHT - info.h) / 2;
 
 #ifdef DEBUG_OUTPUT_IMAGES
   Serial.print(" image W, H: ");
-  Serial.print(w);
+  Serial.print(info.w);
   Serial.print(", ");
-  Serial.println(h);
+  Serial.println(info.h);
   Serial.print(" dimming: ");
   Serial.println(dimming);
   Serial.print(" offset x, y: ");
-  Serial.print(x);
+  Serial.print(info.x);
   Serial.print(", ");
-  Serial.println(y);
+  Serial.println(info.y);
 #endif
 
-  uint8_t lineBuffer[w * 2];
-
-  // 0,0 coordinates are top left
-  for (row = 0; row < h; row++)
+  if (info.w <= 0 || info.h <= 0 || info.w > TFT_WIDTH || info.h > TFT_HEIGHT)
   {
-    bmpFS.read(lineBuffer, sizeof(lineBuffer));
-    uint8_t PixM, PixL;
-
-    // Colors are already in 16-bit R5, G6, B5 format
-    for (col = 0; col < w; col++)
-    {
-#ifdef DIM_WITH_ENABLE_PIN_PWM
-      // skip alpha blending for dimming if hardware dimming is used
-      UnpackedImageBuffer[row + y][col + x] = (lineBuffer[col * 2 + 1] << 8) | (lineBuffer[col * 2]);
-#else
-      if (dimming == 255)
-      { // not needed, copy directly
-        UnpackedImageBuffer[row + y][col + x] = (lineBuffer[col * 2 + 1] << 8) | (lineBuffer[col * 2]);
-      }
-      else
-      {
-        // 16 BPP pixel format: R5, G6, B5 ; bin: RRRR RGGG GGGB BBBB
-        PixM = lineBuffer[col * 2 + 1];
-        PixL = lineBuffer[col * 2];
-        // align to 8-bit value (MSB left aligned)
-        r = (PixM) & 0xF8;
-        g = ((PixM << 5) | (PixL >> 3)) & 0xFC;
-        b = (PixL << 3) & 0xF8;
-        r *= dimming;
-        g *= dimming;
-        b *= dimming;
-        r = r >> 8;
-        g = g >> 8;
-        b = b >> 8;
-        UnpackedImageBuffer[row + y][col + x] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-      } // dimming
-#endif
-    } // col
-  } // row
-  FileInBuffer = file_index;
+    Serial.println("CLK size not supported, must fit the display.");
+    bmpFS.close();
+    return (false);
+  }
 
-  bmpFS.close();
-#ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("img load time: ");
-  Serial.println(millis() - StartTime);
-#endif
+  info.bitDepth = 16; // Colors are already in 16-bit R5, G6, B5 format
+  info.dataOffset = CLK_HEADER_SIZE;
+  info.lineSize = info.w * 2;
+  info.bottomUp = false; // 0,0 coordinates are top left
+  info.swapped = false;
+  if (info.dataOffset + info.lineSize * info.h > bmpFS.size())
+  {
+    Serial.println("CLK file truncated.");
+    bmpFS.close();
+    return (false);
+  }
+  renderStats.record(RenderStats::header_parse, cycles);
   return (true);
 }
 #endif
 
-void TFTs::DrawImage(uint8_t file_index)
+#ifdef USE_FACE_PARTITION
+
+int8_t TFTs::CountNumberOfClockFaces()
 {
+  Serial.print("Searching for clock faces in the face partition... ");
+  facePartition.begin();
+  Serial.print(facePartition.getNumberOfClockFaces());
+  Serial.println(" fonts found.");
+  return facePartition.getNumberOfClockFaces();
+}
+
+bool TFTs::OpenImage(uint8_t file_index, fs::File &bmpFS, ImageInfo &info)
+{
+  uint32_t cycles = RenderStats::now();
+  FaceBundleEntry index;
+  info.mapped = facePartition.getImage(file_index / 10, file_index % 10, index);
+  if (info.mapped == NULL)
+  {
+    Serial.print("Image not in face partition: ");
+    Serial.println(file_index);
+    return (false);
+  }
+  renderStats.lap(RenderStats::file_open, cycles);
+
+  info.w = index.w;
+  info.h = index.h;
+  // center image on the display
+  info.x = (TFT_WIDTH - info.w) / 2;
+  info.y = (TFT_HEIGHT - info.h) / 2;
+  info.bitDepth = 16;
+  info.dataOffset = 0; // the lines are read from info.mapped
+  info.lineSize = info.w * 2;
+  info.bottomUp = false;
+  info.swapped = true; // already in the byte order of the display
+  info.compressed = (index.format == FACE_BUNDLE_FORMAT_QOI565);
+  info.next = info.mapped;
+  info.end = info.mapped + index.size;
 
-  uint32_t StartTime = millis();
 #ifdef DEBUG_OUTPUT_IMAGES
-  Serial.println("");
-  Serial.print("Drawing image: ");
+  Serial.print("Loading from face partition: ");
   Serial.println(file_index);
+  Serial.print(" image W, H: ");
+  Serial.print(info.w);
+  Serial.print(", ");
+  Serial.println(info.h);
 #endif
-  // check if file is already loaded into buffer; skip loading if it is. Saves 50 to 150 msec of time.
-  if (file_index != FileInBuffer)
+  renderStats.record(RenderStats::header_parse, cycles);
+  return (true);
+}
+
+void TFTs::CloseImage(fs::File &bmpFS)
+{
+  // nothing to close, the partition stays mapped
+}
+#elif defined(USE_FACE_BUNDLES)
+
+int8_t TFTs::CountNumberOfClockFaces()
+{
+  int8_t i, found;
+  char filename[10];
+
+  Serial.print("Searching for clock face bundles... ");
+  found = 0;
+  for (i = 1; i < 10; i++)
   {
-#ifdef DEBUG_OUTPUT_IMAGES
-    Serial.println("Not preloaded; loading now...");
-#endif
-    LoadImageIntoBuffer(file_index);
+    sprintf(filename, "/%d.fcb", i); // search for files 1.fcb, 2.fcb,...
+    if (!FileExists(filename))
+    {
+      found = i - 1;
+      break;
+    }
   }
+  Serial.print(found);
+  Serial.println(" fonts found.");
+  return found;
+}
 
-  bool oldSwapBytes = getSwapBytes();
-  setSwapBytes(true);
-  pushImage(0, 0, TFT_WIDTH, TFT_HEIGHT, reinterpret_cast<uint16_t *>(UnpackedImageBuffer));
-  setSwapBytes(oldSwapBytes);
+/*
+ * Opens the bundle of the clock face and reads its index. The bundle stays open until another clock face is used.
+ */
+bool TFTs::OpenBundle(uint8_t face)
+{
+  if (bundleFace == face)
+  {
+    return (true);
+  }
+  if (bundleFile)
+  {
+    bundleFile.close();
+  }
+  bundleFace = 0;
+
+  char filename[10];
+  sprintf(filename, "/%d.fcb", face);
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("Opening bundle: ");
+  Serial.println(filename);
+#endif
+  bundleFile = SPIFFS.open(filename, "r");
+  if (!bundleFile)
+  {
+    Serial.print("File not found: ");
+    Serial.println(filename);
+    return (false);
+  }
+
+  uint8_t header[FACE_BUNDLE_HEADER_SIZE];
+  if (bundleFile.read(header, sizeof(header)) != sizeof(header) || get16(&header[0]) != FACE_BUNDLE_MAGIC ||
+      header[2] != FACE_BUNDLE_VERSION || header[3] != FACE_BUNDLE_DIGITS)
+  {
+    Serial.print("File not a clock face bundle: ");
+    Serial.println(filename);
+    bundleFile.close();
+    return (false);
+  }
+  for (uint8_t digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+  {
+    const uint8_t *entry = &header[4 + digit * FACE_BUNDLE_ENTRY_SIZE];
+    FaceBundleEntry &index = bundleIndex[digit];
+    index.offset = get32(&entry[0]);
+    index.size = get32(&entry[4]);
+    index.w = get16(&entry[8]);
+    index.h = get16(&entry[10]);
+    index.format = entry[12];
+    if (!faceBundleEntryValid(index, TFT_WIDTH, TFT_HEIGHT) || index.offset < FACE_BUNDLE_HEADER_SIZE ||
+        !faceBundleRangeValid(index.offset, index.size, bundleFile.size()))
+    {
+      Serial.print("Clock face bundle broken: ");
+      Serial.println(filename);
+      bundleFile.close();
+      return (false);
+    }
+  }
+  bundleFace = face;
+  return (true);
+}
+
+bool TFTs::OpenImage(uint8_t file_index, fs::File &bmpFS, ImageInfo &info)
+{
+  uint32_t cycles = RenderStats::now();
+  if (!OpenBundle(file_index / 10)) // reads the index only when the clock face changes
+  {
+    return (false);
+  }
+  renderStats.lap(RenderStats::file_open, cycles);
+  const FaceBundleEntry &index = bundleIndex[file_index % 10];
+
+  info.w = index.w;
+  info.h = index.h;
+  // center image on the display
+  info.x = (TFT_WIDTH - info.w) / 2;
+  info.y = (TFT_HEIGHT - info.h) / 2;
+  info.bitDepth = 16;
+  info.dataOffset = index.offset;
+  info.lineSize = info.w * 2;
+  info.bottomUp = false;
+  info.swapped = true; // already in the byte order of the display
+  info.compressed = (index.format == FACE_BUNDLE_FORMAT_QOI565);
+  info.compressedLeft = index.size;
+
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("Loading from bundle: ");
+  Serial.println(file_index);
+  Serial.print(" image W, H: ");
+  Serial.print(info.w);
+  Serial.print(", ");
+  Serial.println(info.h);
+#endif
+
+  bmpFS = bundleFile; // same file, stays open; see CloseImage()
+  bmpFS.seek(info.dataOffset);
+  renderStats.record(RenderStats::header_parse, cycles);
+  return (true);
+}
+
+void TFTs::CloseImage(fs::File &bmpFS)
+{
+  // the bundle stays open for the next image
+}
+#else
+void TFTs::CloseImage(fs::File &bmpFS)
+{
+  bmpFS.close();
+}
+#endif
+
+// Final step of every decoder: software dimming and byte order, resolved at compile time.
+template <bool Dim, bool Swap>
+static inline uint16_t outputPixel(uint16_t color, const DimmingTables &dimmer)
+{
+  if (Dim)
+    color = dimmer.dim(color);
+  if (Swap)
+    color = (color << 8) | (color >> 8);
+  return color;
+}
+
+static inline uint16_t rgb888To565(uint8_t r, uint8_t g, uint8_t b)
+{
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// 1, 4 and 8 bit BMP: palette565 is already dimmed and in the output byte order.
+template <uint8_t BitDepth>
+void TFTs::DecodePaletteLine(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer)
+{
+  const uint8_t perByte = 8 / BitDepth;
+  const uint8_t mask = (1 << BitDepth) - 1;
+  for (int16_t col = 0; col < info.w; col++)
+  {
+    uint8_t shift = (perByte - 1 - (col % perByte)) * BitDepth; // leftmost pixel in the high bits
+    dest[col] = info.palette565[(line[col / perByte] >> shift) & mask];
+  }
+}
+
+// CLK file: 16 BPP pixel format: R5, G6, B5 ; bin: RRRR RGGG GGGB BBBB, little-endian.
+// Bundles: the same, but MSB first (Swapped), as the display wants it.
+template <bool Swapped, bool Dim, bool Swap>
+void TFTs::Decode565Line(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer)
+{
+  if (Swapped && Swap && !Dim)
+  { // nothing to convert
+    memcpy(dest, line, info.w * 2);
+    return;
+  }
+  for (int16_t col = 0; col < info.w; col++)
+  {
+    uint16_t color = Swapped ? ((line[col * 2] << 8) | line[col * 2 + 1]) : (line[col * 2] | (line[col * 2 + 1] << 8));
+    dest[col] = outputPixel<Dim, Swap>(color, dimmer);
+  }
+}
+
+// 24 bit BMP: B, G, R bytes. Four pixels are taken from three 32-bit words at once.
+template <bool Dim, bool Swap>
+void TFTs::Decode888Line(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer)
+{
+  int16_t col = 0;
+  for (; col + 4 <= info.w; col += 4)
+  {
+    uint32_t w0, w1, w2; // b0 g0 r0 b1 | g1 r1 b2 g2 | r2 b3 g3 r3
+    memcpy(&w0, line, 4);
+    memcpy(&w1, line + 4, 4);
+    memcpy(&w2, line + 8, 4);
+    line += 12;
+    dest[col] = outputPixel<Dim, Swap>(((w0 >> 8) & 0xF800) | ((w0 >> 5) & 0x07E0) | ((w0 >> 3) & 0x001F), dimmer);
+    dest[col + 1] = outputPixel<Dim, Swap>((w1 & 0xF800) | ((w1 << 3) & 0x07E0) | (w0 >> 27), dimmer);
+    dest[col + 2] = outputPixel<Dim, Swap>(((w2 << 8) & 0xF800) | ((w1 >> 21) & 0x07E0) | ((w1 >> 19) & 0x001F), dimmer);
+    dest[col + 3] = outputPixel<Dim, Swap>(((w2 >> 16) & 0xF800) | ((w2 >> 13) & 0x07E0) | ((w2 >> 11) & 0x001F), dimmer);
+  }
+  for (; col < info.w; col++)
+  {
+    dest[col] = outputPixel<Dim, Swap>(rgb888To565(line[2], line[1], line[0]), dimmer);
+    line += 3;
+  }
+}
+
+// QOI565 compressed bundle image: the decoder gives RGB565 values, MSB first like the uncompressed bundles.
+template <bool Dim, bool Swap>
+const uint8_t *TFTs::DecodeQoiLine(Qoi565 &qoi, const uint8_t *src, const uint8_t *end, uint16_t *dest, int16_t count, const DimmingTables &dimmer)
+{
+  return qoi.decode(src, end, dest, count, [&dimmer](uint16_t *pixel, uint16_t color)
+                    { *pixel = outputPixel<Dim, Swap>(color, dimmer); });
+}
+
+/*
+ * Decodes the next line of a compressed image into dest. Lines can only be decoded in order, starting with the first.
+ * Compressed data from the file is read into buffer as needed. Returns false, if the file can't be read.
+ */
+bool TFTs::DecodeCompressedLine(fs::File &f, ImageInfo &info, uint16_t *dest, uint8_t *buffer, size_t bufferSize)
+{
+  size_t available = info.end - info.next;
+  size_t needed = info.w * QOI565_MAX_BYTES_PER_PIXEL; // enough for any line
+  if ((info.mapped == NULL) && (available < needed) && (info.compressedLeft > 0))
+  { // move the rest to the start of the buffer and fill it up
+    memmove(buffer, info.next, available);
+    size_t size = min((size_t)info.compressedLeft, bufferSize - available);
+    if (f.read(&buffer[available], size) != size)
+    {
+      Serial.println("Image file truncated.");
+      return (false);
+    }
+    info.compressedLeft -= size;
+    info.next = buffer;
+    info.end = &buffer[available + size];
+  }
+  info.next = info.decodeCompressed(info.qoi, info.next, info.end, dest, info.w, dimmer);
+  return (true);
+}
+
+void TFTs::SelectDecoder(ImageInfo &info, bool dim, bool swap)
+{
+  if (info.compressed)
+  {
+    info.decodeCompressed = dim ? (swap ? DecodeQoiLine<true, true> : DecodeQoiLine<true, false>)
+                                : (swap ? DecodeQoiLine<false, true> : DecodeQoiLine<false, false>);
+    return;
+  }
+
+  if (info.bitDepth <= 8)
+  { // convert the palette once instead of every pixel
+    for (uint16_t i = 0; i < (1 << info.bitDepth); i++)
+    {
+      uint32_t c = info.palette[i];
+      uint16_t color = rgb888To565(c >> 16, c >> 8, c);
+      if (dim)
+        color = dimmer.dim(color);
+      if (swap)
+        color = (color << 8) | (color >> 8);
+      info.palette565[i] = color;
+    }
+  }
+
+  switch (info.bitDepth)
+  {
+  case 1:
+    info.decode = DecodePaletteLine<1>;
+    break;
+  case 4:
+    info.decode = DecodePaletteLine<4>;
+    break;
+  case 8:
+    info.decode = DecodePaletteLine<8>;
+    break;
+  case 16:
+    if (info.swapped)
+      info.decode = dim ? (swap ? Decode565Line<true, true, true> : Decode565Line<true, true, false>)
+                        : (swap ? Decode565Line<true, false, true> : Decode565Line<true, false, false>);
+    else
+      info.decode = dim ? (swap ? Decode565Line<false, true, true> : Decode565Line<false, true, false>)
+                        : (swap ? Decode565Line<false, false, true> : Decode565Line<false, false, false>);
+    break;
+  default: // 24
+    info.decode = dim ? (swap ? Decode888Line<true, true> : Decode888Line<true, false>)
+                      : (swap ? Decode888Line<false, true> : Decode888Line<false, false>);
+    break;
+  }
+}
+
+#ifndef TFT_STREAMING_RENDER
+bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
+{
+  uint32_t StartTime = millis();
+  uint32_t loadCycles = RenderStats::now();
+
+  fs::File bmpFS;
+  ImageInfo info;
+  if (!OpenImage(file_index, bmpFS, info))
+  {
+    return (false);
+  }
+
+  int8_t slot = imageCache.reserve();
+#ifndef IMAGE_DECODER_TASK
+  if (slot < 0)
+  { // the only slot that could be replaced holds the image that is still sent
+    finishTransfer();
+    slot = imageCache.reserve();
+  }
+#endif
+  if (slot < 0)
+  { // all images are in use
+    CloseImage(bmpFS);
+    return (false);
+  }
+  CachedFrame *frame = imageCache.getFrame(slot);
+  uint32_t decodeCycles = RenderStats::now();
+
+#ifdef IMAGE_CACHE_INDEXED
+  if (!ReadIndexedImage(bmpFS, info, frame))
+  {
+    CloseImage(bmpFS);
+    return (false);
+  }
+#else
+  uint16_t *buffer = frame->pixels;
+  // black background - clear whole buffer
+  memset(buffer, '\0', IMAGE_CACHE_FRAME_BYTES);
+
+  SelectDecoder(info, false, true); // cached undimmed, in the byte order of the display
+
+  if (info.compressed)
+  {
+    for (int16_t row = 0; row < info.h; row++)
+    {
+      if (!DecodeCompressedLine(bmpFS, info, &buffer[(row + info.y) * TFT_WIDTH + info.x], RawChunkBuffer, sizeof(RawChunkBuffer)))
+      {
+        CloseImage(bmpFS);
+        return (false);
+      }
+    }
+  }
+  else
+  {
+    // read as many lines at once as fit into the buffer; they are in file order
+    int16_t chunkLines = sizeof(RawChunkBuffer) / info.lineSize;
+    for (int16_t first = 0; first < info.h; first += chunkLines)
+    {
+      int16_t lines = min(chunkLines, (int16_t)(info.h - first));
+      const uint8_t *raw = ReadLines(bmpFS, info, first, lines, RawChunkBuffer);
+      if (raw == NULL)
+      {
+        CloseImage(bmpFS);
+        return (false);
+      }
+      for (int16_t l = 0; l < lines; l++)
+      {
+        int16_t line = first + l;
+        int16_t row = info.bottomUp ? (info.h - 1 - line) : line;
+        DecodeLine(info, &raw[l * info.lineSize], &buffer[(row + info.y) * TFT_WIDTH + info.x]);
+      }
+    }
+  }
+#endif
+  renderStats.record(RenderStats::decode, decodeCycles);
+  imageCache.store(slot, file_index);
+
+  CloseImage(bmpFS);
+  renderStats.recordLoad(file_index, loadCycles);
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("img load time (");
+  Serial.print(info.bitDepth);
+  Serial.print(" bpp): ");
+  Serial.println(millis() - StartTime);
+#endif
+  return (true);
+}
+
+#ifdef IMAGE_CACHE_INDEXED
+/*
+ * Keeps the palette and the palette indices of the image in the frame. Only for 1, 4 and 8 bit BMP files.
+ */
+bool TFTs::ReadIndexedImage(fs::File &bmpFS, ImageInfo &info, CachedFrame *frame)
+{
+  if (info.bitDepth > 8)
+  {
+    Serial.println("IMAGE_CACHE_INDEXED needs 1, 4 or 8 bit BMP files!");
+    return (false);
+  }
+  SelectDecoder(info, false, true); // converts the palette: undimmed, in the byte order of the display
+  memcpy(frame->palette, info.palette565, sizeof(frame->palette));
+  frame->x = info.x;
+  frame->y = info.y;
+  frame->w = info.w;
+  frame->h = info.h;
+
+  const uint8_t perByte = 8 / info.bitDepth;
+  const uint8_t mask = (1 << info.bitDepth) - 1;
+  int16_t chunkLines = sizeof(RawChunkBuffer) / info.lineSize;
+  for (int16_t first = 0; first < info.h; first += chunkLines)
+  {
+    int16_t lines = min(chunkLines, (int16_t)(info.h - first));
+    const uint8_t *raw = ReadLines(bmpFS, info, first, lines, RawChunkBuffer);
+    if (raw == NULL)
+    {
+      return (false);
+    }
+    for (int16_t l = 0; l < lines; l++)
+    {
+      int16_t line = first + l;
+      int16_t row = info.bottomUp ? (info.h - 1 - line) : line;
+      const uint8_t *source = &raw[l * info.lineSize];
+      uint8_t *dest = &frame->pixels[row * info.w];
+      if (info.bitDepth == 8)
+      {
+        memcpy(dest, source, info.w);
+        continue;
+      }
+      for (int16_t col = 0; col < info.w; col++)
+      {
+        uint8_t shift = (perByte - 1 - (col % perByte)) * info.bitDepth; // leftmost pixel in the high bits
+        dest[col] = (source[col / perByte] >> shift) & mask;
+      }
+    }
+  }
+  return (true);
+}
+#endif
+
+/*
+ * Returns the image from the cache; loads it, if it is not cached yet.
+ * Returns NULL if the image can't be loaded. The image is pinned in the cache until finishTransfer() releases it.
+ */
+CachedFrame *TFTs::GetImage(uint8_t file_index)
+{
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.println("");
+  Serial.print("Drawing image: ");
+  Serial.println(file_index);
+#endif
+  // check if file is already loaded into the cache; skip loading if it is. Saves 50 to 150 msec of time.
+  CachedFrame *frame = imageCache.acquire(file_index);
+  if (frame != NULL)
+  {
+    imageCache.countHit();
+    renderStats.countCacheHit();
+    return frame;
+  }
+
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.println("Not preloaded; loading now...");
+#endif
+  uint32_t LoadStartTime = millis();
+  renderStats.countCacheMiss();
+#ifdef IMAGE_DECODER_TASK
+  finishTransfer(); // the decoder task can't do that, if it needs the slot of the image that is still sent
+  QueueImageLoad(file_index, true);
+  frame = imageCache.acquire(file_index);
+#else
+  if (LoadImageIntoBuffer(file_index))
+  {
+    frame = imageCache.acquire(file_index);
+  }
+#endif
+  if (frame != NULL)
+  {
+    imageCache.countMiss(millis() - LoadStartTime);
+  }
+  return frame;
+}
+
+#ifdef IMAGE_DECODER_TASK
+/*
+ * Decoder task: loads the images queued by QueueImageLoad() into the cache, one after the other.
+ * Runs on the core the loop doesn't use, so the loop only has to send the images.
+ */
+void TFTs::DecoderTask(void *parameter)
+{
+  TFTs *tfts = (TFTs *)parameter;
+  DecodeJob job;
+  for (;;)
+  {
+    if (xQueueReceive(tfts->decodeJobs, &job, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+    uint32_t start = millis();
+    tfts->LoadImageIntoBuffer(job.file_index);
+    uint32_t end = millis();
+
+    tfts->decoderJobs++;
+    tfts->decoderBusyTime += end - start;
+    uint32_t latency = end - job.queued;
+    tfts->decoderLatencyTotal += latency;
+    if (latency > tfts->decoderLatencyMax)
+    {
+      tfts->decoderLatencyMax = latency;
+    }
+    xSemaphoreGive(tfts->decoderIdle);
+  }
+}
+
+/*
+ * Hands the image to the decoder task. With wait, waits until the decoder is free and the image is loaded.
+ * Without wait, returns false if the decoder is still busy with another image.
+ */
+bool TFTs::QueueImageLoad(uint8_t file_index, bool wait)
+{
+  if (xSemaphoreTake(decoderIdle, wait ? portMAX_DELAY : 0) != pdTRUE)
+  {
+    return (false);
+  }
+  if (imageCache.contains(file_index))
+  { // loaded meanwhile
+    xSemaphoreGive(decoderIdle);
+    return (true);
+  }
+  DecodeJob job;
+  job.file_index = file_index;
+  job.queued = millis();
+  xQueueSend(decodeJobs, &job, portMAX_DELAY);
+  if (wait)
+  { // idle again, when the job is done
+    xSemaphoreTake(decoderIdle, portMAX_DELAY);
+    xSemaphoreGive(decoderIdle);
+  }
+  return (true);
+}
+
+void TFTs::printDecoderStats()
+{
+  uint32_t now = millis();
+  uint32_t elapsed = max(now - decoderStatsStart, (uint32_t)1);
+  Serial.print("Decoder task (core ");
+  Serial.print(decoderCore);
+  Serial.print("): ");
+  Serial.print(decoderJobs);
+  Serial.print(" images, busy ");
+  Serial.print(decoderBusyTime);
+  Serial.print(" ms (");
+  Serial.print((uint32_t)(100ULL * decoderBusyTime / elapsed));
+  Serial.print("% of the core), latency (ms) avg ");
+  Serial.print(decoderJobs > 0 ? decoderLatencyTotal / decoderJobs : 0);
+  Serial.print(", max ");
+  Serial.println(decoderLatencyMax);
+  // per interval
+  decoderJobs = 0;
+  decoderBusyTime = 0;
+  decoderLatencyTotal = 0;
+  decoderLatencyMax = 0;
+  decoderStatsStart = now;
+}
+#endif
+
+bool TFTs::isBandShown(uint8_t map, uint8_t band, uint32_t hash)
+{
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if ((map & (1 << digit)) &&
+        !(shownValid[digit] && shownDimming[digit] == dimmer.getLevel() && shownBandHashes[digit][band] == hash))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Sends the image to the displays of the map. Only the bands that differ from the image shown on any of them are sent.
+ * With DMA the function returns right after the transfer is started; finishTransfer() has to be called before
+ * anything else is sent to the display. chip_select does that, before other displays are selected.
+ */
+void TFTs::PushImage(uint8_t map, CachedFrame *frame)
+{
+  uint32_t StartTime = millis();
+  const uint32_t *hashes = imageCache.getBandHashes(frame);
+  uint32_t bytes = 0;
+  finishTransfer();
+  pushedFrame = frame; // released by the next finishTransfer(), when the image is completely sent
+  uint32_t pushCycles = RenderStats::now();
+  dimmingCycles = 0;
+  dimmer.setLevel(imageDimming());
+#ifdef IMAGE_CACHE_INDEXED
+  if (dimmer.getLevel() < 255)
+  { // only the palette is dimmed, not every pixel
+    for (uint16_t i = 0; i < 256; i++)
+    {
+      uint16_t color = dimmer.dim((frame->palette[i] << 8) | (frame->palette[i] >> 8));
+      DimmedPalette[i] = (color << 8) | (color >> 8);
+    }
+    dimmingCycles = RenderStats::now() - pushCycles;
+  }
+#endif
+
+  // cached images are already in the byte order of the display
+  bool oldSwapBytes = getSwapBytes();
+  setSwapBytes(false);
+#ifdef TFT_DMA_ENABLED
+  // dimmed and indexed images are sent from DimBuffer, which is always DMA capable
+#ifdef IMAGE_CACHE_INDEXED
+  bool useDma = true;
+#else
+  bool useDma = (dimmer.getLevel() < 255) || imageCache.isDmaCapable(frame);
+#endif
+  if (useDma)
+  {
+    startWrite(); // endWrite() is called by finishTransfer()
+  }
+#else
+  bool useDma = false;
+#endif
+  uint8_t band = 0;
+  while (band < IMAGE_DIFF_BANDS)
+  {
+    if (isBandShown(map, band, hashes[band]))
+    { // unchanged
+      band++;
+      continue;
+    }
+    // send all changed bands in a row at once
+    uint8_t firstBand = band;
+    while (band < IMAGE_DIFF_BANDS && !isBandShown(map, band, hashes[band]))
+    {
+      band++;
+    }
+    bytes += PushBands(frame, firstBand, band, useDma);
+  }
+#ifdef TFT_DMA_ENABLED
+  if (useDma && dmaPixels == NULL)
+  { // nothing was sent, finishTransfer() won't end the write
+    endWrite();
+  }
+#endif
+  setSwapBytes(oldSwapBytes);
+  // with DMA, the rest of the transfer is waited for in the next finishTransfer() (cs_switch)
+  if (dimmingCycles > 0)
+  {
+    renderStats.recordCycles(RenderStats::dimming, dimmingCycles);
+  }
+  renderStats.recordCycles(RenderStats::spi_push, RenderStats::now() - pushCycles - dimmingCycles);
+
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (map & (1 << digit))
+    {
+      memcpy(shownBandHashes[digit], hashes, sizeof(shownBandHashes[digit]));
+      shownDimming[digit] = dimmer.getLevel();
+      shownValid[digit] = true;
+    }
+  }
+  countTransfer(bytes);
+
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("img bytes sent: ");
+  Serial.println(bytes);
+  Serial.print("img transfer time: ");
+  Serial.println(millis() - StartTime);
+#endif
+}
+
+/*
+ * Sends the lines of the bands firstBand..endBand-1 of the image. Returns the number of bytes sent.
+ * With software dimming, the lines are dimmed band by band into DimBuffer and sent from there.
+ * Indexed frames are always expanded into DimBuffer, with the dimmed palette if needed.
+ */
+uint32_t TFTs::PushBands(CachedFrame *frame, uint8_t firstBand, uint8_t endBand, bool useDma)
+{
+  int16_t y = firstBand * IMAGE_DIFF_BAND_LINES;
+  int16_t h = min(endBand * IMAGE_DIFF_BAND_LINES, TFT_HEIGHT) - y;
+
+#ifndef IMAGE_CACHE_INDEXED
+  uint16_t *pixels = frame->pixels;
+  if (dimmer.getLevel() == 255)
+  {
+#ifdef TFT_DMA_ENABLED
+    if (useDma)
+    {
+      pushImageDMA(0, y, TFT_WIDTH, h, &pixels[y * TFT_WIDTH]); // waits for the previous bands
+      dmaPixels = pixels;
+      return h * TFT_WIDTH * sizeof(uint16_t);
+    }
+#endif
+    pushImage(0, y, TFT_WIDTH, h, &pixels[y * TFT_WIDTH]);
+    return h * TFT_WIDTH * sizeof(uint16_t);
+  }
+#else
+  const uint16_t *palette = (dimmer.getLevel() < 255) ? DimmedPalette : frame->palette;
+#endif
+
+#ifdef TFT_DMA_ENABLED
+  if (useDma)
+  {
+    dmaWait(); // the address window can't be changed while data is sent
+    setAddrWindow(0, y, TFT_WIDTH, h);
+  }
+#endif
+  for (int16_t line = y; line < y + h; line += IMAGE_DIFF_BAND_LINES)
+  {
+    int16_t lines = min(IMAGE_DIFF_BAND_LINES, y + h - line);
+    uint16_t *dimmed = DimBuffer[dimBufferIndex];
+    dimBufferIndex ^= 1;
+    uint32_t cycles = RenderStats::now();
+#ifdef IMAGE_CACHE_INDEXED
+    for (int16_t l = 0; l < lines; l++)
+    {
+      ImageCache::expandLine(frame, line + l, palette, &dimmed[l * TFT_WIDTH]);
+    }
+#else
+    const uint16_t *source = &pixels[line * TFT_WIDTH];
+    for (int32_t i = 0; i < lines * TFT_WIDTH; i++)
+    { // both are in the byte order of the display
+      uint16_t color = dimmer.dim((source[i] << 8) | (source[i] >> 8));
+      dimmed[i] = (color << 8) | (color >> 8);
+    }
+#endif
+    dimmingCycles += RenderStats::now() - cycles;
+#ifdef TFT_DMA_ENABLED
+    if (useDma)
+    {
+      pushPixelsDMA(dimmed, lines * TFT_WIDTH); // waits for the previous band, the other buffer is free then
+      dmaPixels = dimmed;
+      continue;
+    }
+#endif
+    pushImage(0, line, TFT_WIDTH, lines, dimmed);
+  }
+  return h * TFT_WIDTH * sizeof(uint16_t);
+}
+#else  // TFT_STREAMING_RENDER
+/*
+ * Decodes the image in bands of TFT_STREAMING_BAND_LINES lines and sends every band to the display right away.
+ * While one band is sent via DMA, the next one is decoded into the other band buffer.
+ */
+void TFTs::DrawImage(uint8_t file_index)
+{
+  uint32_t StartTime = millis();
+  uint32_t loadCycles = RenderStats::now();
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.println("");
+  Serial.print("Drawing image (streaming): ");
+  Serial.println(file_index);
+#endif
+
+  fs::File bmpFS;
+  ImageInfo info;
+  if (!OpenImage(file_index, bmpFS, info))
+  {
+    return;
+  }
+
+  dimmer.setLevel(imageDimming());
+#ifdef USE_FACE_PARTITION
+  if ((dimmer.getLevel() == 255) && !info.compressed)
+  { // nothing to convert, send the pixels straight from the mapped flash
+    uint32_t cycles = RenderStats::now();
+    DrawMappedImage(info);
+    renderStats.record(RenderStats::spi_push, cycles);
+    countTransfer(TFT_WIDTH * TFT_HEIGHT * sizeof(uint16_t));
+    renderStats.recordLoad(file_index, loadCycles);
+#ifdef DEBUG_OUTPUT_IMAGES
+    Serial.print("img transfer time: ");
+    Serial.println(millis() - StartTime);
+#endif
+    return;
+  }
+#endif
+  // decode in the byte order of the display, the bands are sent as they are
+  SelectDecoder(info, dimmer.getLevel() < 255, true); // 255 with hardware dimming
+  bool oldSwapBytes = getSwapBytes();
+  setSwapBytes(false);
+  startWrite();
+  setAddrWindow(0, 0, TFT_WIDTH, TFT_HEIGHT);
+
+  // summed up over the bands; dimming is done by the decoder here
+  uint32_t decodeCycles = 0, pushCycles = 0;
+  uint32_t cycles = RenderStats::now();
+  uint8_t band = 0;
+  for (int16_t bandTop = 0; bandTop < TFT_HEIGHT; bandTop += TFT_STREAMING_BAND_LINES)
+  {
+    int16_t bandLines = min(TFT_STREAMING_BAND_LINES, TFT_HEIGHT - bandTop);
+    uint16_t *pixels = BandBuffer[band];
+
+    // black background
+    memset(pixels, '\0', bandLines * TFT_WIDTH * sizeof(uint16_t));
+
+    // image rows in this band
+    int16_t first = max(bandTop, info.y) - info.y;
+    int16_t last = min(bandTop + bandLines, info.y + info.h) - info.y - 1;
+    if ((first <= last) && info.compressed)
+    { // the bands are drawn from top to bottom, so the lines are decoded in order
+      for (int16_t row = first; row <= last; row++)
+      {
+        if (!DecodeCompressedLine(bmpFS, info, &pixels[(row + info.y - bandTop) * TFT_WIDTH + info.x], RawBandBuffer, RAW_BAND_BUFFER_SIZE))
+        {
+          break; // keep the display in sync, draw the rest black
+        }
+      }
+    }
+    else if (first <= last)
+    {
+      // the lines of the band are always one block in the file; for BMP in reverse order
+      int16_t lines = last - first + 1;
+      int16_t firstLineInFile = info.bottomUp ? (info.h - 1 - last) : first;
+      const uint8_t *raw = ReadLines(bmpFS, info, firstLineInFile, lines, RawBandBuffer);
+      if (raw == NULL)
+      {
+        memset(RawBandBuffer, 0, lines * info.lineSize); // keep the display in sync, draw the rest black
+        raw = RawBandBuffer;
+      }
+
+      for (int16_t line = 0; line < lines; line++)
+      {
+        int16_t row = info.bottomUp ? (last - line) : (first + line);
+        DecodeLine(info, &raw[line * info.lineSize], &pixels[(row + info.y - bandTop) * TFT_WIDTH + info.x]);
+      }
+    }
+
+#ifdef DEBUG_OUTPUT_IMAGES
+    if (bandTop == 0)
+    {
+      Serial.print("img time to first pixel: ");
+      Serial.println(millis() - StartTime);
+    }
+#endif
+    uint32_t decoded = RenderStats::now();
+    decodeCycles += decoded - cycles;
+#ifdef TFT_DMA_ENABLED
+    dmaWait(); // the previous band must be sent completely, before the next one is started
+    pushPixelsDMA(pixels, bandLines * TFT_WIDTH);
+#else
+    pushPixels(pixels, bandLines * TFT_WIDTH);
+#endif
+    cycles = RenderStats::now();
+    pushCycles += cycles - decoded;
+    band ^= 1;
+  }
+#ifdef TFT_DMA_ENABLED
+  dmaWait(); // don't return before the last band is sent, the chip select may be changed next
+#endif
+  endWrite();
+  pushCycles += RenderStats::now() - cycles;
+  setSwapBytes(oldSwapBytes);
+  CloseImage(bmpFS);
+  renderStats.recordCycles(RenderStats::decode, decodeCycles);
+  renderStats.recordCycles(RenderStats::spi_push, pushCycles);
+  renderStats.recordLoad(file_index, loadCycles);
+  countTransfer(TFT_WIDTH * TFT_HEIGHT * sizeof(uint16_t));
 
 #ifdef DEBUG_OUTPUT_IMAGES
   Serial.print("img transfer time: ");
@@ -602,26 +1715,63 @@ void TFTs::DrawImage(uint8_t file_index)
 #endif
 }
 
-// These read 16- and 32-bit types from the SD card file.
+#ifdef USE_FACE_PARTITION
+/*
+ * Sends the image from the mapped flash to the display, without copying it first. Only for undimmed images.
+ * The flash is not DMA capable, so the pixels are sent by the CPU; the border around the image is filled black.
+ */
+void TFTs::DrawMappedImage(const ImageInfo &info)
+{
+  bool oldSwapBytes = getSwapBytes();
+  setSwapBytes(false); // already in the byte order of the display
+  startWrite();
+  fillRect(0, 0, TFT_WIDTH, info.y, TFT_BLACK);
+  fillRect(0, info.y + info.h, TFT_WIDTH, TFT_HEIGHT - info.y - info.h, TFT_BLACK);
+  fillRect(0, info.y, info.x, info.h, TFT_BLACK);
+  fillRect(info.x + info.w, info.y, TFT_WIDTH - info.x - info.w, info.h, TFT_BLACK);
+  pushImage(info.x, info.y, info.w, info.h, (uint16_t *)info.mapped);
+  endWrite();
+  setSwapBytes(oldSwapBytes);
+}
+#endif
+#endif // TFT_STREAMING_RENDER
+
+/*
+ * Returns the lines firstLineInFile.. of the image, in file order. Lines in mapped flash are returned directly,
+ * otherwise they are read into buffer. Returns NULL, if the file is shorter than expected.
+ */
+const uint8_t *TFTs::ReadLines(fs::File &f, const ImageInfo &info, int16_t firstLineInFile, int16_t lines, uint8_t *buffer)
+{
+  if (info.mapped != NULL)
+  {
+    return &info.mapped[firstLineInFile * info.lineSize];
+  }
+  size_t position = info.dataOffset + firstLineInFile * info.lineSize;
+  if (f.position() != position)
+  {
+    f.seek(position);
+  }
+  size_t size = lines * info.lineSize;
+  if (f.read(buffer, size) != size)
+  {
+    Serial.println("Image file truncated.");
+    return (NULL);
+  }
+  return (buffer);
+}
+
+// These get 16- and 32-bit types from a buffer read from the file.
 // BMP data is stored little-endian, Arduino is little-endian too.
 // May need to reverse subscript order if porting elsewhere.
 
-uint16_t TFTs::read16(fs::File &f)
+uint16_t TFTs::get16(const uint8_t *data)
 {
-  uint16_t result;
-  reinterpret_cast<uint8_t *>(&result)[0] = f.read(); // LSB
-  reinterpret_cast<uint8_t *>(&result)[1] = f.read(); // MSB
-  return result;
+  return data[0] | (data[1] << 8);
 }
 
-uint32_t TFTs::read32(fs::File &f)
+uint32_t TFTs::get32(const uint8_t *data)
 {
-  uint32_t result;
-  reinterpret_cast<uint8_t *>(&result)[0] = f.read(); // LSB
-  reinterpret_cast<uint8_t *>(&result)[1] = f.read();
-  reinterpret_cast<uint8_t *>(&result)[2] = f.read();
-  reinterpret_cast<uint8_t *>(&result)[3] = f.read(); // MSB
-  return result;
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
 }
 
 String TFTs::clockFaceToName(uint8_t clockFace)
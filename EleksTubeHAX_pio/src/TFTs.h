@@ -10,16 +10,34 @@
 
 #include <TFT_eSPI.h>
 #include "ChipSelect.h"
+#include "ImageCache.h"
+#include "DimmingTables.h"
+#include "RenderStats.h"
+#include "FaceBundle.h"
+#include "Qoi565.h"
+#ifdef USE_FACE_PARTITION
+#include "FacePartition.h"
+#endif
+
+#if defined(TFT_USE_DMA) && defined(ESP32_DMA)
+#define TFT_DMA_ENABLED // TFT_eSPI supports DMA for the display driver
+#endif
 
 class TFTs : public TFT_eSPI
 {
 public:
-  TFTs() : TFT_eSPI(), chip_select(), TFTsEnabled(false)
+  TFTs() : TFT_eSPI(), chip_select(), TFTsEnabled(false), dmaPixels(NULL), selectingDigit(false)
   {
 #ifndef HARDWARE_IPSTUBE_CLOCK
     for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
       digits[digit] = 0;
 #endif
+    invalidateShownImages();
+    for (uint8_t face = 0; face < 10; face++)
+    {
+      spiBytesPerFace[face] = 0;
+      imagesPerFace[face] = 0;
+    }
   }
 
   // no == Do not send to TFT. yes == Send to TFT if changed. force == Send to TFT.
@@ -42,6 +60,8 @@ public:
   void showNoMqttStatus();
 
   void setDigit(uint8_t digit, uint8_t value, show_t show = yes);
+  // Sets all NUM_DIGITS digits at once; digits with the same value are drawn together.
+  void setDigits(const uint8_t *values, show_t show = yes);
   uint8_t getDigit(uint8_t digit) { return digits[digit]; }
 
   void showAllDigits()
@@ -49,7 +69,9 @@ public:
     for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
       showDigit(digit);
   }
-  void showDigit(uint8_t digit);
+  void showDigit(uint8_t digit) { showDigits(1 << digit); }
+  // Shows the same digit value on all displays of the map (bit 0 is SECONDS_ONES). All the digits must have the same value.
+  void showDigits(uint8_t map);
 
   // Controls the power to all displays
   void enableAllDisplays();
@@ -62,26 +84,167 @@ public:
 
   uint8_t NumberOfClockFaces = 0;
   void LoadNextImage();
-  void InvalidateImageInBuffer(); // force reload from Flash with new dimming settings
+  void InvalidateImageInBuffer(); // force reload from Flash
   void ProcessUpdatedDimming();
+  // Called by chip_select, before other displays are selected.
+  void beforeChipSelectChange();
+#ifndef TFT_STREAMING_RENDER
+  void printImageCacheStats()
+  {
+    imageCache.printStats();
+#ifdef IMAGE_DECODER_TASK
+    printDecoderStats();
+#endif
+  }
+#else
+  void printImageCacheStats() {} // no cache, every image is streamed from flash
+#endif
+  void printTransferStats();
 
   String clockFaceToName(uint8_t clockFace);
   uint8_t nameToClockFace(String name);
 
 private:
+  friend class DecoderBench; // native/DecoderBench.cpp times the line decoders
+
   uint8_t digits[NUM_DIGITS];
   bool TFTsEnabled = false;
+  uint16_t *dmaPixels; // image that is currently sent via DMA, NULL if no transfer is running
+  bool selectingDigit;  // true while showDigits() selects the displays for an image
+  void showStatus(uint8_t map);
+  void selectDigits(uint8_t map); // selects the displays for an image, see selectingDigit
+
+  // bytes sent to the displays and number of images drawn, per clock face
+  uint32_t spiBytesPerFace[10];
+  uint32_t imagesPerFace[10];
+  void countTransfer(uint32_t bytes);
+
+  // Waits until an image sent via DMA is completely transferred.
+  void finishTransfer();
+
+  // Everything needed to decode the pixels of an image file, after the header is parsed.
+  static const uint8_t BMP_HEADER_SIZE = 54; // file header and BITMAPINFOHEADER
+  static const uint8_t CLK_HEADER_SIZE = 6;  // "CK", width, height
+  struct ImageInfo;
+  // Converts one line of the file into info.w RGB565 pixels. One function per bit depth, dimming and byte order.
+  typedef void (*LineDecoder)(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer);
+  // Decodes the next count pixels of a compressed image, returns the position after the used data.
+  typedef const uint8_t *(*CompressedDecoder)(Qoi565 &qoi, const uint8_t *src, const uint8_t *end, uint16_t *dest, int16_t count, const DimmingTables &dimmer);
+  struct ImageInfo
+  {
+    int16_t w, h;        // image size
+    int16_t x, y;        // position on the display; images are centered
+    uint16_t bitDepth;   // 1, 4, 8, 24 for BMP; 16 for CLK
+    uint32_t lineSize;   // bytes per line in the file
+    uint32_t dataOffset; // position of the first line in the file
+    bool bottomUp;       // BMP files store the last line first
+    bool swapped;        // pixels are stored in the byte order of the display (bundles)
+    const uint8_t *mapped = NULL; // first line in memory-mapped flash (face partition), NULL if read from the file
+    uint32_t palette[256];
+    uint16_t palette565[256]; // palette converted to the output format (dimmed, byte order) by SelectDecoder()
+    LineDecoder decode;
+    // compressed images (bundles), see DecodeCompressedLine()
+    bool compressed = false;
+    uint32_t compressedLeft = 0;             // bytes not read from the file yet
+    const uint8_t *next = NULL, *end = NULL; // bytes read (or mapped), but not decoded yet
+    Qoi565 qoi;
+    CompressedDecoder decodeCompressed;
+  };
 
   bool FileExists(const char *path);
   int8_t CountNumberOfClockFaces();
+  bool OpenImage(uint8_t file_index, fs::File &bmpFS, ImageInfo &info);
+  void CloseImage(fs::File &bmpFS);
+#ifdef USE_FACE_PARTITION
+  FacePartition facePartition;
+#elif defined(USE_FACE_BUNDLES)
+  bool OpenBundle(uint8_t face);
+  fs::File bundleFile;
+  uint8_t bundleFace = 0; // clock face of the open bundle, 0 if none
+  FaceBundleEntry bundleIndex[FACE_BUNDLE_DIGITS];
+#endif
+  // Chooses the decoder for the image, has to be called after OpenImage(). swap: output in the byte order of the display.
+  void SelectDecoder(ImageInfo &info, bool dim, bool swap);
+  void DecodeLine(const ImageInfo &info, const uint8_t *lineBuffer, uint16_t *dest) { info.decode(info, lineBuffer, dest, dimmer); }
+  template <uint8_t BitDepth>
+  static void DecodePaletteLine(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer);
+  template <bool Swapped, bool Dim, bool Swap>
+  static void Decode565Line(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer);
+  template <bool Dim, bool Swap>
+  static void Decode888Line(const ImageInfo &info, const uint8_t *line, uint16_t *dest, const DimmingTables &dimmer);
+  template <bool Dim, bool Swap>
+  static const uint8_t *DecodeQoiLine(Qoi565 &qoi, const uint8_t *src, const uint8_t *end, uint16_t *dest, int16_t count, const DimmingTables &dimmer);
+  bool DecodeCompressedLine(fs::File &f, ImageInfo &info, uint16_t *dest, uint8_t *buffer, size_t bufferSize);
+  DimmingTables dimmer;
+  uint8_t imageDimming();
+  const uint8_t *ReadLines(fs::File &f, const ImageInfo &info, int16_t firstLineInFile, int16_t lines, uint8_t *buffer);
+  static uint16_t get16(const uint8_t *data);
+  static uint32_t get32(const uint8_t *data);
+
+#ifndef TFT_STREAMING_RENDER
+  CachedFrame *GetImage(uint8_t file_index);
+  CachedFrame *pushedFrame = NULL; // image sent by PushImage(), pinned in the cache until finishTransfer()
+  void PushImage(uint8_t map, CachedFrame *frame);
+  bool isBandShown(uint8_t map, uint8_t band, uint32_t hash);
+  uint32_t PushBands(CachedFrame *frame, uint8_t firstBand, uint8_t endBand, bool useDma);
+  static uint16_t DimBuffer[2][IMAGE_DIFF_BAND_LINES * TFT_WIDTH];
+#ifdef IMAGE_CACHE_INDEXED
+  static uint16_t DimmedPalette[256]; // palette of the image sent by PushImage(), if it is dimmed
+  bool ReadIndexedImage(fs::File &bmpFS, ImageInfo &info, CachedFrame *frame);
+#endif
+  uint8_t dimBufferIndex = 0;
+  uint32_t dimmingCycles; // spent by PushBands() to dim or expand the image, for renderStats
+  // Band hashes of the images shown on the displays; only valid if the display was last written by PushImage()
+  uint32_t shownBandHashes[NUM_DIGITS][IMAGE_DIFF_BANDS];
+  uint8_t shownDimming[NUM_DIGITS];
+  bool shownValid[NUM_DIGITS];
   bool LoadImageIntoBuffer(uint8_t file_index);
+  static CachedFrame UnpackedImageBuffer[IMAGE_CACHE_STATIC_FRAMES];
+  static uint8_t RawChunkBuffer[IMAGE_READ_CHUNK_BYTES];
+  ImageCache imageCache;
+  uint8_t planImagePreload(uint8_t *files, uint8_t maxFiles);
+#ifdef IMAGE_DECODER_TASK
+  struct DecodeJob
+  {
+    uint8_t file_index;
+    uint32_t queued; // millis()
+  };
+  static void DecoderTask(void *parameter);
+  bool QueueImageLoad(uint8_t file_index, bool wait);
+  QueueHandle_t decodeJobs;      // one image at a time
+  SemaphoreHandle_t decoderIdle; // taken from queueing a job until it is done
+  uint8_t decoderCore;
+  // statistics, written by the decoder task
+  volatile uint32_t decoderJobs = 0;
+  volatile uint32_t decoderBusyTime = 0; // ms
+  volatile uint32_t decoderLatencyTotal = 0, decoderLatencyMax = 0; // ms from queueing to loaded
+  uint32_t decoderStatsStart;
+  void printDecoderStats();
+#endif
+  void invalidateShownImage(uint8_t digit) { shownValid[digit] = false; }
+  void invalidateShownImages(uint8_t map)
+  {
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+      if (map & (1 << digit))
+        shownValid[digit] = false;
+  }
+  void invalidateShownImages()
+  {
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+      shownValid[digit] = false;
+  }
+#else
+  void invalidateShownImage(uint8_t digit) {}
+  void invalidateShownImages(uint8_t map) {}
+  void invalidateShownImages() {}
   void DrawImage(uint8_t file_index);
-  uint16_t read16(fs::File &f);
-  uint32_t read32(fs::File &f);
-
-  static uint16_t UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
-  uint8_t FileInBuffer = 255; // invalid, always load first image
-  uint8_t NextFileRequired = 0;
+#ifdef USE_FACE_PARTITION
+  void DrawMappedImage(const ImageInfo &info);
+#endif
+  static uint16_t BandBuffer[2][TFT_STREAMING_BAND_LINES * TFT_WIDTH];
+  static const size_t RAW_BAND_BUFFER_SIZE = TFT_STREAMING_BAND_LINES * (((24 * TFT_WIDTH + 31) >> 5) * 4);
+  static uint8_t RawBandBuffer[RAW_BAND_BUFFER_SIZE];
+#endif
 
   String patterns_str[9] = {"1", "2", "3", "4", "5", "6", "7", "8", "9"};
   void loadClockFacesNames();
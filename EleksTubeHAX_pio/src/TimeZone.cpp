@@ -0,0 +1,283 @@
+#include "TimeZone.h"
+#include "TimeZones.h"
+#include <limits>
+
+// days since 1970-01-01 of a date (proleptic Gregorian calendar), see http://howardhinnant.github.io/date_algorithms.html
+static int32_t daysFromCivil(int year, unsigned month, unsigned day)
+{
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  uint32_t year_of_era = (uint32_t)(year - era * 400);
+  uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + (int32_t)day_of_era - 719468;
+}
+
+static bool isLeapYear(int year) { return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0; }
+
+// reads a number of up to max_digits digits, NULL if there is none
+static const char *parseNumber(const char *p, uint8_t max_digits, uint16_t &number)
+{
+  if (!isdigit((unsigned char)*p))
+  {
+    return NULL;
+  }
+  number = 0;
+  for (uint8_t digits = 0; digits < max_digits && isdigit((unsigned char)*p); digits++)
+  {
+    number = number * 10 + (*p++ - '0');
+  }
+  return p;
+}
+
+const char *TimeZone::lookup(const char *name)
+{
+  size_t low = 0, high = num_time_zones;
+  while (low < high)
+  {
+    size_t middle = (low + high) / 2;
+    int compared = strcmp(name, time_zones[middle].name);
+    if (compared == 0)
+    {
+      return time_zones[middle].rule;
+    }
+    if (compared < 0)
+    {
+      high = middle;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+  return NULL;
+}
+
+const char *TimeZone::parseName(const char *p)
+{
+  if (*p == '<')
+  { // quoted, like "<+0530>"
+    const char *end = strchr(p, '>');
+    return (end != NULL && end - p >= 4) ? end + 1 : NULL;
+  }
+  const char *start = p;
+  while (isalpha((unsigned char)*p))
+  {
+    p++;
+  }
+  return p - start >= 3 ? p : NULL;
+}
+
+const char *TimeZone::parseTime(const char *p, int32_t &seconds)
+{
+  int32_t sign = 1;
+  if (*p == '+' || *p == '-')
+  {
+    sign = *p == '-' ? -1 : 1;
+    p++;
+  }
+  uint16_t hours, minutes = 0, secs = 0;
+  p = parseNumber(p, 3, hours);
+  if (p != NULL && *p == ':')
+  {
+    p = parseNumber(p + 1, 2, minutes);
+    if (p != NULL && *p == ':')
+    {
+      p = parseNumber(p + 1, 2, secs);
+    }
+  }
+  if (p == NULL || hours > 167 || minutes > 59 || secs > 59)
+  {
+    return NULL;
+  }
+  seconds = sign * ((int32_t)hours * 3600 + minutes * 60 + secs);
+  return p;
+}
+
+const char *TimeZone::parseChange(const char *p, Change &change)
+{
+  uint16_t month, week, weekday;
+  change.type = *p;
+  if (*p == 'M')
+  {
+    p = parseNumber(p + 1, 2, month);
+    if (p == NULL || *p != '.' || (p = parseNumber(p + 1, 1, week)) == NULL || *p != '.' ||
+        (p = parseNumber(p + 1, 1, weekday)) == NULL || month < 1 || month > 12 || week < 1 || week > 5 || weekday > 6)
+    {
+      return NULL;
+    }
+    change.month = month;
+    change.week = week;
+    change.weekday = weekday;
+  }
+  else
+  {
+    if (*p == 'J')
+    {
+      p++;
+    }
+    else
+    {
+      change.type = 'D';
+    }
+    p = parseNumber(p, 3, change.day);
+    if (p == NULL || change.day > 365 || (change.type == 'J' && change.day < 1))
+    {
+      return NULL;
+    }
+  }
+  change.time = 2 * 3600;
+  if (*p == '/')
+  {
+    p = parseTime(p + 1, change.time);
+  }
+  return p;
+}
+
+bool TimeZone::set(const char *zone)
+{
+  const char *rule = lookup(zone);
+  if (rule == NULL)
+  {
+    rule = zone;
+  }
+  int32_t std_west, dst_west;
+  Change start, end;
+  const char *p = parseName(rule);
+  if (p == NULL || (p = parseTime(p, std_west)) == NULL)
+  {
+    return false;
+  }
+  bool dst = *p != '\0';
+  if (dst)
+  {
+    p = parseName(p);
+    if (p == NULL)
+    {
+      return false;
+    }
+    dst_west = std_west - 3600;
+    if (*p != '\0' && *p != ',' && (p = parseTime(p, dst_west)) == NULL)
+    {
+      return false;
+    }
+    if (*p == '\0')
+    { // no rule given: the US rules, as most C libraries do
+      p = ",M3.2.0,M11.1.0";
+    }
+    if (*p != ',' || (p = parseChange(p + 1, start)) == NULL || *p != ',' || (p = parseChange(p + 1, end)) == NULL ||
+        *p != '\0')
+    {
+      return false;
+    }
+  }
+  if (*p != '\0')
+  {
+    return false;
+  }
+  std_offset = -std_west;
+  has_dst = dst;
+  if (has_dst)
+  {
+    dst_offset = -dst_west;
+    dst_start = start;
+    dst_end = end;
+  }
+  else
+  {
+    dst_offset = std_offset;
+  }
+  from = 1;
+  until = 0; // nothing cached
+  return true;
+}
+
+void TimeZone::setFixed(int32_t offset)
+{
+  std_offset = dst_offset = offset;
+  has_dst = false;
+  from = 1;
+  until = 0;
+}
+
+time_t TimeZone::changeTime(const Change &change, int year, int32_t offset_before)
+{
+  int32_t days;
+  if (change.type == 'M')
+  {
+    int32_t first = daysFromCivil(year, change.month, 1);
+    int32_t next_month = change.month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, change.month + 1, 1);
+    uint8_t first_weekday = ((first % 7) + 7 + 4) % 7; // 1970-01-01 was a Thursday
+    days = first + (change.weekday - first_weekday + 7) % 7 + (change.week - 1) * 7;
+    while (days >= next_month)
+    { // week 5 is the last one, there may only be 4 of that weekday
+      days -= 7;
+    }
+  }
+  else if (change.type == 'J')
+  { // Feb 29 is never counted
+    days = daysFromCivil(year, 1, 1) + change.day - 1 + (isLeapYear(year) && change.day >= 60 ? 1 : 0);
+  }
+  else
+  {
+    days = daysFromCivil(year, 1, 1) + change.day;
+  }
+  return (time_t)days * 86400 + change.time - offset_before;
+}
+
+int32_t TimeZone::getOffset(time_t utc)
+{
+  if (utc >= from && utc < until)
+  {
+    return cached_offset;
+  }
+  cached_offset = std_offset;
+  from = std::numeric_limits<time_t>::min();
+  until = std::numeric_limits<time_t>::max();
+  if (!has_dst)
+  {
+    return cached_offset;
+  }
+  // the changes of the years around utc, in order: also in the southern hemisphere, where DST spans the new year
+  struct
+  {
+    time_t at;
+    int32_t offset;
+  } changes[6];
+  struct tm parts;
+  gmtime_r(&utc, &parts);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    int year = parts.tm_year + 1900 - 1 + i;
+    changes[2 * i] = {changeTime(dst_start, year, std_offset), dst_offset};
+    changes[2 * i + 1] = {changeTime(dst_end, year, dst_offset), std_offset};
+  }
+  for (uint8_t i = 1; i < 6; i++)
+  {
+    auto change = changes[i];
+    uint8_t j = i;
+    while (j > 0 && changes[j - 1].at > change.at)
+    {
+      changes[j] = changes[j - 1];
+      j--;
+    }
+    changes[j] = change;
+  }
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    if (changes[i].at > utc)
+    {
+      until = changes[i].at;
+      break;
+    }
+    from = changes[i].at;
+    cached_offset = changes[i].offset;
+  }
+  return cached_offset;
+}
+
+time_t TimeZone::getNextChange(time_t utc)
+{
+  getOffset(utc);
+  return until == std::numeric_limits<time_t>::max() ? 0 : until;
+}
@@ -0,0 +1,60 @@
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+/*
+ * Offset of the local time to UTC by a POSIX TZ rule, e.g. "CET-1CEST,M3.5.0,M10.5.0/3": the standard time (name and
+ * offset west of UTC), optionally the daylight saving time (name, offset; one hour ahead if left out) and when it
+ * starts and ends (Mm.w.d: day d of week w (5: last) of month m, Jn: day n of the year without Feb 29, n: day n of the
+ * year from 0; each with an optional /time of local time, 2:00 if left out, may be negative or beyond 24 hours).
+ * Offsets are kept in seconds, so zones like India (+5:30) or Nepal (+5:45) work.
+ * The offset is cached for the span between two changes, so getOffset() is one comparison until the next change;
+ * the changes of the year around it are calculated when that span is left.
+ */
+
+class TimeZone
+{
+public:
+  TimeZone() : std_offset(0), dst_offset(0), has_dst(false), from(1), until(0), cached_offset(0) {}
+
+  // Takes the zone name of TimeZones.h ("Europe/Berlin") or a POSIX TZ rule. Returns false, if it is neither, and keeps
+  // the zone set before.
+  bool set(const char *zone);
+  // A fixed offset (seconds east of UTC), without daylight saving time.
+  void setFixed(int32_t offset);
+  // The POSIX TZ rule of a zone name of TimeZones.h, NULL if the name isn't there.
+  static const char *lookup(const char *name);
+
+  // Seconds to add to UTC for the local time at utc.
+  int32_t getOffset(time_t utc);
+  bool isDst(time_t utc) { return has_dst && getOffset(utc) == dst_offset && dst_offset != std_offset; }
+  // The next change of the offset after utc, 0 if there is none.
+  time_t getNextChange(time_t utc);
+  bool hasDst() const { return has_dst; }
+
+private:
+  struct Change
+  {
+    char type;     // 'M' month, week, weekday; 'J' day of the year without Feb 29 (1..365); 'D' day of the year (0..365)
+    uint8_t month; // 1..12
+    uint8_t week;  // 1..5, 5: last
+    uint8_t weekday; // 0: Sunday
+    uint16_t day;
+    int32_t time; // local time of the change, seconds after midnight
+  };
+  int32_t std_offset, dst_offset; // seconds east of UTC
+  bool has_dst;
+  Change dst_start, dst_end;
+  time_t from, until; // cached_offset applies from <= utc < until
+  int32_t cached_offset;
+
+  static const char *parseName(const char *p);
+  static const char *parseTime(const char *p, int32_t &seconds);
+  static const char *parseChange(const char *p, Change &change);
+  // UTC of the change in the year, while offset_before applies.
+  static time_t changeTime(const Change &change, int year, int32_t offset_before);
+};
+
+#endif // TIME_ZONE_H
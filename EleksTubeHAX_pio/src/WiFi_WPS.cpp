@@ -13,6 +13,7 @@ WifiState_t WifiState = disconnected;
 
 uint32_t TimeOfWifiReconnectAttempt = 0;
 double GeoLocTZoffset = 0;
+String GeoLocTZname;
 
 #ifdef WIFI_USE_WPS // WPS code
 
@@ -242,6 +243,7 @@ bool GetGeoLocationTimeZoneOffset()
     Serial.println(String("Geo TZ Offset: ") + String(IPG.offset));          // we are interested in this one, type = double
     Serial.println(String("Geo Current Time: ") + String(IPG.current_time)); // currently not used
     GeoLocTZoffset = IPG.offset;
+    GeoLocTZname = IPG.tz;
     return true;
   }
   else
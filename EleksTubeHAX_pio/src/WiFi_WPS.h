@@ -20,5 +20,6 @@ extern WifiState_t WifiState;
 
 bool GetGeoLocationTimeZoneOffset();
 extern double GeoLocTZoffset;
+extern String GeoLocTZname; // IANA name of the zone, like "Europe/Ljubljana"
 
 #endif // WIFI_WPS_H
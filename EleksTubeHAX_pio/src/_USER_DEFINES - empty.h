@@ -24,6 +24,14 @@
 
 // ************* Clock font file type selection (.clk or .bmp)  *************
 // #define USE_CLK_FILES   // select between .CLK and .BMP images
+// #define USE_FACE_BUNDLES // use one packed file per clock face (N.fcb, made from the BMPs by tools/face_packer.cpp); faster to load, needs about twice the space of 8 bit BMPs
+// #define USE_FACE_PARTITION // read the clock face bundles memory-mapped from the flash partition "faces" instead of SPIFFS; needs a partition table with "faces" (see platformio.ini); with the 4 MB table, the clock faces of the data folder only fit with COMPRESS_FACE_BUNDLES
+// #define COMPRESS_FACE_BUNDLES // store the images in the clock face bundles compressed (QOI565); about half the space of uncompressed bundles, less than 8 bit BMPs
+
+// ************* Image drawing mode  *************
+// #define TFT_STREAMING_RENDER // decode images in small bands directly to the displays instead of keeping full images in RAM; saves RAM, but every digit change reads from flash
+// #define IMAGE_DECODER_TASK // load the images into the cache in a task on the other CPU core, the loop only sends them to the displays
+// #define IMAGE_CACHE_INDEXED // keep the images of 1, 4 or 8 bit BMP files as palette indices in RAM; twice as many images fit into the cache (all ten digits of a clock face with PSRAM)
 
 // ************* Display Dimming / Night time operation *************
 #define DIMMING                      // uncomment to enable dimming in the given time period between NIGHT_TIME and DAY_TIME
@@ -31,6 +39,7 @@
 #define DAY_TIME 7                   // full brightness after 7 am
 #define BACKLIGHT_DIMMED_INTENSITY 1 // 0..7
 #define TFT_DIMMED_INTENSITY 20      // 0..255
+// #define DIMMING_GAMMA 2.2         // uncomment to handle the dimming values as perceived brightness (software dimming only)
 
 // ************* WiFi config *************
 #define WIFI_CONNECT_TIMEOUT_SEC 20
@@ -38,8 +47,13 @@
 #define WIFI_USE_WPS                                    // uncomment to use WPS instead of hard coded wifi credentials
 #define WIFI_SSID "__enter_your_wifi_ssid_here__"       // not needed if WPS is used
 #define WIFI_PASSWD "__enter_your_wifi_password_here__" // not needed if WPS is used.  Caution - Hard coded password is stored as clear text in BIN file
+// #define NTP_SERVERS "0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "3.pool.ntp.org" // uncomment to use other NTP servers (up to 4); the time is taken from the ones that agree
+
+// ************* Time zone *************
+// #define TIME_ZONE "Europe/Berlin" // uncomment to set the time zone: a name of TimeZones.h or a POSIX TZ rule like "CET-1CEST,M3.5.0,M10.5.0/3"; daylight saving time is switched on the device
 
 //  *************  Geolocation  *************
+// Picks the time zone once, at the first start (if TIME_ZONE is not set)
 // Get your API Key on https://www.abstractapi.com/ (login) --> https://app.abstractapi.com/api/ip-geolocation/tester (key) *************
 // #define GEOLOCATION_ENABLED // enable after creating an account and copying Geolocation API below:
 #define GEOLOCATION_API_KEY "__enter_your_api_key_here__"
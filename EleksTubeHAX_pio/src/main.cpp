@@ -49,17 +49,35 @@ uint8_t hour_old = 255;
 #endif
 bool DstNeedsUpdate = false;
 uint8_t yesterday = 0;
+#if defined(DEBUG_OUTPUT) || defined(DEBUG_OUTPUT_IMAGES)
+uint8_t minute_old = 255;
+#endif
+#ifdef DEBUG_OUTPUT
+// Histogram of the time spent in the loop before the free time tasks. Upper limits of the buckets in ms, the last bucket is open.
+const uint16_t loop_time_limits[] = {2, 5, 10, 20, 50, 100, 200};
+const uint8_t loop_time_buckets = sizeof(loop_time_limits) / sizeof(loop_time_limits[0]) + 1;
+uint32_t loop_time_histogram[loop_time_buckets] = {0};
+uint32_t loop_busy_time = 0;        // ms spent in the loop since the last report, without the sleep at the end
+uint32_t loop_busy_time_since = 0; // millis() of the last report
+void countLoopTime(uint32_t time_in_loop);
+void printLoopTimeHistogram(void);
+#endif
 
 uint32_t lastMQTTCommandExecuted = (uint32_t)-1;
 
+time_t flip_second = 0;         // second on the displays
+uint32_t flip_us_per_image = 0; // average time to draw an image at a second change
+
 // Helper function, defined below.
 void updateClockDisplay(TFTs::show_t show = TFTs::yes);
+void flipClockDisplay(void);
 void setupMenu(void);
 #ifdef DIMMING
 bool isNightTime(uint8_t current_hour);
 void checkDimmingNeeded(void);
 #endif
 void UpdateDstEveryNight(void);
+void handleSerialCommands(void);
 #ifdef HARDWARE_NovelLife_SE_CLOCK // NovelLife_SE Clone XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void GestureStart();
 void HandleGestureInterupt(void);   // only for NovelLife SE
@@ -74,6 +92,7 @@ void setup()
   Serial.println("");
   Serial.println(FIRMWARE_VERSION);
   Serial.println("In setup().");
+  renderStats.begin();
 
   Serial.print("Init NVS flash partition usage...");
   esp_err_t ret = nvs_flash_init(); // Initialize NVS
@@ -132,7 +151,7 @@ void setup()
   tfts.setTextColor(TFT_MAGENTA, TFT_BLACK);
   tfts.print("Clock start...");
   Serial.println("Clock start-up...");
-  uclock.begin(&stored_config.config.uclock);
+  uclock.begin(&stored_config.config.uclock, &stored_config.config.rtc_drift, &stored_config.config.time_zone);
   tfts.println("Done!");
   Serial.println("Clock start-up done!");
   tfts.setTextColor(TFT_WHITE, TFT_BLACK);
@@ -149,29 +168,46 @@ void setup()
 #endif
 
 #ifdef GEOLOCATION_ENABLED
-  tfts.setTextColor(TFT_CYAN, TFT_BLACK);
-  tfts.println("GeoLoc query...");
-  Serial.println("GeoLoc query...");
-  if (GetGeoLocationTimeZoneOffset())
-  {
-    tfts.print("TZ: ");
-    Serial.print("TZ: ");
-    tfts.println(GeoLocTZoffset);
-    Serial.println(GeoLocTZoffset);
-    uclock.setTimeZoneOffset(GeoLocTZoffset * 3600);
-    Serial.println();
-    Serial.print("Saving config! Triggerd by timezone change...");
-    stored_config.save();
-    tfts.println("Done!");
-    Serial.println("Done!");
-    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+  // Only picks the time zone, its daylight saving time is switched by the clock itself (see TimeZone.h).
+  if (uclock.isTimeZonePicked())
+  {
+    uclock.printTimeZone();
   }
   else
   {
-    tfts.setTextColor(TFT_RED, TFT_BLACK);
-    tfts.println("GeoLoc FAILED");
-    Serial.println("GeoLoc failed!");
-    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    tfts.setTextColor(TFT_CYAN, TFT_BLACK);
+    tfts.println("GeoLoc query...");
+    Serial.println("GeoLoc query...");
+    if (GetGeoLocationTimeZoneOffset())
+    {
+      tfts.print("TZ: ");
+      Serial.print("TZ: ");
+      if (uclock.setTimeZone(GeoLocTZname.c_str()))
+      {
+        tfts.println(GeoLocTZname);
+        Serial.println(GeoLocTZname);
+      }
+      else
+      { // not in TimeZones.h: the offset is updated every night
+        tfts.println(GeoLocTZoffset);
+        Serial.println(GeoLocTZoffset);
+        uclock.setTimeZoneOffset(GeoLocTZoffset * 3600);
+      }
+      uclock.printTimeZone();
+      Serial.println();
+      Serial.print("Saving config! Triggerd by timezone change...");
+      stored_config.save();
+      tfts.println("Done!");
+      Serial.println("Done!");
+      tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    }
+    else
+    {
+      tfts.setTextColor(TFT_RED, TFT_BLACK);
+      tfts.println("GeoLoc FAILED");
+      Serial.println("GeoLoc failed!");
+      tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    }
   }
 #endif
 
@@ -210,6 +246,7 @@ void loop()
   uint32_t millis_at_top = millis();
   // Do all the maintenance work
   WifiReconnect(); // if not connected attempt to reconnect
+  handleSerialCommands();
 
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
   MQTTLoopFrequently();
@@ -293,9 +330,16 @@ void loop()
   if (MQTTCommandMainBrightnessReceived)
   {
     MQTTCommandMainBrightnessReceived = false;
+#ifdef DEBUG_OUTPUT_IMAGES
+    uint32_t brightness_start = millis();
+#endif
     tfts.dimming = MQTTCommandMainBrightness;
     tfts.ProcessUpdatedDimming();
     updateClockDisplay(TFTs::force);
+#ifdef DEBUG_OUTPUT_IMAGES
+    Serial.print("Brightness command to redrawn digits (ms): ");
+    Serial.println(millis() - brightness_start);
+#endif
   }
 
   if (MQTTCommandBackBrightnessReceived)
@@ -465,12 +509,32 @@ void loop()
   menu.loop(buttons); // Must be called after buttons.loop()
   backlights.loop();
   uclock.loop();
+  if (uclock.configChanged())
+  {
+    Serial.print("Saving config! Triggered by the RTC drift...");
+    stored_config.save();
+    Serial.println(" Done.");
+  }
 
 #ifdef DIMMING
   checkDimmingNeeded(); // night or day time brightness change
 #endif
 
-  updateClockDisplay(); // Draw only the changed clock digits!
+  flipClockDisplay(); // Draw only the changed clock digits!
+
+#if defined(DEBUG_OUTPUT) || defined(DEBUG_OUTPUT_IMAGES)
+  if (uclock.getMinute() != minute_old)
+  { // report the statistics every minute, right after the (most expensive) minute rollover
+#ifdef DEBUG_OUTPUT_IMAGES
+    tfts.printImageCacheStats();
+    tfts.printTransferStats();
+#endif
+#ifdef DEBUG_OUTPUT
+    printLoopTimeHistogram();
+#endif
+    minute_old = uclock.getMinute();
+  }
+#endif
 
   UpdateDstEveryNight();
 
@@ -704,6 +768,9 @@ void loop()
   } // if (menu.stateChanged())
 
   uint32_t time_in_loop = millis() - millis_at_top;
+#ifdef DEBUG_OUTPUT
+  countLoopTime(time_in_loop);
+#endif
   if (time_in_loop < 20)
   {
     // we have free time, spend it for loading next image into buffer
@@ -716,7 +783,8 @@ void loop()
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
       MQTTLoopInFreeTime();
 #endif
-      // run once a day (= 744 times per month which is below the limit of 5k for free account)
+#ifdef GEOLOCATION_ENABLED
+      // run once a day (= 744 times per month which is below the limit of 5k for free account), only for a fixed offset
       if (DstNeedsUpdate)
       { // Daylight savings time changes at 3 in the morning
         if (GetGeoLocationTimeZoneOffset())
@@ -725,11 +793,12 @@ void loop()
           DstNeedsUpdate = false; // done for this night; retry if not sucessfull
         }
       }
-      // Sleep for up to 20ms, less if we've spent time doing stuff above.
+#endif
+      // Sleep for up to 20ms, less if we've spent time doing stuff above, wake up when the next second has to be drawn.
       time_in_loop = millis() - millis_at_top;
       if (time_in_loop < 20)
       {
-        delay(20 - time_in_loop);
+        delay(min(20 - time_in_loop, uclock.getMillisToNextFlip()));
       }
     }
   }
@@ -744,6 +813,120 @@ void loop()
 #endif // DEBUG_OUTPUT
 }
 
+/*
+ * Commands from the serial monitor, one per line:
+ *   stats        prints the render statistics
+ *   stats reset  prints and clears them
+ *   rtc          prints the learned drift of the RTC and the NTP update interval
+ *   tz           prints the time zone and its next change
+ *   tz <zone>    sets the time zone: a name of TimeZones.h or a POSIX TZ rule
+ */
+void handleSerialCommands()
+{
+  static char line[64];
+  static uint8_t length = 0;
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+    if (c != '\r' && c != '\n')
+    {
+      if (length < sizeof(line) - 1)
+      {
+        line[length++] = c;
+      }
+      continue;
+    }
+    if (length == 0)
+    { // empty line or second character of "\r\n"
+      continue;
+    }
+    line[length] = '\0';
+    length = 0;
+    if (strcmp(line, "stats") == 0)
+    {
+      renderStats.print();
+    }
+    else if (strcmp(line, "stats reset") == 0)
+    {
+      renderStats.print();
+      renderStats.reset();
+      Serial.println("Render stats cleared.");
+    }
+    else if (strcmp(line, "rtc") == 0)
+    {
+      Clock::printRtcDrift();
+    }
+    else if (strcmp(line, "tz") == 0)
+    {
+      uclock.printTimeZone();
+    }
+    else if (strncmp(line, "tz ", 3) == 0)
+    {
+      if (uclock.setTimeZone(line + 3))
+      {
+        stored_config.save();
+        uclock.printTimeZone();
+      }
+      else
+      {
+        Serial.print("Unknown time zone: ");
+        Serial.println(line + 3);
+      }
+    }
+    else
+    {
+      Serial.print("Unknown command: ");
+      Serial.println(line);
+      Serial.println("Commands: stats, stats reset, rtc, tz, tz <zone>");
+    }
+  }
+}
+
+#ifdef DEBUG_OUTPUT
+void countLoopTime(uint32_t time_in_loop)
+{
+  uint8_t bucket = 0;
+  while (bucket < loop_time_buckets - 1 && time_in_loop > loop_time_limits[bucket])
+  {
+    bucket++;
+  }
+  loop_time_histogram[bucket]++;
+  loop_busy_time += time_in_loop;
+}
+
+void printLoopTimeHistogram()
+{
+  Serial.print("Loop time histogram (ms: count):");
+  for (uint8_t bucket = 0; bucket < loop_time_buckets; bucket++)
+  {
+    if (bucket < loop_time_buckets - 1)
+    {
+      Serial.print(" <=");
+      Serial.print(loop_time_limits[bucket]);
+    }
+    else
+    {
+      Serial.print(" >");
+      Serial.print(loop_time_limits[bucket - 1]);
+    }
+    Serial.print(": ");
+    Serial.print(loop_time_histogram[bucket]);
+  }
+  Serial.println();
+
+  uint32_t now = millis();
+  Serial.print("Loop busy: ");
+  Serial.print(loop_busy_time);
+  Serial.print(" ms (");
+  Serial.print((uint32_t)(100ULL * loop_busy_time / max(now - loop_busy_time_since, (uint32_t)1)));
+  Serial.print("% of core ");
+  Serial.print(xPortGetCoreID());
+  Serial.println(")");
+  loop_busy_time = 0;
+  loop_busy_time_since = now;
+}
+#endif // DEBUG_OUTPUT
+
 #ifdef HARDWARE_NovelLife_SE_CLOCK // NovelLife_SE Clone XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void GestureStart()
 {
@@ -894,7 +1077,8 @@ void UpdateDstEveryNight()
 {
   uint8_t currentDay = uclock.getDay();
   // This `DstNeedsUpdate` is True between 3:00:05 and 3:00:59. Has almost one minute of time slot to fetch updates, incl. eventual retries.
-  DstNeedsUpdate = (currentDay != yesterday) && (uclock.getHour24() == 3) && (uclock.getMinute() == 0) && (uclock.getSecond() > 5);
+  // A time zone with a POSIX TZ rule switches daylight saving time itself, only a fixed offset has to be updated.
+  DstNeedsUpdate = (uclock.getTimeZone()[0] == '\0') && (currentDay != yesterday) && (uclock.getHour24() == 3) && (uclock.getMinute() == 0) && (uclock.getSecond() > 5);
   if (DstNeedsUpdate)
   {
     Serial.print("DST needs update...");
@@ -906,11 +1090,34 @@ void UpdateDstEveryNight()
 
 void updateClockDisplay(TFTs::show_t show)
 {
-  // refresh starting on seconds
-  tfts.setDigit(SECONDS_ONES, uclock.getSecondsOnes(), show);
-  tfts.setDigit(SECONDS_TENS, uclock.getSecondsTens(), show);
-  tfts.setDigit(MINUTES_ONES, uclock.getMinutesOnes(), show);
-  tfts.setDigit(MINUTES_TENS, uclock.getMinutesTens(), show);
-  tfts.setDigit(HOURS_ONES, uclock.getHoursOnes(), show);
-  tfts.setDigit(HOURS_TENS, uclock.getHoursTens(), show);
+  uint8_t values[NUM_DIGITS];
+  values[SECONDS_ONES] = uclock.getSecondsOnes();
+  values[SECONDS_TENS] = uclock.getSecondsTens();
+  values[MINUTES_ONES] = uclock.getMinutesOnes();
+  values[MINUTES_TENS] = uclock.getMinutesTens();
+  values[HOURS_ONES] = uclock.getHoursOnes();
+  values[HOURS_TENS] = uclock.getHoursTens();
+  // digits showing the same image are drawn together
+  tfts.setDigits(values, show);
+}
+
+// Draws the changed clock digits. At a second change it measures the drawing time per image, the clock starts the next
+// second that much earlier (see Clock::setFlipTimePerImage()), and records the flip phase error in the render stats.
+void flipClockDisplay()
+{
+  uint32_t draws_before = renderStats.getDraws();
+  uint32_t start = micros();
+  updateClockDisplay();
+  uint32_t images = renderStats.getDraws() - draws_before;
+  bool flipped = flip_second != 0 && uclock.loop_time != flip_second;
+  flip_second = uclock.loop_time;
+  uint64_t epoch_ms = uclock.getEpochMillis();
+  if (!flipped || images == 0 || epoch_ms == 0)
+  {
+    return;
+  }
+  uint32_t us_per_image = (uint32_t)(micros() - start) / images;
+  flip_us_per_image = flip_us_per_image == 0 ? us_per_image : (7 * flip_us_per_image + us_per_image) / 8;
+  uclock.setFlipTimePerImage(flip_us_per_image);
+  renderStats.recordFlip((int64_t)epoch_ms - (int64_t)flip_second * 1000);
 }
@@ -0,0 +1,377 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * Host tool: packs the digit images of every clock face into one bundle file (see src/FaceBundle.h).
+ *
+ * Build:  c++ -O2 -o face_packer tools/face_packer.cpp
+ * Usage:  face_packer [--compress] <input dir with 10.bmp..99.bmp> <output dir>
+ *         face_packer [--compress] --partition [--max-size bytes] <input dir with 10.bmp..99.bmp> <partition image>
+ *
+ * For every clock face N, for which all ten files N0.bmp..N9.bmp exist, N.fcb is written to the output dir.
+ * With --partition, all bundles are written into one image for the "faces" flash partition instead. It fails, if the image
+ * is larger than --max-size (the size of the partition) or than the firmware can map (FACE_PARTITION_MAX_MAP_SIZE).
+ * With --compress, images are stored QOI565 compressed (see src/Qoi565.h), if that makes them smaller.
+ * Supported are uncompressed BMP files with 1, 4, 8 or 24 bits per pixel, the same as the firmware reads.
+ * Note: the RGB565 pixels need 2 bytes per pixel, so an uncompressed bundle is about twice as large as 8 bit BMP files.
+ *
+ * Called by script_build_fs_and_merge.py, if USE_FACE_BUNDLES, USE_FACE_PARTITION or COMPRESS_FACE_BUNDLES is defined in _USER_DEFINES.h.
+ */
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../src/FaceBundle.h"
+#include "../src/Qoi565.h"
+
+static uint16_t get16(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void put16(std::vector<uint8_t> &out, uint16_t value)
+{
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t value)
+{
+  put16(out, value & 0xFFFF);
+  put16(out, value >> 16);
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data)
+{
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    data.insert(data.end(), buffer, buffer + n);
+  fclose(f);
+  return true;
+}
+
+struct Image
+{
+  uint16_t w, h;
+  std::vector<uint8_t> pixels; // RGB565, MSB first, top line first
+  uint8_t format;              // FACE_BUNDLE_FORMAT_... of data
+  std::vector<uint8_t> data;   // what goes into the bundle
+};
+
+// Same checks and conversion as TFTs::OpenImage() and the decoders of the firmware.
+static bool decodeBmp(const std::string &path, Image &image)
+{
+  std::vector<uint8_t> file;
+  if (!readFile(path, file))
+  {
+    fprintf(stderr, "%s: can't read file\n", path.c_str());
+    return false;
+  }
+  if (file.size() < 54 || get16(&file[0]) != 0x4D42)
+  {
+    fprintf(stderr, "%s: not a BMP file\n", path.c_str());
+    return false;
+  }
+  uint32_t dataOffset = get32(&file[10]);
+  uint32_t headerSize = get32(&file[14]);
+  int32_t w = (int32_t)get32(&file[18]);
+  int32_t h = (int32_t)get32(&file[22]);
+  uint16_t bitDepth = get16(&file[28]);
+  if (get32(&file[30]) != 0 || (bitDepth != 1 && bitDepth != 4 && bitDepth != 8 && bitDepth != 24) || headerSize < 40)
+  {
+    fprintf(stderr, "%s: BMP format not supported\n", path.c_str());
+    return false;
+  }
+  if (w <= 0 || h <= 0 || w > 0xFFFF || h > 0xFFFF)
+  {
+    fprintf(stderr, "%s: BMP size not supported\n", path.c_str());
+    return false;
+  }
+
+  uint32_t palette[256] = {0};
+  if (bitDepth <= 8)
+  {
+    uint32_t paletteSize = get32(&file[46]);
+    if (paletteSize == 0)
+      paletteSize = 1 << bitDepth;
+    if (paletteSize > (1u << bitDepth) || 14 + headerSize + paletteSize * 4 > file.size())
+    {
+      fprintf(stderr, "%s: BMP palette broken\n", path.c_str());
+      return false;
+    }
+    for (uint32_t i = 0; i < paletteSize; i++)
+      palette[i] = get32(&file[14 + headerSize + i * 4]);
+  }
+
+  uint32_t lineSize = ((bitDepth * w + 31) >> 5) * 4;
+  if (dataOffset + (uint64_t)lineSize * h > file.size())
+  {
+    fprintf(stderr, "%s: BMP file truncated\n", path.c_str());
+    return false;
+  }
+
+  image.w = w;
+  image.h = h;
+  image.pixels.clear();
+  for (int32_t row = 0; row < h; row++)
+  {
+    const uint8_t *line = &file[dataOffset + (h - 1 - row) * lineSize]; // bottom up
+    for (int32_t col = 0; col < w; col++)
+    {
+      uint8_t r, g, b;
+      if (bitDepth == 24)
+      {
+        b = line[col * 3];
+        g = line[col * 3 + 1];
+        r = line[col * 3 + 2];
+      }
+      else
+      {
+        uint8_t perByte = 8 / bitDepth;
+        uint8_t shift = (perByte - 1 - (col % perByte)) * bitDepth;
+        uint32_t c = palette[(line[col / perByte] >> shift) & ((1 << bitDepth) - 1)];
+        b = c;
+        g = c >> 8;
+        r = c >> 16;
+      }
+      uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+      image.pixels.push_back(color >> 8); // MSB first, as the display wants it
+      image.pixels.push_back(color & 0xFF);
+    }
+  }
+  return true;
+}
+
+static bool writeFile(const std::string &path, const std::vector<uint8_t> &data)
+{
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f || fwrite(data.data(), 1, data.size(), f) != data.size())
+  {
+    fprintf(stderr, "%s: can't write file\n", path.c_str());
+    if (f)
+      fclose(f);
+    return false;
+  }
+  fclose(f);
+  printf("%s: %u bytes\n", path.c_str(), (unsigned)data.size());
+  return true;
+}
+
+static void align4(std::vector<uint8_t> &out)
+{
+  while (out.size() % 4)
+    out.push_back(0);
+}
+
+static void encodeQoi565(const Image &image, std::vector<uint8_t> &out)
+{
+  uint16_t index[64] = {0};
+  uint16_t prev = 0;
+  int run = 0;
+  size_t count = image.pixels.size() / 2;
+  out.clear();
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t color = (image.pixels[i * 2] << 8) | image.pixels[i * 2 + 1];
+    if (color == prev)
+    {
+      run++;
+      if (run == QOI565_MAX_RUN || i == count - 1)
+      {
+        out.push_back(QOI565_OP_RUN | (run - 1));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0)
+    {
+      out.push_back(QOI565_OP_RUN | (run - 1));
+      run = 0;
+    }
+    uint8_t hash = Qoi565::hash(color);
+    if (index[hash] == color)
+    {
+      out.push_back(QOI565_OP_INDEX | hash);
+    }
+    else
+    {
+      index[hash] = color;
+      // differences with wrap-around, as the decoder adds them
+      int dr = (((color >> 11) - (prev >> 11) + 16) & 0x1F) - 16;
+      int dg = ((((color >> 5) & 0x3F) - ((prev >> 5) & 0x3F) + 32) & 0x3F) - 32;
+      int db = (((color & 0x1F) - (prev & 0x1F) + 16) & 0x1F) - 16;
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+      {
+        out.push_back(QOI565_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+      }
+      else if (dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7)
+      {
+        out.push_back(QOI565_OP_LUMA | (dg + 32));
+        out.push_back(((dr - dg + 8) << 4) | (db - dg + 8));
+      }
+      else
+      {
+        out.push_back(QOI565_OP_RGB);
+        out.push_back(color >> 8);
+        out.push_back(color & 0xFF);
+      }
+    }
+    prev = color;
+  }
+}
+
+// Decodes the data again, the same way as the firmware, and compares it with the pixels.
+static bool checkQoi565(const Image &image)
+{
+  std::vector<uint16_t> decoded(image.w * image.h);
+  Qoi565 qoi;
+  qoi.decode(image.data.data(), image.data.data() + image.data.size(), decoded.data(), decoded.size(),
+             [](uint16_t *dest, uint16_t color) { *dest = color; });
+  for (size_t i = 0; i < decoded.size(); i++)
+  {
+    if (decoded[i] != ((image.pixels[i * 2] << 8) | image.pixels[i * 2 + 1]))
+      return false;
+  }
+  return true;
+}
+
+static bool packFace(const std::string &inDir, int face, bool compress, std::vector<uint8_t> &out)
+{
+  Image images[FACE_BUNDLE_DIGITS];
+  size_t pixelBytes = 0, dataBytes = 0;
+  for (int digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+  {
+    std::string path = inDir + "/" + std::to_string(face * 10 + digit) + ".bmp";
+    Image &image = images[digit];
+    if (!decodeBmp(path, image))
+      return false;
+    image.format = FACE_BUNDLE_FORMAT_RGB565;
+    image.data = image.pixels;
+    if (compress)
+    {
+      std::vector<uint8_t> raw;
+      raw.swap(image.data);
+      encodeQoi565(image, image.data);
+      if (!checkQoi565(image))
+      {
+        fprintf(stderr, "%s: compression check failed\n", path.c_str());
+        return false;
+      }
+      if (image.data.size() < raw.size())
+        image.format = FACE_BUNDLE_FORMAT_QOI565;
+      else // doesn't get smaller, keep it uncompressed
+        image.data.swap(raw);
+    }
+    pixelBytes += image.pixels.size();
+    dataBytes += image.data.size();
+  }
+  if (compress)
+    printf("clock face %d: %u of %u bytes (%u %%)\n", face, (unsigned)dataBytes, (unsigned)pixelBytes, (unsigned)(dataBytes * 100 / pixelBytes));
+
+  out.clear();
+  put16(out, FACE_BUNDLE_MAGIC);
+  out.push_back(FACE_BUNDLE_VERSION);
+  out.push_back(FACE_BUNDLE_DIGITS);
+  uint32_t offset = FACE_BUNDLE_HEADER_SIZE;
+  for (int digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+  {
+    put32(out, offset);
+    put32(out, images[digit].data.size());
+    put16(out, images[digit].w);
+    put16(out, images[digit].h);
+    out.push_back(images[digit].format);
+    out.push_back(0);
+    out.push_back(0);
+    out.push_back(0);
+    offset += (images[digit].data.size() + 3) & ~3u;
+  }
+  for (int digit = 0; digit < FACE_BUNDLE_DIGITS; digit++)
+  {
+    out.insert(out.end(), images[digit].data.begin(), images[digit].data.end());
+    align4(out);
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  bool partition = false;
+  bool compress = false;
+  unsigned long maxSize = FACE_PARTITION_MAX_MAP_SIZE;
+  int arg = 1;
+  for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+  {
+    if (strcmp(argv[arg], "--partition") == 0)
+      partition = true;
+    else if (strcmp(argv[arg], "--max-size") == 0 && arg + 1 < argc)
+      maxSize = std::min(maxSize, strtoul(argv[++arg], NULL, 0));
+    else if (strcmp(argv[arg], "--compress") == 0)
+      compress = true;
+    else
+      break;
+  }
+  if (argc - arg != 2)
+  {
+    fprintf(stderr, "Usage: %s [--compress] <input dir with 10.bmp..99.bmp> <output dir>\n", argv[0]);
+    fprintf(stderr, "       %s [--compress] --partition [--max-size bytes] <input dir with 10.bmp..99.bmp> <partition image>\n", argv[0]);
+    return 1;
+  }
+  const char *inDir = argv[arg];
+  const char *out = argv[arg + 1];
+
+  std::vector<uint8_t> image; // partition image
+  image.resize(FACE_PARTITION_HEADER_SIZE, 0);
+  std::vector<uint8_t> bundle;
+  int faces = 0;
+  for (int face = 1; face <= FACE_PARTITION_MAX_FACES; face++)
+  {
+    // like the firmware, stop at the first missing clock face
+    std::string first = std::string(inDir) + "/" + std::to_string(face * 10) + ".bmp";
+    FILE *f = fopen(first.c_str(), "rb");
+    if (!f)
+      break;
+    fclose(f);
+    if (!packFace(inDir, face, compress, bundle))
+      return 1;
+    if (partition)
+    {
+      uint32_t offset = image.size();
+      for (int i = 0; i < 4; i++)
+        image[4 + (face - 1) * 4 + i] = offset >> (8 * i);
+      image.insert(image.end(), bundle.begin(), bundle.end());
+      align4(image);
+    }
+    else if (!writeFile(std::string(out) + "/" + std::to_string(face) + ".fcb", bundle))
+      return 1;
+    faces++;
+  }
+  if (partition)
+  {
+    image[0] = FACE_PARTITION_MAGIC & 0xFF;
+    image[1] = FACE_PARTITION_MAGIC >> 8;
+    image[2] = FACE_PARTITION_VERSION;
+    image[3] = faces;
+    if (image.size() > maxSize)
+    {
+      fprintf(stderr, "%s: %u bytes, only %lu fit into the face partition. Use --compress or fewer clock faces.\n", out,
+              (unsigned)image.size(), maxSize);
+      return 1;
+    }
+    if (!writeFile(out, image))
+      return 1;
+  }
+  printf("%d clock faces packed.\n", faces);
+  return 0;
+}